@@ -0,0 +1,128 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "benchmark.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+#include <ulog_cpp/exception.hpp>
+
+namespace benchmark {
+
+double Runner::measureNs(const BenchmarkFunction& function, int64_t iterations)
+{
+  const auto start = std::chrono::steady_clock::now();
+  function(iterations);
+  const auto end = std::chrono::steady_clock::now();
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+void Runner::run(const std::string& name, uint64_t bytes_per_op, uint64_t items_per_op,
+                 const BenchmarkFunction& function)
+{
+  if (!enabled(name)) {
+    return;
+  }
+  // Calibrate: grow the iteration count until a single run takes at least 10% of the min time
+  const double min_time_ns = _options.min_time_s * 1e9;
+  int64_t iterations = 1;
+  double elapsed_ns = measureNs(function, iterations);
+  while (elapsed_ns < min_time_ns * 0.1 && iterations < (int64_t{1} << 40)) {
+    iterations *= 10;
+    elapsed_ns = measureNs(function, iterations);
+  }
+  iterations = std::max<int64_t>(
+      1, static_cast<int64_t>(static_cast<double>(iterations) * min_time_ns /
+                              std::max(elapsed_ns, 1.)));
+
+  std::vector<double> ns_per_op;
+  for (int i = 0; i < _options.repetitions; ++i) {
+    ns_per_op.push_back(measureNs(function, iterations) / static_cast<double>(iterations));
+  }
+  addResult(name, iterations, std::move(ns_per_op), bytes_per_op, items_per_op);
+}
+
+void Runner::runFixed(const std::string& name, int64_t iterations, int repetitions,
+                      uint64_t bytes_per_op, uint64_t items_per_op,
+                      const BenchmarkFunction& function)
+{
+  if (!enabled(name)) {
+    return;
+  }
+  std::vector<double> ns_per_op;
+  for (int i = 0; i < repetitions; ++i) {
+    ns_per_op.push_back(measureNs(function, iterations) / static_cast<double>(iterations));
+  }
+  addResult(name, iterations, std::move(ns_per_op), bytes_per_op, items_per_op);
+}
+
+void Runner::addResult(const std::string& name, int64_t iterations, std::vector<double> ns_per_op,
+                       uint64_t bytes_per_op, uint64_t items_per_op)
+{
+  std::sort(ns_per_op.begin(), ns_per_op.end());
+  Result result;
+  result.name = name;
+  result.group = _group;
+  result.iterations = iterations;
+  result.repetitions = static_cast<int>(ns_per_op.size());
+  result.ns_per_op_median = ns_per_op[ns_per_op.size() / 2];
+  result.ns_per_op_min = ns_per_op.front();
+  result.ns_per_op_max = ns_per_op.back();
+  result.bytes_per_op = bytes_per_op;
+  result.items_per_op = items_per_op;
+
+  printf("%-45s %14.1f ns/op (min %.1f, max %.1f)", name.c_str(), result.ns_per_op_median,
+         result.ns_per_op_min, result.ns_per_op_max);
+  if (bytes_per_op > 0) {
+    printf("  %.1f MB/s", static_cast<double>(bytes_per_op) / result.ns_per_op_median * 1e3);
+  }
+  if (items_per_op > 0) {
+    printf("  %.2f M items/s", static_cast<double>(items_per_op) / result.ns_per_op_median * 1e3);
+  }
+  printf("\n");
+  fflush(stdout);
+  _results.push_back(std::move(result));
+}
+
+void Runner::writeJson(const std::string& filename, const std::string& label) const
+{
+  std::FILE* file = std::fopen(filename.c_str(), "w");
+  if (!file) {
+    throw ulog_cpp::UsageException("Failed to open " + filename);
+  }
+  char date[32];
+  const std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  fprintf(file, "{\n  \"context\": {\n");
+  fprintf(file, "    \"date\": \"%s\",\n", date);
+  fprintf(file, "    \"label\": \"%s\",\n", label.c_str());
+#ifdef NDEBUG
+  fprintf(file, "    \"assertions\": false,\n");
+#else
+  fprintf(file, "    \"assertions\": true,\n");
+#endif
+  fprintf(file, "    \"compiler\": \"%s\",\n", __VERSION__);
+  fprintf(file, "    \"repetitions\": %i,\n", _options.repetitions);
+  fprintf(file, "    \"min_time_s\": %.3f,\n", _options.min_time_s);
+  fprintf(file, "    \"seed\": %" PRIu32 "\n", _options.seed);
+  fprintf(file, "  },\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < _results.size(); ++i) {
+    const Result& result = _results[i];
+    fprintf(file, "    {\"name\": \"%s\", \"group\": \"%s\", ", result.name.c_str(),
+            result.group.c_str());
+    fprintf(file, "\"iterations\": %" PRId64 ", \"repetitions\": %i, ", result.iterations,
+            result.repetitions);
+    fprintf(file, "\"ns_per_op\": %.3f, \"ns_per_op_min\": %.3f, \"ns_per_op_max\": %.3f, ",
+            result.ns_per_op_median, result.ns_per_op_min, result.ns_per_op_max);
+    fprintf(file, "\"bytes_per_op\": %" PRIu64 ", \"items_per_op\": %" PRIu64 "}%s\n",
+            result.bytes_per_op, result.items_per_op, i + 1 < _results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  std::fclose(file);
+}
+
+}  // namespace benchmark
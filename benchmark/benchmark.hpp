@@ -0,0 +1,109 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace benchmark {
+
+/**
+ * Prevent the compiler from optimizing away a computed value.
+ */
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  // No inline assembly (e.g. MSVC): publish the address through a volatile instead
+  static const void* volatile sink = nullptr;
+  sink = &value;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+struct Options {
+  double min_time_s{0.2};  ///< minimum measured time per repetition (micro benchmarks)
+  int repetitions{5};      ///< number of repetitions, the median is reported
+  std::string filter;      ///< only run benchmarks whose name contains this string
+  bool run_micro{true};    ///< run the micro benchmarks
+  bool run_macro{false};   ///< run the macro benchmarks
+  std::vector<uint64_t> macro_sizes_mb{100};  ///< synthetic log sizes for the macro benchmarks
+  std::string tmp_dir{"."};  ///< directory for temporary files of the macro benchmarks
+  uint32_t seed{1};          ///< seed for synthetic input data
+};
+
+struct Result {
+  std::string name;
+  std::string group;
+  int64_t iterations{0};  ///< iterations per repetition
+  int repetitions{0};
+  double ns_per_op_median{0.};
+  double ns_per_op_min{0.};
+  double ns_per_op_max{0.};
+  uint64_t bytes_per_op{0};  ///< processed bytes per iteration (0 if not applicable)
+  uint64_t items_per_op{0};  ///< processed items (e.g. messages) per iteration
+};
+
+/**
+ * Minimal benchmark runner. A benchmark is a function that runs the measured operation a given
+ * number of times. The runner calibrates the number of iterations to reach the minimum time,
+ * then measures several repetitions and reports the median.
+ */
+class Runner {
+ public:
+  using BenchmarkFunction = std::function<void(int64_t iterations)>;
+
+  explicit Runner(Options options) : _options(std::move(options)) {}
+
+  const Options& options() const { return _options; }
+
+  bool enabled(const std::string& name) const
+  {
+    return _options.filter.empty() || name.find(_options.filter) != std::string::npos;
+  }
+
+  /**
+   * Run a micro benchmark with automatic iteration count calibration.
+   * @param name unique benchmark name
+   * @param bytes_per_op bytes processed per iteration, used to report throughput
+   * @param items_per_op items processed per iteration, used to report the item rate
+   * @param function runs the benchmarked operation the given number of times
+   */
+  void run(const std::string& name, uint64_t bytes_per_op, uint64_t items_per_op,
+           const BenchmarkFunction& function);
+
+  /**
+   * Run a benchmark with a fixed number of iterations (used for long-running macro benchmarks).
+   */
+  void runFixed(const std::string& name, int64_t iterations, int repetitions,
+                uint64_t bytes_per_op, uint64_t items_per_op, const BenchmarkFunction& function);
+
+  const std::vector<Result>& results() const { return _results; }
+
+  void setGroup(std::string group) { _group = std::move(group); }
+
+  void writeJson(const std::string& filename, const std::string& label) const;
+
+ private:
+  static double measureNs(const BenchmarkFunction& function, int64_t iterations);
+  void addResult(const std::string& name, int64_t iterations, std::vector<double> ns_per_op,
+                 uint64_t bytes_per_op, uint64_t items_per_op);
+
+  const Options _options;
+  std::string _group;
+  std::vector<Result> _results;
+};
+
+void runMicroBenchmarks(Runner& runner);
+void runMacroBenchmarks(Runner& runner);
+
+}  // namespace benchmark
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Compare two benchmark result files written by `benchmarks --json`."""
+
+import argparse
+import json
+import sys
+
+ROW_FORMAT = '{:<45} {:>14} {:>14} {:>9}'
+
+
+def load(filename):
+    with open(filename) as f:
+        results = json.load(f)
+    benchmarks = {b['name']: b for b in results['benchmarks']}
+    return benchmarks, results['context']
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('baseline', help='baseline JSON results')
+    parser.add_argument('contender', help='JSON results to compare')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='report changes larger than this percentage')
+    parser.add_argument('--fail-on-regression', action='store_true',
+                        help='exit with an error if a benchmark regressed')
+    args = parser.parse_args()
+
+    baseline, baseline_context = load(args.baseline)
+    contender, contender_context = load(args.contender)
+    print('baseline:  {} ({})'.format(baseline_context.get('label', ''),
+                                      args.baseline))
+    print('contender: {} ({})'.format(contender_context.get('label', ''),
+                                      args.contender))
+    print()
+    print(ROW_FORMAT.format('benchmark', 'baseline ns', 'contender ns',
+                            'change'))
+
+    regressions = 0
+    for name, base in baseline.items():
+        if name not in contender:
+            continue
+        old = base['ns_per_op']
+        new = contender[name]['ns_per_op']
+        change = (new - old) / old * 100.0 if old > 0 else 0.0
+        marker = ''
+        if change > args.threshold:
+            marker = '  slower'
+            regressions += 1
+        elif change < -args.threshold:
+            marker = '  faster'
+        print(ROW_FORMAT.format(name, '{:.1f}'.format(old),
+                                '{:.1f}'.format(new),
+                                '{:+.1f}%'.format(change)) + marker)
+
+    for name in contender:
+        if name not in baseline:
+            new = '{:.1f}'.format(contender[name]['ns_per_op'])
+            print(ROW_FORMAT.format(name, '-', new, ''))
+
+    if args.fail_on_regression and regressions > 0:
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,237 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <ulog_cpp/data_container.hpp>
+#include <ulog_cpp/mapped_file.hpp>
+#include <ulog_cpp/reader.hpp>
+#include <ulog_cpp/subscription.hpp>
+
+#include "benchmark.hpp"
+#include "synthetic_log.hpp"
+
+namespace benchmark {
+
+namespace {
+
+constexpr int kReadBufferSize = 1024 * 1024;
+
+/**
+ * Streams all messages, without storing anything.
+ */
+class ParseHandler : public ulog_cpp::DataHandlerInterface {
+ public:
+  void data(const ulog_cpp::Data& data) override { ++num_data; }
+  uint64_t num_data{0};
+};
+
+/**
+ * Keeps the samples of a single topic, drops everything else.
+ */
+class FilterHandler : public ulog_cpp::DataHandlerInterface {
+ public:
+  explicit FilterHandler(std::string topic) : _topic(std::move(topic)) {}
+
+  void addLoggedMessage(const ulog_cpp::AddLoggedMessage& add_logged_message) override
+  {
+    if (add_logged_message.messageName() == _topic && add_logged_message.multiId() == 0) {
+      _msg_id = add_logged_message.msgId();
+    }
+  }
+  void data(const ulog_cpp::Data& data) override
+  {
+    if (data.msgId() == _msg_id) {
+      samples.push_back(data);
+    }
+  }
+
+  std::vector<ulog_cpp::Data> samples;
+
+ private:
+  const std::string _topic;
+  int _msg_id{-1};
+};
+
+/**
+ * Exports all numeric, non-array fields of a single topic as CSV.
+ */
+class CsvExportHandler : public ulog_cpp::DataHandlerInterface {
+ public:
+  CsvExportHandler(std::string topic, std::FILE* file) : _topic(std::move(topic)), _file(file) {}
+
+  void messageFormat(const ulog_cpp::MessageFormat& message_format) override
+  {
+    _formats[message_format.name()] = std::make_shared<ulog_cpp::MessageFormat>(message_format);
+  }
+  void headerComplete() override
+  {
+    for (auto& format : _formats) {
+      format.second->resolveDefinition(_formats);
+    }
+    _format = _formats.at(_topic);
+    for (const auto& field : _format->fields()) {
+      if (field->arrayLength() < 0 && field->type().type != ulog_cpp::Field::BasicType::NESTED) {
+        _fields.push_back(field);
+        fprintf(_file, "%s,", field->name().c_str());
+      }
+    }
+    fprintf(_file, "\n");
+  }
+  void addLoggedMessage(const ulog_cpp::AddLoggedMessage& add_logged_message) override
+  {
+    if (add_logged_message.messageName() == _topic && add_logged_message.multiId() == 0) {
+      _msg_id = add_logged_message.msgId();
+    }
+  }
+  void data(const ulog_cpp::Data& data) override
+  {
+    if (data.msgId() != _msg_id) {
+      return;
+    }
+    const ulog_cpp::TypedDataView sample(data, *_format);
+    for (const auto& field : _fields) {
+      fprintf(_file, "%.9g,", sample[field].as<double>());
+    }
+    fprintf(_file, "\n");
+    ++num_rows;
+  }
+
+  uint64_t num_rows{0};
+
+ private:
+  const std::string _topic;
+  std::FILE* _file;
+  int _msg_id{-1};
+  std::map<std::string, std::shared_ptr<ulog_cpp::MessageFormat>> _formats;
+  std::shared_ptr<ulog_cpp::MessageFormat> _format;
+  std::vector<std::shared_ptr<ulog_cpp::Field>> _fields;
+};
+
+void readFile(const std::string& filename, ulog_cpp::Reader& reader)
+{
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    throw ulog_cpp::UsageException("Failed to open " + filename);
+  }
+  std::vector<uint8_t> buffer(kReadBufferSize);
+  size_t bytes_read;
+  while ((bytes_read = std::fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+    reader.readChunk(buffer.data(), static_cast<int>(bytes_read));
+  }
+  std::fclose(file);
+}
+
+}  // namespace
+
+void runMacroBenchmarks(Runner& runner)
+{
+  for (const uint64_t size_mb : runner.options().macro_sizes_mb) {
+    const std::string suffix = std::to_string(size_mb) + "MB";
+    const std::string filename =
+        runner.options().tmp_dir + "/ulog_benchmark_" + suffix + ".ulg";
+    SyntheticLogConfig config;
+    config.seed = runner.options().seed;
+    config.target_size_bytes = size_mb * 1024 * 1024;
+
+    uint64_t file_size = 0;
+    runner.runFixed("macro/generate_" + suffix, 1, 1, config.target_size_bytes, 0,
+                    [&](int64_t iterations) {
+                      file_size = generateSyntheticLogFile(config, filename).bytes_written;
+                    });
+    if (file_size == 0) {
+      // The generate benchmark was filtered out, but the file is still needed
+      file_size = generateSyntheticLogFile(config, filename).bytes_written;
+    }
+
+    const int repetitions = runner.options().repetitions;
+    runner.runFixed("macro/parse_" + suffix, 1, repetitions, file_size, 0, [&](int64_t) {
+      auto handler = std::make_shared<ParseHandler>();
+      ulog_cpp::Reader reader{handler};
+      readFile(filename, reader);
+      doNotOptimize(handler->num_data);
+    });
+
+    runner.runFixed("macro/filter_" + suffix, 1, repetitions, file_size, 0, [&](int64_t) {
+      auto handler = std::make_shared<FilterHandler>("vehicle_attitude");
+      ulog_cpp::Reader reader{handler};
+      readFile(filename, reader);
+      doNotOptimize(handler->samples.size());
+    });
+
+    // Time until the samples of a single topic are available
+    runner.runFixed("macro/first_topic_full_" + suffix, 1, repetitions, file_size, 0, [&](int64_t) {
+      auto data_container = std::make_shared<ulog_cpp::DataContainer>(
+          ulog_cpp::DataContainer::StorageConfig::FullLog);
+      ulog_cpp::Reader reader{data_container};
+      readFile(filename, reader);
+      doNotOptimize(data_container->subscription("vehicle_attitude")->rawSamples().data());
+    });
+
+    runner.runFixed("macro/first_topic_lazy_" + suffix, 1, repetitions, file_size, 0, [&](int64_t) {
+      const auto file = std::make_shared<ulog_cpp::MappedFile>(filename);
+      auto data_container =
+          std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::Lazy);
+      data_container->setLazySource(file);
+      ulog_cpp::Reader reader{data_container};
+      for (uint64_t offset = 0; offset < file->size(); offset += kReadBufferSize) {
+        const uint64_t length = std::min<uint64_t>(kReadBufferSize, file->size() - offset);
+        reader.readChunk(file->data() + offset, static_cast<int>(length));
+      }
+      doNotOptimize(data_container->subscription("vehicle_attitude")->rawSamples().data());
+    });
+
+    runner.runFixed("macro/full_log_budget_" + suffix, 1, repetitions, file_size, 0, [&](int64_t) {
+      auto data_container = std::make_shared<ulog_cpp::DataContainer>(
+          ulog_cpp::DataContainer::StorageConfig::FullLog);
+      data_container->setMemoryBudget(file_size / 8, runner.options().tmp_dir);
+      ulog_cpp::Reader reader{data_container};
+      readFile(filename, reader);
+      doNotOptimize(data_container->subscription("vehicle_attitude")->rawSamples().data());
+    });
+
+    runner.runFixed("macro/full_log_compressed_" + suffix, 1, repetitions, file_size, 0,
+                    [&](int64_t) {
+                      auto data_container = std::make_shared<ulog_cpp::DataContainer>(
+                          ulog_cpp::DataContainer::StorageConfig::FullLog);
+                      data_container->enableCompression();
+                      ulog_cpp::Reader reader{data_container};
+                      readFile(filename, reader);
+                      doNotOptimize(data_container->memoryUsage());
+                    });
+
+    runner.runFixed("macro/full_log_decimated_" + suffix, 1, repetitions, file_size, 0,
+                    [&](int64_t) {
+                      auto data_container = std::make_shared<ulog_cpp::DataContainer>(
+                          ulog_cpp::DataContainer::StorageConfig::FullLog);
+                      data_container->setDefaultDecimationPolicy(
+                          ulog_cpp::DecimationPolicy::maxSamples(10000));
+                      ulog_cpp::Reader reader{data_container};
+                      readFile(filename, reader);
+                      doNotOptimize(data_container->memoryUsage());
+                    });
+
+    const std::string csv_filename = filename + ".csv";
+    runner.runFixed("macro/export_csv_" + suffix, 1, repetitions, file_size, 0, [&](int64_t) {
+      std::FILE* csv_file = std::fopen(csv_filename.c_str(), "w");
+      if (!csv_file) {
+        throw ulog_cpp::UsageException("Failed to open " + csv_filename);
+      }
+      auto handler = std::make_shared<CsvExportHandler>("sensor_accel", csv_file);
+      ulog_cpp::Reader reader{handler};
+      readFile(filename, reader);
+      std::fclose(csv_file);
+      doNotOptimize(handler->num_rows);
+    });
+
+    std::remove(csv_filename.c_str());
+    std::remove(filename.c_str());
+  }
+}
+
+}  // namespace benchmark
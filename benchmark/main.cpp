@@ -0,0 +1,95 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <ulog_cpp/exception.hpp>
+
+#include "benchmark.hpp"
+
+static void usage(const char* name)
+{
+  printf("Usage: %s [options]\n", name);
+  printf("  --json <file>           write results as JSON\n");
+  printf("  --label <text>          label stored in the JSON context (e.g. a commit hash)\n");
+  printf("  --filter <substring>    only run benchmarks containing <substring>\n");
+  printf("  --min-time <seconds>    minimum time per repetition (default 0.2)\n");
+  printf("  --repetitions <n>       repetitions per benchmark (default 5)\n");
+  printf("  --seed <n>              seed for the synthetic input data (default 1)\n");
+  printf("  --macro                 also run the macro benchmarks\n");
+  printf("  --macro-only            only run the macro benchmarks\n");
+  printf("  --macro-size-mb <n>     synthetic log size for macro benchmarks, can be repeated\n");
+  printf("                          (default 100)\n");
+  printf("  --tmp-dir <dir>         directory for generated logs (default .)\n");
+}
+
+int main(int argc, char** argv)
+{
+  benchmark::Options options;
+  std::string json_file;
+  std::string label;
+  bool macro_sizes_set = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto next = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        usage(argv[0]);
+        exit(-1);
+      }
+      return argv[++i];
+    };
+    if (arg == "--json") {
+      json_file = next();
+    } else if (arg == "--label") {
+      label = next();
+    } else if (arg == "--filter") {
+      options.filter = next();
+    } else if (arg == "--min-time") {
+      options.min_time_s = std::stod(next());
+    } else if (arg == "--repetitions") {
+      options.repetitions = std::max(1, std::stoi(next()));
+    } else if (arg == "--seed") {
+      options.seed = std::stoul(next());
+    } else if (arg == "--macro") {
+      options.run_macro = true;
+    } else if (arg == "--macro-only") {
+      options.run_macro = true;
+      options.run_micro = false;
+    } else if (arg == "--macro-size-mb") {
+      if (!macro_sizes_set) {
+        options.macro_sizes_mb.clear();
+        macro_sizes_set = true;
+      }
+      options.macro_sizes_mb.push_back(std::stoull(next()));
+    } else if (arg == "--tmp-dir") {
+      options.tmp_dir = next();
+    } else {
+      usage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : -1;
+    }
+  }
+
+  try {
+    benchmark::Runner runner(options);
+    if (options.run_micro) {
+      runner.setGroup("micro");
+      benchmark::runMicroBenchmarks(runner);
+    }
+    if (options.run_macro) {
+      runner.setGroup("macro");
+      benchmark::runMacroBenchmarks(runner);
+    }
+    if (!json_file.empty()) {
+      runner.writeJson(json_file, label);
+      printf("Results written to %s\n", json_file.c_str());
+    }
+  } catch (const ulog_cpp::ExceptionBase& e) {
+    printf("ULog exception: %s\n", e.what());
+    return -1;
+  }
+  return 0;
+}
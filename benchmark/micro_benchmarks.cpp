@@ -0,0 +1,445 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <ulog_cpp/data_container.hpp>
+#include <ulog_cpp/lod_pyramid.hpp>
+#include <ulog_cpp/reader.hpp>
+#include <ulog_cpp/resample.hpp>
+#include <ulog_cpp/simple_writer.hpp>
+#include <ulog_cpp/writer.hpp>
+
+#include "benchmark.hpp"
+#include "synthetic_log.hpp"
+
+namespace benchmark {
+
+namespace {
+
+constexpr int kChunkSize = 64 * 1024;
+
+/**
+ * Data handler that only counts messages, used to measure the reader overhead alone.
+ */
+class CountingHandler : public ulog_cpp::DataHandlerInterface {
+ public:
+  void data(const ulog_cpp::Data& data) override
+  {
+    ++num_data;
+    num_data_bytes += data.data().size();
+  }
+  void error(const std::string& msg, bool is_recoverable) override { ++num_errors; }
+
+  uint64_t num_data{0};
+  uint64_t num_data_bytes{0};
+  uint64_t num_errors{0};
+};
+
+void readAll(ulog_cpp::Reader& reader, const std::vector<uint8_t>& log)
+{
+  for (size_t offset = 0; offset < log.size(); offset += kChunkSize) {
+    const int length = static_cast<int>(std::min<size_t>(kChunkSize, log.size() - offset));
+    reader.readChunk(log.data() + offset, length);
+  }
+}
+
+std::shared_ptr<ulog_cpp::DataContainer> parseFull(const std::vector<uint8_t>& log)
+{
+  auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  readAll(reader, log);
+  return data_container;
+}
+
+/**
+ * Insert blocks of random bytes into a log at regular intervals, so that the reader has to
+ * recover repeatedly.
+ */
+std::vector<uint8_t> corruptLog(const std::vector<uint8_t>& log, size_t header_size, uint32_t seed)
+{
+  const size_t kCorruptionInterval = 64 * 1024;
+  const size_t kCorruptionLength = 512;
+  Random random(seed);
+  std::vector<uint8_t> corrupted(log.begin(), log.begin() + header_size);
+  for (size_t offset = header_size; offset < log.size(); offset += kCorruptionInterval) {
+    const size_t end = std::min(log.size(), offset + kCorruptionInterval);
+    corrupted.insert(corrupted.end(), log.begin() + offset, log.begin() + end);
+    for (size_t i = 0; i < kCorruptionLength; ++i) {
+      corrupted.push_back(static_cast<uint8_t>(random.next()));
+    }
+  }
+  return corrupted;
+}
+
+struct AccelSample {
+  uint64_t timestamp;
+  uint64_t timestamp_sample;
+  uint32_t device_id;
+  float x;
+  float y;
+  float z;
+  float temperature;
+  uint32_t error_count;
+  uint8_t clip_counter[3];
+  uint8_t samples;
+  uint8_t padding0[4];
+};
+
+std::vector<ulog_cpp::Field> accelFields()
+{
+  return {{"uint64_t", "timestamp"},
+          {"uint64_t", "timestamp_sample"},
+          {"uint32_t", "device_id"},
+          {"float", "x"},
+          {"float", "y"},
+          {"float", "z"},
+          {"float", "temperature"},
+          {"uint32_t", "error_count"},
+          {"uint8_t", "clip_counter", 3},
+          {"uint8_t", "samples"},
+          {"uint8_t", "_padding0", 4}};
+}
+
+void benchmarkReader(Runner& runner, const std::vector<uint8_t>& log,
+                     const std::vector<uint8_t>& header, uint32_t seed)
+{
+  runner.run("reader/header_parse", header.size(), 1, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      auto data_container =
+          std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::Header);
+      ulog_cpp::Reader reader{data_container};
+      reader.readChunk(header.data(), static_cast<int>(header.size()));
+      doNotOptimize(data_container->messageFormats().size());
+    }
+  });
+
+  auto counting_handler = std::make_shared<CountingHandler>();
+  {
+    ulog_cpp::Reader reader{counting_handler};
+    readAll(reader, log);
+  }
+  const uint64_t num_data = counting_handler->num_data;
+
+  runner.run("reader/data_dispatch", log.size(), num_data, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      auto handler = std::make_shared<CountingHandler>();
+      ulog_cpp::Reader reader{handler};
+      readAll(reader, log);
+      doNotOptimize(handler->num_data);
+    }
+  });
+
+  runner.run("reader/data_container_full_log", log.size(), num_data, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      auto data_container = parseFull(log);
+      doNotOptimize(data_container->subscriptionsByMessageId().size());
+    }
+  });
+
+  runner.run("reader/data_container_message_index", log.size(), num_data,
+             [&](int64_t iterations) {
+               for (int64_t i = 0; i < iterations; ++i) {
+                 auto data_container = std::make_shared<ulog_cpp::DataContainer>(
+                     ulog_cpp::DataContainer::StorageConfig::FullLog);
+                 data_container->enableMessageIndex();
+                 ulog_cpp::Reader reader{data_container};
+                 readAll(reader, log);
+                 doNotOptimize(data_container->messageIndex().size());
+               }
+             });
+
+  const size_t header_size = header.size();
+  const auto corrupted = corruptLog(log, header_size, seed);
+  runner.run("reader/recovery_scan", corrupted.size(), 0, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      auto handler = std::make_shared<CountingHandler>();
+      ulog_cpp::Reader reader{handler};
+      readAll(reader, corrupted);
+      doNotOptimize(handler->num_data);
+    }
+  });
+}
+
+void benchmarkAccess(Runner& runner, const std::vector<uint8_t>& log)
+{
+  const auto data_container = parseFull(log);
+  const auto accel = data_container->subscription("sensor_accel");
+  const auto attitude = data_container->subscription("vehicle_attitude");
+  const auto esc_status = data_container->subscription("esc_status");
+  const auto x_field = accel->field("x");
+  const auto q_field = attitude->field("q");
+
+  runner.run("access/subscription_iterate", 0, accel->size(), [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      size_t sum = 0;
+      for (const auto& sample : *accel) {
+        sum += sample.rawData().size();
+      }
+      doNotOptimize(sum);
+    }
+  });
+
+  runner.run("access/field_decode_as_float", 0, accel->size(), [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      float sum = 0.F;
+      for (const auto& sample : *accel) {
+        sum += sample[x_field].as<float>();
+      }
+      doNotOptimize(sum);
+    }
+  });
+
+  runner.run("access/field_decode_by_name", 0, accel->size(), [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      float sum = 0.F;
+      for (const auto& sample : *accel) {
+        sum += sample["x"].as<float>();
+      }
+      doNotOptimize(sum);
+    }
+  });
+
+  runner.run("access/field_decode_array", 0, attitude->size(), [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      float sum = 0.F;
+      for (const auto& sample : *attitude) {
+        sum += sample[q_field].as<std::vector<float>>()[3];
+      }
+      doNotOptimize(sum);
+    }
+  });
+
+  runner.run("access/field_decode_nested", 0, esc_status->size(), [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      int64_t sum = 0;
+      for (const auto& sample : *esc_status) {
+        sum += sample["esc"][3]["esc_rpm"].as<int32_t>();
+      }
+      doNotOptimize(sum);
+    }
+  });
+
+  // Extract all numeric fields of a subscription into one column per field
+  std::vector<std::shared_ptr<ulog_cpp::Field>> accel_fields;
+  for (const auto& field : accel->format()->fields()) {
+    if (field->arrayLength() < 0 && field->type().type != ulog_cpp::Field::BasicType::NESTED) {
+      accel_fields.push_back(field);
+    }
+  }
+  runner.run("access/columnar_extraction", 0, accel->size() * accel_fields.size(),
+             [&](int64_t iterations) {
+               for (int64_t i = 0; i < iterations; ++i) {
+                 std::vector<std::vector<double>> columns(accel_fields.size());
+                 for (size_t c = 0; c < accel_fields.size(); ++c) {
+                   columns[c].reserve(accel->size());
+                   for (const auto& sample : *accel) {
+                     columns[c].push_back(sample[accel_fields[c]].as<double>());
+                   }
+                 }
+                 doNotOptimize(columns.back().back());
+               }
+             });
+
+  runner.run("access/columnar_extraction_direct", 0, accel->size() * accel_fields.size(),
+             [&](int64_t iterations) {
+               for (int64_t i = 0; i < iterations; ++i) {
+                 std::vector<std::vector<double>> columns;
+                 for (const auto& field : accel_fields) {
+                   columns.push_back(ulog_cpp::column(*accel, field->name()));
+                 }
+                 doNotOptimize(columns.back().back());
+               }
+             });
+
+  // Align two topics to a 250 Hz time base
+  const auto accel_timestamps = ulog_cpp::timestampColumn(*accel);
+  const auto accel_x = ulog_cpp::column(*accel, "x");
+  const auto target_timestamps = ulog_cpp::uniformTimestamps(
+      accel_timestamps.front(), accel_timestamps.back(), 250.);
+  for (const auto interpolation : {ulog_cpp::Interpolation::ZeroOrderHold,
+                                   ulog_cpp::Interpolation::Linear,
+                                   ulog_cpp::Interpolation::Nearest}) {
+    const char* name = interpolation == ulog_cpp::Interpolation::Linear ? "linear"
+                       : interpolation == ulog_cpp::Interpolation::Nearest ? "nearest"
+                                                                           : "zoh";
+    ulog_cpp::ResampleOptions options;
+    options.interpolation = interpolation;
+    runner.run(std::string("resample/index_") + name, 0,
+               accel_timestamps.size() + target_timestamps.size(), [&](int64_t iterations) {
+                 for (int64_t i = 0; i < iterations; ++i) {
+                   const ulog_cpp::ResampleIndex index(accel_timestamps, target_timestamps,
+                                                       options);
+                   doNotOptimize(index.size());
+                 }
+               });
+    const ulog_cpp::ResampleIndex index(accel_timestamps, target_timestamps, options);
+    std::vector<double> output(index.size());
+    runner.run(std::string("resample/apply_") + name, 0, index.size(), [&](int64_t iterations) {
+      for (int64_t i = 0; i < iterations; ++i) {
+        index.apply(accel_x.data(), output.data());
+        doNotOptimize(output.back());
+      }
+    });
+  }
+
+  // Min/max envelope of the whole topic for a 1000 pixel wide plot
+  runner.run("lod/build", 0, accel->size() * accel_fields.size(), [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      const ulog_cpp::LodPyramid pyramid(*accel);
+      doNotOptimize(pyramid.numLevels());
+    }
+  });
+  const ulog_cpp::LodPyramid pyramid(*accel);
+  const int pyramid_field = pyramid.fieldIndex("x");
+  constexpr size_t kNumPixels = 1000;
+  runner.run("lod/query_1000px", 0, 1, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      const auto points = pyramid.query(pyramid_field, accel_timestamps.front(),
+                                        accel_timestamps.back(), kNumPixels);
+      doNotOptimize(points.back().max);
+    }
+  });
+  runner.run("lod/rescan_1000px", 0, 1, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      const auto values = ulog_cpp::column(*accel, "x");
+      std::vector<std::pair<double, double>> pixels(kNumPixels, {INFINITY, -INFINITY});
+      for (size_t j = 0; j < values.size(); ++j) {
+        auto& pixel = pixels[j * kNumPixels / values.size()];
+        pixel.first = std::min(pixel.first, values[j]);
+        pixel.second = std::max(pixel.second, values[j]);
+      }
+      doNotOptimize(pixels.back().second);
+    }
+  });
+}
+
+void benchmarkWriter(Runner& runner)
+{
+  std::vector<uint8_t> output;
+  output.reserve(1024 * 1024 + 1024);
+  const ulog_cpp::DataWriteCB sink = [&output](const uint8_t* data, int length) {
+    if (output.size() + length > output.capacity()) {
+      output.clear();
+    }
+    output.insert(output.end(), data, data + length);
+  };
+
+  const std::vector<uint8_t> payload(sizeof(AccelSample), 0x3C);
+  const uint64_t message_size = payload.size() + sizeof(ulog_cpp::ulog_message_data_s);
+
+  runner.run("writer/serialize_data", message_size, 1, [&](int64_t iterations) {
+    ulog_cpp::Writer writer(sink);
+    for (int64_t i = 0; i < iterations; ++i) {
+      writer.data(ulog_cpp::Data(1, payload));
+    }
+  });
+
+  const ulog_cpp::Logging logging(ulog_cpp::Logging::Level::Info, "benchmark message", 1234);
+  runner.run("writer/serialize_logging", 0, 1, [&](int64_t iterations) {
+    ulog_cpp::Writer writer(sink);
+    for (int64_t i = 0; i < iterations; ++i) {
+      writer.logging(logging);
+    }
+  });
+
+  runner.run("writer/serialize_data_buffered", message_size, 1, [&](int64_t iterations) {
+    ulog_cpp::Writer writer(sink, 64 * 1024);
+    for (int64_t i = 0; i < iterations; ++i) {
+      writer.data(ulog_cpp::Data(1, payload));
+    }
+  });
+
+  for (const int buffer_size : {0, ulog_cpp::SimpleWriter::kDefaultFileBufferSize}) {
+    ulog_cpp::SimpleWriter simple_writer(sink, 0, buffer_size);
+    simple_writer.writeMessageFormat("sensor_accel", accelFields());
+    simple_writer.headerComplete();
+    const uint16_t msg_id = simple_writer.writeAddLoggedMessage("sensor_accel");
+    AccelSample sample{};
+    const std::string name = buffer_size > 0 ? "writer/simple_writer_write_data_buffered"
+                                             : "writer/simple_writer_write_data";
+    runner.run(name, message_size, 1, [&](int64_t iterations) {
+      for (int64_t i = 0; i < iterations; ++i) {
+        sample.timestamp += 1000;
+        simple_writer.writeData(msg_id, sample);
+      }
+    });
+  }
+
+  // Producer side of the async writer, the writer thread discards the data
+  auto async_writer = std::make_shared<ulog_cpp::AsyncWriter>(
+      [](const uint8_t* data, int length) { doNotOptimize(data); }, 8 * 1024 * 1024);
+  ulog_cpp::SimpleWriter async_simple_writer(async_writer, 0);
+  async_simple_writer.writeMessageFormat("sensor_accel", accelFields());
+  async_simple_writer.headerComplete();
+  const uint16_t async_msg_id = async_simple_writer.writeAddLoggedMessage("sensor_accel");
+  AccelSample sample{};
+  bool async_benchmark_ran = false;
+  runner.run("writer/async_writer_write_data", message_size, 1, [&](int64_t iterations) {
+    async_benchmark_ran = true;
+    for (int64_t i = 0; i < iterations; ++i) {
+      sample.timestamp += 1000;
+      async_simple_writer.writeData(async_msg_id, sample);
+    }
+  });
+  const auto stats = async_writer->stats();
+  if (async_benchmark_ran) {
+      printf("  async writer: max latency %.1f us, %" PRIu64 " dropped\n",
+           static_cast<double>(stats.max_write_latency_ns) / 1e3, stats.num_dropped);
+  }
+
+  // Multi-producer throughput, iterations are distributed over the threads
+  for (const int num_threads : {1, 2, 4}) {
+    ulog_cpp::SimpleWriter mp_writer(
+        [](const uint8_t* data, int length) { doNotOptimize(data); }, 0);
+    mp_writer.enableMultiProducer();
+    mp_writer.writeMessageFormat("sensor_accel", accelFields());
+    mp_writer.headerComplete();
+    std::vector<uint16_t> msg_ids;
+    for (int i = 0; i < num_threads; ++i) {
+      msg_ids.push_back(mp_writer.writeAddLoggedMessage("sensor_accel", i));
+    }
+    runner.run("writer/multi_producer_write_data/threads:" + std::to_string(num_threads),
+               message_size, 1, [&](int64_t iterations) {
+                 std::vector<std::thread> threads;
+                 for (int i = 0; i < num_threads; ++i) {
+                   threads.emplace_back([&, i]() {
+                     AccelSample thread_sample{};
+                     for (int64_t n = i; n < iterations; n += num_threads) {
+                       thread_sample.timestamp += 1000;
+                       mp_writer.writeData(msg_ids[i], thread_sample);
+                     }
+                   });
+                 }
+                 for (auto& thread : threads) {
+                   thread.join();
+                 }
+               });
+  }
+}
+
+}  // namespace
+
+void runMicroBenchmarks(Runner& runner)
+{
+  SyntheticLogConfig config;
+  config.seed = runner.options().seed;
+  config.target_size_bytes = 16 * 1024 * 1024;
+  const auto log = generateSyntheticLog(config);
+  config.target_size_bytes = 0;
+  const auto header = generateSyntheticLog(config);
+
+  benchmarkReader(runner, log, header, config.seed);
+  benchmarkAccess(runner, log);
+  benchmarkWriter(runner);
+}
+
+}  // namespace benchmark
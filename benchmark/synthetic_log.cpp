@@ -0,0 +1,450 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "synthetic_log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ulog_cpp/writer.hpp>
+
+namespace benchmark {
+
+namespace {
+
+using ulog_cpp::Field;
+using ulog_cpp::MessageFormat;
+
+/**
+ * A single basic-type element of a message (array elements and nested fields are flattened)
+ */
+struct Leaf {
+  int offset;
+  Field::BasicType type;
+};
+
+struct Topic {
+  std::shared_ptr<MessageFormat> format;
+  uint8_t multi_id{};
+  uint64_t interval_us{};
+  uint16_t msg_id{};
+  std::vector<Leaf> leaves;
+  std::vector<float> state;      ///< random walk state per leaf
+  std::vector<uint8_t> message;  ///< serialized DATA message (header + payload)
+};
+
+using FormatMap = std::map<std::string, std::shared_ptr<MessageFormat>>;
+
+void addFormat(FormatMap& formats, std::vector<std::shared_ptr<MessageFormat>>& ordered,
+               const std::string& name, const std::vector<Field>& fields)
+{
+  auto format = std::make_shared<MessageFormat>(name, fields);
+  formats[name] = format;
+  ordered.push_back(format);
+}
+
+void createBaseFormats(const SyntheticLogConfig& config, FormatMap& formats,
+                       std::vector<std::shared_ptr<MessageFormat>>& ordered)
+{
+  addFormat(formats, ordered, "sensor_accel",
+            {{"uint64_t", "timestamp"},
+             {"uint64_t", "timestamp_sample"},
+             {"uint32_t", "device_id"},
+             {"float", "x"},
+             {"float", "y"},
+             {"float", "z"},
+             {"float", "temperature"},
+             {"uint32_t", "error_count"},
+             {"uint8_t", "clip_counter", 3},
+             {"uint8_t", "samples"},
+             {"uint8_t", "_padding0", 4}});
+  addFormat(formats, ordered, "vehicle_attitude",
+            {{"uint64_t", "timestamp"},
+             {"uint64_t", "timestamp_sample"},
+             {"float", "q", 4},
+             {"float", "delta_q_reset", 4},
+             {"uint8_t", "quat_reset_counter"},
+             {"uint8_t", "_padding0", 7}});
+  addFormat(formats, ordered, "vehicle_status",
+            {{"uint64_t", "timestamp"},
+             {"uint64_t", "armed_time"},
+             {"uint64_t", "takeoff_time"},
+             {"uint8_t", "arming_state"},
+             {"uint8_t", "latest_arming_reason"},
+             {"uint8_t", "nav_state"},
+             {"uint8_t", "vehicle_type"},
+             {"bool", "failsafe"},
+             {"uint8_t", "_padding0", 3}});
+  if (config.nested_formats) {
+    addFormat(formats, ordered, "esc_report",
+              {{"uint64_t", "timestamp"},
+               {"int32_t", "esc_rpm"},
+               {"float", "esc_voltage"},
+               {"float", "esc_current"},
+               {"float", "esc_temperature"},
+               {"uint16_t", "esc_errorcount"},
+               {"uint8_t", "esc_state"},
+               {"uint8_t", "_padding0", 5}});
+    addFormat(formats, ordered, "esc_status",
+              {{"uint64_t", "timestamp"},
+               {"uint16_t", "counter"},
+               {"uint8_t", "esc_count"},
+               {"uint8_t", "esc_online_flags"},
+               {"uint8_t", "_padding0", 4},
+               {"esc_report", "esc", 8}});
+  }
+}
+
+/**
+ * Create a format with a pseudo-random set of fields, ordered by decreasing type size (as
+ * the PX4 message generator does).
+ */
+void createRandomFormat(const SyntheticLogConfig& config, int index, Random& random,
+                        FormatMap& formats, std::vector<std::shared_ptr<MessageFormat>>& ordered)
+{
+  static const char* const kTypes[] = {"uint64_t", "int64_t", "double",  "float",   "uint32_t",
+                                       "int32_t",  "uint16_t", "int16_t", "uint8_t", "int8_t",
+                                       "bool",     "char"};
+  char name[64];
+  std::vector<Field> fields{{"uint64_t", "timestamp"}};
+  const int num_fields = 1 + static_cast<int>(random.below(24));
+  std::vector<std::pair<int, Field>> sized_fields;
+  for (int i = 0; i < num_fields; ++i) {
+    const std::string type = kTypes[random.below(sizeof(kTypes) / sizeof(kTypes[0]))];
+    const int array_length = random.below(4) == 0 ? 2 + static_cast<int>(random.below(15)) : -1;
+    snprintf(name, sizeof(name), "field_%02i", i);
+    sized_fields.emplace_back(Field::kBasicTypes.at(type).size,
+                              Field(type, name, type == "char" ? 16 : array_length));
+  }
+  std::stable_sort(sized_fields.begin(), sized_fields.end(),
+                   [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (const auto& sized_field : sized_fields) {
+    fields.push_back(sized_field.second);
+  }
+  if (config.nested_formats && index % 4 == 0) {
+    snprintf(name, sizeof(name), "synthetic_nested_%03i", index);
+    const std::string nested_name = name;
+    addFormat(formats, ordered, nested_name,
+              {{"float", "value", 3}, {"uint32_t", "count"}, {"uint8_t", "flags", 4}});
+    fields.emplace_back(nested_name, "nested", 1 + static_cast<int>(random.below(4)));
+  }
+  snprintf(name, sizeof(name), "synthetic_topic_%03i", index);
+  addFormat(formats, ordered, name, fields);
+}
+
+void flattenLeaves(const MessageFormat& format, std::vector<Leaf>& leaves)
+{
+  for (const auto& leaf : format.layout()) {
+    for (int i = 0; i < leaf.count; ++i) {
+      leaves.push_back({leaf.offset + i * leaf.size, leaf.type});
+    }
+  }
+}
+
+template <typename T>
+void store(uint8_t* dst, T value)
+{
+  memcpy(dst, &value, sizeof(value));
+}
+
+/**
+ * Update the payload of a topic: timestamps get the current time, floating point values follow a
+ * random walk, integers change slowly.
+ */
+void fillPayload(Topic& topic, uint64_t timestamp_us, Random& random)
+{
+  uint8_t* payload = topic.message.data() + sizeof(ulog_cpp::ulog_message_data_s);
+  for (size_t i = 0; i < topic.leaves.size(); ++i) {
+    const Leaf& leaf = topic.leaves[i];
+    uint8_t* dst = payload + leaf.offset;
+    float& state = topic.state[i];
+    switch (leaf.type) {
+      case Field::BasicType::UINT64:
+      case Field::BasicType::INT64:
+        store<uint64_t>(dst, timestamp_us - (leaf.offset == 0 ? 0 : random.below(500)));
+        break;
+      case Field::BasicType::FLOAT:
+        state += (random.uniform() - 0.5F) * 0.02F;
+        store<float>(dst, state);
+        break;
+      case Field::BasicType::DOUBLE:
+        state += (random.uniform() - 0.5F) * 0.02F;
+        store<double>(dst, state);
+        break;
+      case Field::BasicType::INT32:
+      case Field::BasicType::UINT32:
+        if (random.below(64) == 0) state += 1.F;
+        store<uint32_t>(dst, static_cast<uint32_t>(state));
+        break;
+      case Field::BasicType::INT16:
+      case Field::BasicType::UINT16:
+        if (random.below(64) == 0) state += 1.F;
+        store<uint16_t>(dst, static_cast<uint16_t>(state));
+        break;
+      case Field::BasicType::INT8:
+      case Field::BasicType::UINT8:
+        if (random.below(256) == 0) state += 1.F;
+        *dst = static_cast<uint8_t>(state);
+        break;
+      case Field::BasicType::CHAR:
+        *dst = static_cast<uint8_t>('a' + (i % 26));
+        break;
+      case Field::BasicType::BOOL:
+        *dst = random.below(1000) == 0 ? 1 : 0;
+        break;
+      case Field::BasicType::NESTED:
+        break;
+    }
+  }
+}
+
+void addTopic(std::vector<Topic>& topics, const std::shared_ptr<MessageFormat>& format,
+              uint8_t multi_id, double rate_hz, const SyntheticLogConfig& config)
+{
+  Topic topic;
+  topic.format = format;
+  topic.multi_id = multi_id;
+  topic.interval_us =
+      std::max<uint64_t>(1, static_cast<uint64_t>(1e6 / (rate_hz * config.rate_scale)));
+  topic.msg_id = static_cast<uint16_t>(topics.size());
+  flattenLeaves(*format, topic.leaves);
+  topic.state.resize(topic.leaves.size());
+  for (size_t i = 0; i < topic.state.size(); ++i) {
+    topic.state[i] = static_cast<float>(i);
+  }
+
+  const int payload_size = format->sizeBytes();
+  ulog_cpp::ulog_message_data_s header;
+  header.msg_size = static_cast<uint16_t>(payload_size + 2);
+  header.msg_id = topic.msg_id;
+  topic.message.resize(sizeof(header) + payload_size);
+  memcpy(topic.message.data(), &header, sizeof(header));
+  topics.push_back(std::move(topic));
+}
+
+}  // namespace
+
+SyntheticLogStats generateSyntheticLog(const SyntheticLogConfig& config,
+                                       const ulog_cpp::DataWriteCB& data_write_cb)
+{
+  SyntheticLogStats stats;
+  Random random(config.seed);
+  Random corruption_random(config.seed + 1);
+  bool in_data_section = false;
+  uint64_t next_corruption = config.corruption_interval_bytes;
+  std::vector<uint8_t> garbage;
+
+  const ulog_cpp::DataWriteCB sink = [&](const uint8_t* data, int length) {
+    if (in_data_section && config.corruption_interval_bytes > 0 &&
+        stats.bytes_written >= next_corruption) {
+      garbage.resize(1 + corruption_random.below(64));
+      for (auto& byte : garbage) {
+        byte = static_cast<uint8_t>(corruption_random.next());
+      }
+      data_write_cb(garbage.data(), static_cast<int>(garbage.size()));
+      stats.bytes_written += garbage.size();
+      next_corruption += config.corruption_interval_bytes;
+      ++stats.num_corruptions;
+    }
+    stats.bytes_written += length;
+    data_write_cb(data, length);
+  };
+  ulog_cpp::Writer writer(sink);
+
+  // Header
+  ulog_cpp::ulog_file_header_s file_header{};
+  memcpy(file_header.magic, ulog_cpp::ulog_file_magic_bytes,
+         sizeof(ulog_cpp::ulog_file_magic_bytes));
+  file_header.magic[7] = 1;
+  ulog_cpp::ulog_message_flag_bits_s flag_bits{};
+  if (config.appended_data_fraction > 0.) {
+    flag_bits.incompat_flags[0] |= ULOG_INCOMPAT_FLAG0_DATA_APPENDED_MASK;
+  }
+  writer.fileHeader(ulog_cpp::FileHeader(file_header, flag_bits));
+  writer.messageInfo(ulog_cpp::MessageInfo("sys_name", "SyntheticLog"));
+  writer.messageInfo(ulog_cpp::MessageInfo("ver_hw", "SITL"));
+  writer.messageInfo(ulog_cpp::MessageInfo("time_ref_utc", 0));
+  const int kNumParameters = 200;
+  for (int i = 0; i < kNumParameters; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "PARAM_%03i", i);
+    if (i % 2 == 0) {
+      writer.parameter(ulog_cpp::Parameter(name, static_cast<int32_t>(i)));
+    } else {
+      writer.parameter(ulog_cpp::Parameter(name, static_cast<float>(i) * 0.1F));
+    }
+  }
+
+  FormatMap formats;
+  std::vector<std::shared_ptr<MessageFormat>> ordered_formats;
+  createBaseFormats(config, formats, ordered_formats);
+  for (int i = 0; i < config.num_extra_topics; ++i) {
+    createRandomFormat(config, i, random, formats, ordered_formats);
+  }
+  for (const auto& format : ordered_formats) {
+    writer.messageFormat(*format);
+  }
+  for (const auto& format : ordered_formats) {
+    format->resolveDefinition(formats);
+  }
+  writer.headerComplete();
+
+  // Subscriptions
+  std::vector<Topic> topics;
+  for (int instance = 0; instance < std::max(1, config.num_instances); ++instance) {
+    addTopic(topics, formats["sensor_accel"], instance, 1000., config);
+  }
+  addTopic(topics, formats["vehicle_attitude"], 0, 250., config);
+  addTopic(topics, formats["vehicle_status"], 0, 5., config);
+  if (config.nested_formats) {
+    addTopic(topics, formats["esc_status"], 0, 100., config);
+  }
+  static const double kRates[] = {1., 5., 10., 50., 100., 250., 500., 1000.};
+  for (int i = 0; i < config.num_extra_topics; ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), "synthetic_topic_%03i", i);
+    const double rate = kRates[random.below(sizeof(kRates) / sizeof(kRates[0]))];
+    const int num_instances = i % 3 == 0 ? std::max(1, config.num_instances) : 1;
+    for (int instance = 0; instance < num_instances; ++instance) {
+      addTopic(topics, formats[name], instance, rate, config);
+    }
+  }
+  for (const auto& topic : topics) {
+    writer.addLoggedMessage(
+        ulog_cpp::AddLoggedMessage(topic.multi_id, topic.msg_id, topic.format->name()));
+  }
+  in_data_section = true;
+
+  // Data, in timestamp order: min-heap of (next timestamp, topic index)
+  using Event = std::pair<uint64_t, size_t>;
+  std::vector<Event> schedule;
+  for (size_t i = 0; i < topics.size(); ++i) {
+    schedule.emplace_back(0, i);
+  }
+  std::make_heap(schedule.begin(), schedule.end(), std::greater<>());
+
+  auto interval_us = [](double interval_s) {
+    return interval_s > 0. ? static_cast<uint64_t>(interval_s * 1e6) : UINT64_MAX;
+  };
+  const uint64_t logging_interval_us = interval_us(config.logging_interval_s);
+  const uint64_t parameter_interval_us = interval_us(config.parameter_change_interval_s);
+  const uint64_t dropout_interval_us = interval_us(config.dropout_interval_s);
+  uint64_t next_logging_us = 0;
+  uint64_t next_parameter_us = parameter_interval_us;
+  uint64_t next_dropout_us = dropout_interval_us;
+
+  const uint64_t main_size = static_cast<uint64_t>(
+      static_cast<double>(config.target_size_bytes) * (1. - config.appended_data_fraction));
+  uint64_t now_us = 0;
+  while (stats.bytes_written < config.target_size_bytes) {
+    if (config.appended_data_fraction > 0. && stats.appended_offset == 0 &&
+        stats.bytes_written >= main_size) {
+      stats.appended_offset = stats.bytes_written;
+    }
+
+    std::pop_heap(schedule.begin(), schedule.end(), std::greater<>());
+    Event& event = schedule.back();
+    now_us = event.first;
+
+    if (now_us >= next_logging_us) {
+      const std::string message = "status report at " + std::to_string(now_us);
+      if (config.tagged_logging) {
+        writer.logging(ulog_cpp::Logging(ulog_cpp::Logging::Level::Info, message, now_us,
+                                         static_cast<uint16_t>(random.below(4))));
+      } else {
+        writer.logging(ulog_cpp::Logging(ulog_cpp::Logging::Level::Info, message, now_us));
+      }
+      next_logging_us += logging_interval_us;
+    }
+
+    if (now_us >= next_parameter_us) {
+      const int index = static_cast<int>(random.below(kNumParameters));
+      char name[16];
+      snprintf(name, sizeof(name), "PARAM_%03i", index);
+      if (index % 2 == 0) {
+        writer.parameter(ulog_cpp::Parameter(name, static_cast<int32_t>(random.below(1000))));
+      } else {
+        writer.parameter(ulog_cpp::Parameter(name, random.uniform()));
+      }
+      next_parameter_us += parameter_interval_us;
+    }
+
+    if (now_us >= next_dropout_us) {
+      // Drop all samples for the duration of the dropout
+      const uint16_t duration_ms = 10 + random.below(190);
+      writer.dropout(ulog_cpp::Dropout(duration_ms));
+      ++stats.num_dropouts;
+      const uint64_t resume_us = now_us + duration_ms * 1000ULL;
+      for (auto& scheduled : schedule) {
+        const uint64_t interval = topics[scheduled.second].interval_us;
+        while (scheduled.first < resume_us) {
+          scheduled.first += interval;
+        }
+      }
+      std::make_heap(schedule.begin(), schedule.end(), std::greater<>());
+      next_dropout_us = resume_us + dropout_interval_us / 2 + random.below(dropout_interval_us);
+      continue;
+    }
+
+    Topic& topic = topics[event.second];
+    fillPayload(topic, now_us, random);
+    sink(topic.message.data(), static_cast<int>(topic.message.size()));
+    ++stats.num_data_messages;
+    event.first += topic.interval_us;
+    std::push_heap(schedule.begin(), schedule.end(), std::greater<>());
+  }
+  stats.duration_us = now_us;
+  return stats;
+}
+
+std::vector<uint8_t> generateSyntheticLog(const SyntheticLogConfig& config)
+{
+  std::vector<uint8_t> log;
+  log.reserve(config.target_size_bytes + 4096);
+  const SyntheticLogStats stats =
+      generateSyntheticLog(config, [&log](const uint8_t* data, int length) {
+        log.insert(log.end(), data, data + length);
+      });
+  if (stats.appended_offset != 0) {
+    memcpy(log.data() + kAppendedOffsetPosition, &stats.appended_offset,
+           sizeof(stats.appended_offset));
+  }
+  return log;
+}
+
+SyntheticLogStats generateSyntheticLogFile(const SyntheticLogConfig& config,
+                                           const std::string& filename)
+{
+  std::FILE* file = std::fopen(filename.c_str(), "wb");
+  if (!file) {
+    throw ulog_cpp::UsageException("Failed to open file " + filename);
+  }
+  std::vector<char> file_buffer(4 * 1024 * 1024);
+  setvbuf(file, file_buffer.data(), _IOFBF, file_buffer.size());
+  SyntheticLogStats stats;
+  try {
+    stats = generateSyntheticLog(config, [file](const uint8_t* data, int length) {
+      if (std::fwrite(data, 1, length, file) != static_cast<size_t>(length)) {
+        throw ulog_cpp::ParsingException("Failed to write synthetic log");
+      }
+    });
+    if (stats.appended_offset != 0) {
+      if (std::fseek(file, kAppendedOffsetPosition, SEEK_SET) != 0 ||
+          std::fwrite(&stats.appended_offset, sizeof(stats.appended_offset), 1, file) != 1) {
+        throw ulog_cpp::ParsingException("Failed to write appended offset");
+      }
+    }
+  } catch (...) {
+    std::fclose(file);
+    throw;
+  }
+  std::fclose(file);
+  return stats;
+}
+
+}  // namespace benchmark
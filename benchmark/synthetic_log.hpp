@@ -0,0 +1,108 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <ulog_cpp/messages.hpp>
+#include <vector>
+
+namespace benchmark {
+
+/**
+ * Configuration of a synthetic ULog file. The generated content only depends on this struct,
+ * so identical configurations produce byte-identical logs.
+ */
+struct SyntheticLogConfig {
+  uint64_t target_size_bytes{10 * 1024 * 1024};  ///< stop once the log reaches this size
+  uint32_t seed{1};                              ///< seed for the pseudo-random content
+
+  int num_extra_topics{0};    ///< number of additional topics with pseudo-random formats
+  double rate_scale{1.};      ///< scale factor applied to all topic rates
+  int num_instances{2};       ///< number of instances (multi_id) of multi-instance topics
+  bool nested_formats{true};  ///< include topics with nested formats
+
+  double dropout_interval_s{0.};           ///< mean log time between dropouts, 0 to disable
+  uint64_t corruption_interval_bytes{0};   ///< insert garbage every N bytes, 0 to disable
+  double logging_interval_s{10.};          ///< log time between logged strings, 0 to disable
+  bool tagged_logging{false};              ///< write tagged logged strings
+  double parameter_change_interval_s{0.};  ///< log time between parameter changes, 0 to disable
+
+  /**
+   * Fraction of the target size written as appended data (after the offset stored in the flag
+   * bits message), 0 to disable. Requires patching the header after writing, which the file and
+   * memory variants of generateSyntheticLog() do automatically.
+   */
+  double appended_data_fraction{0.};
+};
+
+struct SyntheticLogStats {
+  uint64_t bytes_written{0};
+  uint64_t num_data_messages{0};
+  uint64_t num_dropouts{0};
+  uint64_t num_corruptions{0};
+  uint64_t duration_us{0};      ///< log time covered by the data
+  uint64_t appended_offset{0};  ///< file offset of the appended data, 0 if none
+};
+
+/**
+ * Offset of flag_bits.appended_offsets[0] in a ULog file
+ */
+static constexpr uint64_t kAppendedOffsetPosition =
+    sizeof(ulog_cpp::ulog_file_header_s) + ULOG_MSG_HEADER_LEN + 16;
+
+/**
+ * Write a synthetic log to a sink. The log contains a mix of small high-rate topics, wide
+ * low-rate topics, nested formats with arrays of nested elements, multi-instance topics, info
+ * messages, parameters and logged strings, similar to what the PX4 logger produces.
+ *
+ * If appended data is enabled, stats.appended_offset must be patched into the file at
+ * kAppendedOffsetPosition after writing.
+ */
+SyntheticLogStats generateSyntheticLog(const SyntheticLogConfig& config,
+                                       const ulog_cpp::DataWriteCB& data_write_cb);
+
+/**
+ * Generate a synthetic log into memory.
+ */
+std::vector<uint8_t> generateSyntheticLog(const SyntheticLogConfig& config);
+
+/**
+ * Generate a synthetic log into a file.
+ */
+SyntheticLogStats generateSyntheticLogFile(const SyntheticLogConfig& config,
+                                           const std::string& filename);
+
+/**
+ * Small deterministic pseudo-random number generator (xorshift64*), so that generated logs do not
+ * depend on the standard library implementation.
+ */
+class Random {
+ public:
+  explicit Random(uint64_t seed) : _state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+  uint64_t next()
+  {
+    _state ^= _state >> 12;
+    _state ^= _state << 25;
+    _state ^= _state >> 27;
+    return _state * 0x2545F4914F6CDD1DULL;
+  }
+
+  /**
+   * @return uniformly distributed value in [0, 1)
+   */
+  float uniform() { return static_cast<float>(next() >> 40) / static_cast<float>(1 << 24); }
+
+  /**
+   * @return uniformly distributed value in [0, max)
+   */
+  uint32_t below(uint32_t max) { return static_cast<uint32_t>(next() % max); }
+
+ private:
+  uint64_t _state;
+};
+
+}  // namespace benchmark
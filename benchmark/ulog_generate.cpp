@@ -0,0 +1,103 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <ulog_cpp/exception.hpp>
+
+#include "synthetic_log.hpp"
+
+static void usage(const char* name)
+{
+  printf("Usage: %s [options] <file.ulg>\n", name);
+  printf("Generate a deterministic synthetic ULog file.\n");
+  printf("  --size-mb <n>                 target file size (default 10)\n");
+  printf("  --seed <n>                    seed for the pseudo-random content (default 1)\n");
+  printf("  --topics <n>                  additional topics with random formats (default 0)\n");
+  printf("  --rate-scale <f>              scale factor for all topic rates (default 1)\n");
+  printf("  --instances <n>               instances of multi-instance topics (default 2)\n");
+  printf("  --no-nested                   do not use nested formats\n");
+  printf("  --dropout-interval <s>        mean time between dropouts (default 0: none)\n");
+  printf("  --corruption-interval-kb <n>  insert garbage every n KiB (default 0: none)\n");
+  printf("  --logging-interval <s>        time between logged strings (default 10)\n");
+  printf("  --tagged-logging              write tagged logged strings\n");
+  printf("  --param-change-interval <s>   time between parameter changes (default 0: none)\n");
+  printf("  --appended-fraction <f>       fraction of the file written as appended data\n");
+}
+
+int main(int argc, char** argv)
+{
+  benchmark::SyntheticLogConfig config;
+  std::string filename;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto next = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        usage(argv[0]);
+        exit(-1);
+      }
+      return argv[++i];
+    };
+    if (arg == "--size-mb") {
+      config.target_size_bytes = static_cast<uint64_t>(std::stod(next()) * 1024 * 1024);
+    } else if (arg == "--seed") {
+      config.seed = std::stoul(next());
+    } else if (arg == "--topics") {
+      config.num_extra_topics = std::stoi(next());
+    } else if (arg == "--rate-scale") {
+      config.rate_scale = std::stod(next());
+    } else if (arg == "--instances") {
+      config.num_instances = std::stoi(next());
+    } else if (arg == "--no-nested") {
+      config.nested_formats = false;
+    } else if (arg == "--dropout-interval") {
+      config.dropout_interval_s = std::stod(next());
+    } else if (arg == "--corruption-interval-kb") {
+      config.corruption_interval_bytes = std::stoull(next()) * 1024;
+    } else if (arg == "--logging-interval") {
+      config.logging_interval_s = std::stod(next());
+    } else if (arg == "--tagged-logging") {
+      config.tagged_logging = true;
+    } else if (arg == "--param-change-interval") {
+      config.parameter_change_interval_s = std::stod(next());
+    } else if (arg == "--appended-fraction") {
+      config.appended_data_fraction = std::stod(next());
+    } else if (arg[0] != '-' && filename.empty()) {
+      filename = arg;
+    } else {
+      usage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : -1;
+    }
+  }
+  if (filename.empty()) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  try {
+    const auto start = std::chrono::steady_clock::now();
+    const benchmark::SyntheticLogStats stats =
+        benchmark::generateSyntheticLogFile(config, filename);
+    const double elapsed_s =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Wrote %s: %" PRIu64 " bytes in %.2f s (%.1f MB/s)\n", filename.c_str(),
+           stats.bytes_written, elapsed_s,
+           static_cast<double>(stats.bytes_written) / elapsed_s / 1e6);
+    printf("  data messages:   %" PRIu64 "\n", stats.num_data_messages);
+    printf("  log duration:    %.1f s\n", static_cast<double>(stats.duration_us) / 1e6);
+    printf("  dropouts:        %" PRIu64 "\n", stats.num_dropouts);
+    printf("  corruptions:     %" PRIu64 "\n", stats.num_corruptions);
+    if (stats.appended_offset != 0) {
+      printf("  appended offset: %" PRIu64 "\n", stats.appended_offset);
+    }
+  } catch (const ulog_cpp::ExceptionBase& e) {
+    printf("ULog exception: %s\n", e.what());
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,208 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+// Generates a C++ header with packed structs and MessageTraits for all message formats of a log,
+// for use with TypedSubscription and SimpleWriter::writeData().
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <ulog_cpp/data_container.hpp>
+#include <ulog_cpp/reader.hpp>
+#include <vector>
+
+namespace {
+
+// ULOG_CPP_MESSAGE_TRAITS() limit
+constexpr int kMaxTraitsFields = 120;
+
+const std::set<std::string> kKeywords = {
+    "alignas", "alignof", "and", "asm", "auto", "bool", "break", "case", "catch", "char", "class",
+    "const", "continue", "default", "delete", "do", "double", "else", "enum", "explicit", "export",
+    "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable",
+    "namespace", "new", "not", "nullptr", "operator", "or", "private", "protected", "public",
+    "register", "return", "short", "signed", "sizeof", "static", "struct", "switch", "template",
+    "this", "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using",
+    "virtual", "void", "volatile", "while", "xor"};
+
+std::string identifier(const std::string& name)
+{
+  std::string ret;
+  for (const char c : name) {
+    ret += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+  }
+  if (ret.empty() || std::isdigit(static_cast<unsigned char>(ret[0]))) {
+    ret = "_" + ret;
+  }
+  if (kKeywords.count(ret) > 0) {
+    ret += "_";
+  }
+  return ret;
+}
+
+std::string cppType(const ulog_cpp::Field& field)
+{
+  if (field.type().type == ulog_cpp::Field::BasicType::NESTED) {
+    return identifier(field.type().name);
+  }
+  // Basic ULog type names are C++ types
+  return field.type().name;
+}
+
+class Generator {
+ public:
+  Generator(const std::map<std::string, std::shared_ptr<ulog_cpp::MessageFormat>>& formats,
+            std::string name_space)
+      : _formats(formats), _namespace(std::move(name_space))
+  {
+  }
+
+  std::string generate(const std::string& source)
+  {
+    for (const auto& [name, format] : _formats) {
+      visit(name);
+    }
+
+    std::ostringstream out;
+    out << "// Generated by ulog_codegen from " << source << ". Do not edit.\n";
+    out << "#pragma once\n\n";
+    out << "#include <cstdint>\n";
+    out << "#include <ulog_cpp/message_traits.hpp>\n\n";
+    out << "namespace " << _namespace << " {\n\n";
+    out << "#pragma pack(push, 1)\n";
+    for (const auto& format : _ordered) {
+      out << "\nstruct " << identifier(format->name()) << " {\n";
+      for (const auto& field : format->fields()) {
+        out << "  " << cppType(*field) << " " << identifier(field->name());
+        if (field->arrayLength() >= 0) {
+          out << "[" << field->arrayLength() << "]";
+        }
+        out << ";\n";
+      }
+      out << "};\n";
+    }
+    out << "\n#pragma pack(pop)\n\n";
+    out << "}  // namespace " << _namespace << "\n\n";
+
+    // Traits in the same order, as nested traits must be declared first
+    std::set<std::string> without_traits;
+    for (const auto& format : _ordered) {
+      std::string reason;
+      if (static_cast<int>(format->fields().size()) > kMaxTraitsFields) {
+        reason = "too many fields";
+      }
+      for (const auto& field : format->fields()) {
+        // The traits use the member name as field name
+        if (identifier(field->name()) != field->name()) {
+          reason = "field " + field->name() + " is not a valid identifier";
+        }
+        if (field->type().type == ulog_cpp::Field::BasicType::NESTED &&
+            without_traits.count(field->type().name) > 0) {
+          reason = "nested type " + field->type().name + " has no traits";
+        }
+      }
+      if (!reason.empty()) {
+        without_traits.insert(format->name());
+        out << "// No traits for " << format->name() << ": " << reason << "\n";
+        continue;
+      }
+      out << "ULOG_CPP_MESSAGE_TRAITS(" << _namespace << "::" << identifier(format->name())
+          << ", \"" << format->name() << "\"";
+      for (const auto& field : format->fields()) {
+        out << ", " << identifier(field->name());
+      }
+      out << ")\n";
+    }
+    return out.str();
+  }
+
+ private:
+  /**
+   * Depth-first traversal, adding nested formats before the formats using them
+   */
+  void visit(const std::string& name)
+  {
+    if (_visited.count(name) > 0) {
+      return;
+    }
+    _visited.insert(name);
+    const auto format_iter = _formats.find(name);
+    if (format_iter == _formats.end()) {
+      throw ulog_cpp::ParsingException("Format not found: " + name);
+    }
+    for (const auto& field : format_iter->second->fields()) {
+      if (field->type().type == ulog_cpp::Field::BasicType::NESTED) {
+        visit(field->type().name);
+      }
+    }
+    _ordered.push_back(format_iter->second);
+  }
+
+  const std::map<std::string, std::shared_ptr<ulog_cpp::MessageFormat>>& _formats;
+  const std::string _namespace;
+  std::set<std::string> _visited;
+  std::vector<std::shared_ptr<ulog_cpp::MessageFormat>> _ordered;
+};
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    printf("Usage: %s <file.ulg> [<output.hpp> [<namespace>]]\n", argv[0]);
+    return -1;
+  }
+  FILE* file = fopen(argv[1], "rb");
+  if (!file) {
+    printf("opening file failed\n");
+    return -1;
+  }
+  // Only the definitions section is needed
+  uint8_t buffer[4048];
+  int bytes_read;
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::Header);
+  ulog_cpp::Reader reader{data_container};
+  while (!data_container->isHeaderComplete() &&
+         (bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    reader.readChunk(buffer, bytes_read);
+  }
+  fclose(file);
+
+  for (const auto& parsing_error : data_container->parsingErrors()) {
+    fprintf(stderr, "Parsing error: %s\n", parsing_error.c_str());
+  }
+  if (data_container->hadFatalError() || data_container->messageFormats().empty()) {
+    fprintf(stderr, "Failed to read the message formats\n");
+    return -1;
+  }
+
+  const std::string name_space = argc > 3 ? identifier(argv[3]) : "ulog_topics";
+  std::string header;
+  try {
+    Generator generator(data_container->messageFormats(), name_space);
+    header = generator.generate(argv[1]);
+  } catch (const ulog_cpp::ExceptionBase& exception) {
+    fprintf(stderr, "Error: %s\n", exception.what());
+    return -1;
+  }
+
+  if (argc > 2) {
+    std::ofstream output(argv[2]);
+    output << header;
+    if (!output) {
+      fprintf(stderr, "Failed to write %s\n", argv[2]);
+      return -1;
+    }
+  } else {
+    std::cout << header;
+  }
+  return 0;
+}
@@ -18,26 +18,14 @@ static uint64_t currentTimeUs()
 }
 
 struct MyData {
-  uint64_t timestamp;
+  uint64_t timestamp;  // Monotonic timestamp in microseconds (since boot), must be the first field
   float debug_array[4];
   float cpuload;
   float temperature;
   int8_t counter;
-
-  static std::string messageName() { return "my_data"; }
-
-  static std::vector<ulog_cpp::Field> fields()
-  {
-    // clang-format off
-    return {
-        {"uint64_t", "timestamp"}, // Monotonic timestamp in microseconds (since boot), must always be the first field
-        {"float", "debug_array", 4},
-        {"float", "cpuload"},
-        {"float", "temperature"},
-        {"int8_t", "counter"},
-    };  // clang-format on
-  }
 };
+// Describes the format, which is then validated at compile-time
+ULOG_CPP_MESSAGE_TRAITS(MyData, "my_data", timestamp, debug_array, cpuload, temperature, counter)
 
 int main(int argc, char** argv)
 {
@@ -55,10 +43,10 @@ int main(int argc, char** argv)
     writer.writeParameter("PARAM_A", 382.23F);
     writer.writeParameter("PARAM_B", 8272);
 
-    writer.writeMessageFormat(MyData::messageName(), MyData::fields());
+    writer.writeMessageFormat<MyData>();
     writer.headerComplete();
 
-    const uint16_t my_data_msg_id = writer.writeAddLoggedMessage(MyData::messageName());
+    const auto my_data_msg_id = writer.writeAddLoggedMessage<MyData>();
 
     writer.writeTextMessage(ulog_cpp::Logging::Level::Info, "Hello world", currentTimeUs());
 
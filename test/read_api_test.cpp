@@ -4,9 +4,20 @@
  ****************************************************************************/
 #include <doctest/doctest.h>
 
+#include <cmath>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <limits>
 #include <ulog_cpp/data_container.hpp>
+#include <ulog_cpp/lod_pyramid.hpp>
+#include <ulog_cpp/mapped_file.hpp>
+#include <ulog_cpp/merge_iterator.hpp>
+#include <ulog_cpp/parameter_timeline.hpp>
 #include <ulog_cpp/reader.hpp>
+#include <ulog_cpp/resample.hpp>
+#include <ulog_cpp/simple_writer.hpp>
+#include <ulog_cpp/typed_subscription.hpp>
 #include <ulog_cpp/writer.hpp>
 #include <vector>
 
@@ -23,6 +34,70 @@ class TestWriter : public ulog_cpp::Writer {
  private:
 };
 
+struct SensorSample {
+  uint64_t timestamp;
+  float values[3];
+  int16_t status;
+  uint8_t flags;
+};
+ULOG_CPP_MESSAGE_TRAITS(SensorSample, "sensor_sample", timestamp, values, status, flags)
+
+struct AlignedSample {
+  uint64_t timestamp;
+  double value;
+};
+ULOG_CPP_MESSAGE_TRAITS(AlignedSample, "aligned_sample", timestamp, value)
+
+struct OtherSample {
+  uint64_t timestamp;
+  float value;
+  float other_value;
+};
+ULOG_CPP_MESSAGE_TRAITS(OtherSample, "sensor_sample", timestamp, value, other_value)
+
+struct MergeSample {
+  uint64_t timestamp;
+  uint64_t timestamp_sample;
+  int32_t value;
+};
+ULOG_CPP_MESSAGE_TRAITS(MergeSample, "merge_sample", timestamp, timestamp_sample, value)
+
+// As generated by ulog_codegen for test/log_files/sample.ulg
+struct ActuatorOutputs {
+  uint64_t timestamp;
+  uint32_t noutputs;
+  float output[16];
+  uint8_t _padding0[4];
+};
+ULOG_CPP_MESSAGE_TRAITS(ActuatorOutputs, "actuator_outputs", timestamp, noutputs, output,
+                        _padding0)
+
+namespace {
+
+std::string sampleLogPath()
+{
+  const std::string src_file_path = __FILE__;
+  return src_file_path.substr(0, src_file_path.rfind('/')) + "/log_files/sample.ulg";
+}
+
+std::vector<uint8_t> readSampleLog()
+{
+  std::ifstream file(sampleLogPath(), std::ios::binary);
+  REQUIRE(file);
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+std::shared_ptr<ulog_cpp::DataContainer> parseFullLog(const std::vector<uint8_t>& data)
+{
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(data.data(), static_cast<int>(data.size()));
+  return data_container;
+}
+
+}  // namespace
+
 TEST_SUITE_BEGIN("[ULog Access]");
 
 TEST_CASE("Write complicated, nested data format, then read it")
@@ -267,4 +342,916 @@ TEST_CASE("Write complicated, nested data format, then read it")
                   ulog_cpp::AccessException);
 }
 
+TEST_CASE("Typed subscription")
+{
+  const int kNumSamples = 100;
+  std::vector<uint8_t> written_data;
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) {
+          written_data.insert(written_data.end(), data, data + length);
+        },
+        0);
+    writer.writeMessageFormat<SensorSample>();
+    writer.writeMessageFormat<AlignedSample>();
+    writer.headerComplete();
+    const auto sensor_id = writer.writeAddLoggedMessage<SensorSample>();
+    const auto aligned_id = writer.writeAddLoggedMessage<AlignedSample>();
+    for (int i = 0; i < kNumSamples; ++i) {
+      writer.writeData(sensor_id, SensorSample{static_cast<uint64_t>(i),
+                                               {1.F * i, 2.F * i, 3.F * i},
+                                               static_cast<int16_t>(-i),
+                                               static_cast<uint8_t>(i % 3)});
+      writer.writeData(aligned_id, AlignedSample{static_cast<uint64_t>(i), 0.5 * i});
+    }
+  }
+
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(written_data.data(), static_cast<int>(written_data.size()));
+  REQUIRE(data_container->parsingErrors().empty());
+
+  // With tail padding: copied
+  const ulog_cpp::TypedSubscription<SensorSample> sensor(
+      data_container->subscription("sensor_sample"));
+  REQUIRE_EQ(sensor.size(), kNumSamples);
+  CHECK_FALSE(sensor.zeroCopy());
+  CHECK_THROWS_AS(sensor.ref(0), ulog_cpp::UsageException);
+  CHECK_THROWS_AS(sensor.at(kNumSamples), ulog_cpp::AccessException);
+  int i = 0;
+  for (const SensorSample& sample : sensor) {
+    CHECK_EQ(sample.timestamp, i);
+    CHECK_EQ(sample.values[2], 3.F * i);
+    CHECK_EQ(sample.status, -i);
+    CHECK_EQ(sample.flags, i % 3);
+    ++i;
+  }
+  CHECK_EQ(i, kNumSamples);
+  CHECK_EQ(sensor.at(42).values[1], 84.F);
+
+  // Without tail padding: zero-copy
+  const ulog_cpp::TypedSubscription<AlignedSample> aligned(
+      data_container->subscription("aligned_sample"));
+  CHECK(aligned.zeroCopy());
+  CHECK_EQ(aligned.ref(10).value, 5.0);
+  CHECK_EQ(reinterpret_cast<const uint8_t*>(&aligned.ref(10)),
+           data_container->subscription("aligned_sample")->rawSamples()[10].data().data());
+  CHECK_THROWS_AS(aligned.ref(aligned.size()), ulog_cpp::AccessException);
+
+  // Compressed: decoded block-wise, without zero-copy access
+  const auto compressed_subscription =
+      std::make_shared<ulog_cpp::Subscription>(*data_container->subscription("aligned_sample"));
+  compressed_subscription->compress(16);
+  const ulog_cpp::TypedSubscription<AlignedSample> compressed(compressed_subscription);
+  CHECK_FALSE(compressed.zeroCopy());
+  CHECK_THROWS_AS(compressed.ref(0), ulog_cpp::UsageException);
+  i = 0;
+  for (const AlignedSample& sample : compressed) {
+    CHECK_EQ(sample.value, 0.5 * i++);
+  }
+  CHECK_EQ(i, kNumSamples);
+  CHECK_EQ(compressed[42].value, 21.0);
+  CHECK_EQ((compressed.begin() + 99)[-90].timestamp, 9);
+  CHECK_FALSE(compressed_subscription->isDecoded());
+
+  // Mismatching layouts are rejected at bind time
+  CHECK_THROWS_AS(ulog_cpp::TypedSubscription<OtherSample>(
+                      data_container->subscription("sensor_sample")),
+                  ulog_cpp::UsageException);
+  CHECK_FALSE(ulog_cpp::TypedSubscription<AlignedSample>::incompatibility(
+                  *data_container->subscription("sensor_sample")->format())
+                  .empty());
+}
+
+TEST_CASE("Typed subscription without trailing padding")
+{
+  const auto data_container = parseFullLog(readSampleLog());
+
+  // PX4 does not log the trailing padding field
+  const auto subscription = data_container->subscription("actuator_outputs");
+  REQUIRE_GT(subscription->size(), 0);
+  CHECK_LT(subscription->rawSamples()[0].data().size(), sizeof(ActuatorOutputs));
+  const ulog_cpp::TypedSubscription<ActuatorOutputs> actuator_outputs(subscription);
+  CHECK_FALSE(actuator_outputs.zeroCopy());
+  for (size_t i = 0; i < actuator_outputs.size(); ++i) {
+    const ActuatorOutputs sample = actuator_outputs[i];
+    CHECK_EQ(sample.timestamp, subscription->at(i)["timestamp"].as<uint64_t>());
+    CHECK_EQ(sample.output[1], subscription->at(i)["output"][1].as<float>());
+    CHECK_EQ(sample._padding0[3], 0);
+  }
+}
+
+TEST_CASE("Merge iterator")
+{
+  // Instance i logs every (i+1)*10 us, with samples at equal timestamps
+  const int kNumInstances = 3;
+  const uint64_t kDuration = 1000;
+  std::vector<uint8_t> written_data;
+  int num_samples = 0;
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) {
+          written_data.insert(written_data.end(), data, data + length);
+        },
+        0);
+    writer.writeMessageFormat<MergeSample>();
+    writer.headerComplete();
+    std::vector<ulog_cpp::MessageId<MergeSample>> ids;
+    for (int i = 0; i < kNumInstances; ++i) {
+      ids.push_back(writer.writeAddLoggedMessage<MergeSample>(i));
+    }
+    for (int i = 0; i < kNumInstances; ++i) {
+      const uint64_t interval = (i + 1) * 10;
+      for (uint64_t t = interval; t <= kDuration; t += interval) {
+        writer.writeData(ids[i], MergeSample{t, t - 5, i});
+        ++num_samples;
+      }
+    }
+  }
+
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(written_data.data(), static_cast<int>(written_data.size()));
+  REQUIRE(data_container->parsingErrors().empty());
+  std::vector<std::shared_ptr<ulog_cpp::Subscription>> subscriptions;
+  for (int i = 0; i < kNumInstances; ++i) {
+    subscriptions.push_back(data_container->subscription("merge_sample", i));
+  }
+
+  SUBCASE("Global order")
+  {
+    int count = 0;
+    uint64_t last_timestamp = 0;
+    int last_index = -1;
+    for (const ulog_cpp::MergedSample& sample : ulog_cpp::MergeIterator(subscriptions)) {
+      CHECK_EQ(sample.timestamp, sample.data["timestamp"].as<uint64_t>());
+      CHECK_EQ(sample.data["value"].as<int>(), sample.subscription_index);
+      CHECK_EQ(&sample.subscription, subscriptions[sample.subscription_index].get());
+      const bool ordered = sample.timestamp > last_timestamp ||
+                           (sample.timestamp == last_timestamp &&
+                            sample.subscription_index > last_index);
+      CHECK(ordered);
+      last_timestamp = sample.timestamp;
+      last_index = sample.subscription_index;
+      ++count;
+    }
+    CHECK_EQ(count, num_samples);
+  }
+
+  SUBCASE("Compressed subscriptions are decoded block-wise")
+  {
+    for (const auto& subscription : subscriptions) {
+      subscription->compress(16);
+    }
+    std::vector<ulog_cpp::MergedSample> samples;
+    for (const ulog_cpp::MergedSample& sample : ulog_cpp::MergeIterator(subscriptions)) {
+      samples.push_back(sample);
+    }
+    CHECK_EQ(samples.size(), num_samples);
+    // The samples stay valid after the iterator moved on
+    for (const auto& sample : samples) {
+      CHECK_EQ(sample.timestamp, sample.data["timestamp"].as<uint64_t>());
+      CHECK_EQ(sample.data["value"].as<int>(), sample.subscription_index);
+    }
+    for (const auto& subscription : subscriptions) {
+      CHECK_FALSE(subscription->isDecoded());
+    }
+  }
+
+  SUBCASE("Window start and seek")
+  {
+    ulog_cpp::MergeIterator merge_iterator(subscriptions, 55);
+    REQUIRE_FALSE(merge_iterator.done());
+    CHECK_EQ((*merge_iterator).timestamp, 60);
+    CHECK_EQ((*merge_iterator).subscription_index, 0);
+    ++merge_iterator;
+    CHECK_EQ((*merge_iterator).timestamp, 60);
+    CHECK_EQ((*merge_iterator).subscription_index, 1);
+    ++merge_iterator;
+    CHECK_EQ((*merge_iterator).subscription_index, 2);
+    ++merge_iterator;
+    CHECK_EQ((*merge_iterator).timestamp, 70);
+
+    merge_iterator.seek(kDuration);
+    int count = 0;
+    for (; !merge_iterator.done(); ++merge_iterator) {
+      CHECK_EQ((*merge_iterator).timestamp, kDuration);
+      ++count;
+    }
+    CHECK_EQ(count, 2);  // 1000 is not a multiple of 30
+    merge_iterator.seek(kDuration + 1);
+    CHECK(merge_iterator.done());
+  }
+
+  SUBCASE("Other timestamp field")
+  {
+    ulog_cpp::MergeIterator merge_iterator(subscriptions, 0, "timestamp_sample");
+    CHECK_EQ((*merge_iterator).timestamp, 5);
+    CHECK_EQ((*merge_iterator).data["timestamp"].as<uint64_t>(), 10);
+    CHECK_THROWS_AS(ulog_cpp::MergeIterator(subscriptions, 0, "value"),
+                    ulog_cpp::UsageException);
+    CHECK_THROWS_AS(ulog_cpp::MergeIterator(subscriptions, 0, "missing"),
+                    ulog_cpp::AccessException);
+  }
+}
+
+TEST_CASE("Resampling")
+{
+  // Samples every 10 us with a gap from 30 to 100, values[1] = 2 * timestamp
+  const std::vector<uint64_t> timestamps = {0, 10, 20, 30, 100, 110};
+  std::vector<uint8_t> written_data;
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) {
+          written_data.insert(written_data.end(), data, data + length);
+        },
+        0);
+    writer.writeMessageFormat<SensorSample>();
+    writer.writeMessageFormat<AlignedSample>();
+    writer.headerComplete();
+    const auto sensor_id = writer.writeAddLoggedMessage<SensorSample>();
+    const auto aligned_id = writer.writeAddLoggedMessage<AlignedSample>();
+    for (const uint64_t t : timestamps) {
+      writer.writeData(sensor_id,
+                       SensorSample{t, {0.F, 2.F * t, 0.F}, static_cast<int16_t>(-t), 0});
+      writer.writeData(aligned_id, AlignedSample{t + 5, 1.0 * t});
+    }
+  }
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(written_data.data(), static_cast<int>(written_data.size()));
+  REQUIRE(data_container->parsingErrors().empty());
+  const auto sensor = data_container->subscription("sensor_sample");
+
+  CHECK_EQ(ulog_cpp::timestampColumn(*sensor), timestamps);
+  const std::vector<double> values = ulog_cpp::column(*sensor, "values", 1);
+  CHECK_EQ(values[3], 60.);
+  CHECK_EQ(ulog_cpp::column(*sensor, "status")[4], -100.);
+  CHECK_THROWS_AS(ulog_cpp::column(*sensor, "values", 3), ulog_cpp::AccessException);
+  CHECK_THROWS_AS(ulog_cpp::timestampColumn(*sensor, "status"), ulog_cpp::UsageException);
+
+  // Several columns in a single pass, block-wise for compressed samples
+  ulog_cpp::Subscription compressed_sensor(*sensor);
+  compressed_sensor.compress(4);
+  CHECK_EQ(ulog_cpp::timestampColumn(compressed_sensor), timestamps);
+  const auto columns = ulog_cpp::columns(
+      compressed_sensor, {{compressed_sensor.field("values")->offsetInMessage() + 4,
+                           ulog_cpp::Field::BasicType::FLOAT},
+                          {compressed_sensor.field("status")->offsetInMessage(),
+                           ulog_cpp::Field::BasicType::INT16}});
+  REQUIRE_EQ(columns.size(), 2);
+  CHECK_EQ(columns[0], values);
+  CHECK_EQ(columns[1], ulog_cpp::column(*sensor, "status"));
+  CHECK_FALSE(compressed_sensor.isDecoded());
+
+  const std::vector<uint64_t> expected_timestamps = {0, 4000, 8000};
+  CHECK_EQ(ulog_cpp::uniformTimestamps(0, 10000, 250.), expected_timestamps);
+  const std::vector<uint64_t> expected_rounded = {0, 3, 7, 10};
+  CHECK_EQ(ulog_cpp::uniformTimestamps(0, 10, 3e5), expected_rounded);
+
+  const std::vector<uint64_t> targets = {0, 5, 14, 16, 50, 110, 200};
+  auto resample = [&](ulog_cpp::Interpolation interpolation, uint64_t max_gap_us) {
+    ulog_cpp::ResampleOptions options;
+    options.interpolation = interpolation;
+    options.max_gap_us = max_gap_us;
+    return ulog_cpp::ResampleIndex(timestamps, targets, options).apply(values);
+  };
+
+  SUBCASE("Zero-order hold")
+  {
+    auto result = resample(ulog_cpp::Interpolation::ZeroOrderHold, 0);
+    const std::vector<double> expected = {0., 0., 20., 20., 60., 220., 220.};
+    CHECK_EQ(result, expected);
+    result = resample(ulog_cpp::Interpolation::ZeroOrderHold, 20);
+    CHECK(std::isnan(result[4]));
+    CHECK_EQ(result[5], 220.);
+    CHECK(std::isnan(result[6]));
+  }
+
+  SUBCASE("Linear")
+  {
+    auto result = resample(ulog_cpp::Interpolation::Linear, 0);
+    CHECK_EQ(result[0], 0.);
+    CHECK_EQ(result[1], 10.);
+    CHECK_EQ(result[2], doctest::Approx(28.));
+    CHECK_EQ(result[4], doctest::Approx(100.));
+    CHECK_EQ(result[5], 220.);
+    CHECK(std::isnan(result[6]));
+    result = resample(ulog_cpp::Interpolation::Linear, 20);
+    CHECK(std::isnan(result[4]));
+    CHECK_EQ(result[5], 220.);
+  }
+
+  SUBCASE("Nearest")
+  {
+    auto result = resample(ulog_cpp::Interpolation::Nearest, 0);
+    const std::vector<double> expected = {0., 0., 20., 40., 60., 220., 220.};
+    CHECK_EQ(result, expected);
+    result = resample(ulog_cpp::Interpolation::Nearest, 20);
+    CHECK(std::isnan(result[4]));
+    CHECK(std::isnan(result[6]));
+    CHECK_EQ(result[3], 40.);
+  }
+
+  SUBCASE("Multiple subscriptions")
+  {
+    ulog_cpp::Resampler resampler(ulog_cpp::uniformTimestamps(10, 30, 1e5),
+                                  {ulog_cpp::Interpolation::Linear});
+    const auto sensor_values = resampler.resample(sensor, "values", 1);
+    const auto aligned_values =
+        resampler.resample(data_container->subscription("aligned_sample"), "value");
+    const std::vector<double> expected = {20., 40., 60.};
+    CHECK_EQ(sensor_values, expected);
+    CHECK_EQ(aligned_values[0], 5.);
+    CHECK_EQ(aligned_values[1], 15.);
+    CHECK_EQ(resampler.index(sensor).sourceSize(), timestamps.size());
+  }
+}
+
+TEST_CASE("Global message index")
+{
+  const auto data = readSampleLog();
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  data_container->enableMessageIndex();
+  ulog_cpp::Reader reader{data_container};
+  // Finalize in between, to merge incrementally
+  const size_t half = data.size() / 2;
+  reader.readChunk(data.data(), static_cast<int>(half));
+  const size_t first_size = data_container->messageIndex().size();
+  reader.readChunk(data.data() + half, static_cast<int>(data.size() - half));
+  const ulog_cpp::MessageIndex& index = data_container->messageIndex();
+  CHECK_GT(index.size(), first_size);
+
+  size_t num_samples = 0;
+  for (const auto& [msg_id, subscription] : data_container->subscriptionsByMessageId()) {
+    num_samples += subscription->size();
+  }
+  REQUIRE_GT(data_container->logging().size(), 0);
+  CHECK_EQ(index.size(), num_samples + data_container->logging().size() +
+                             data_container->changedParameters().size());
+
+  // Ordered, and each entry refers to its source
+  uint64_t last_timestamp = 0;
+  for (const auto& entry : index.all()) {
+    CHECK_LE(last_timestamp, entry.timestamp);
+    last_timestamp = entry.timestamp;
+    switch (entry.type) {
+      case ulog_cpp::MessageIndex::Type::Data:
+        CHECK_EQ(data_container->subscriptionsByMessageId()
+                     .at(entry.msg_id)
+                     ->at(entry.index)["timestamp"]
+                     .as<uint64_t>(),
+                 entry.timestamp);
+        break;
+      case ulog_cpp::MessageIndex::Type::Logging:
+        CHECK_EQ(data_container->logging().at(entry.index).timestamp(), entry.timestamp);
+        break;
+      case ulog_cpp::MessageIndex::Type::Parameter:
+        CHECK_LT(entry.index, data_container->changedParameters().size());
+        break;
+    }
+  }
+
+  // Time range
+  const uint64_t start = index.all()[index.size() / 3].timestamp;
+  const uint64_t end = start + 100000;
+  const auto slice = index.range(start, end);
+  REQUIRE_FALSE(slice.empty());
+  CHECK_EQ(slice[0].timestamp, start);
+  CHECK_LT(slice[slice.size() - 1].timestamp, end);
+  CHECK_LT(index.all()[slice.begin() - index.all().begin() - 1].timestamp, start);
+  if (slice.end() != index.all().end()) {
+    CHECK_GE(slice.end()->timestamp, end);
+  }
+  CHECK(index.range(end, start).empty());
+  CHECK_EQ(index.range(0, UINT64_MAX).size(), index.size());
+
+  const auto no_index =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  CHECK_THROWS_AS(no_index->messageIndex(), ulog_cpp::UsageException);
+}
+
+TEST_CASE("Parameter timeline")
+{
+  std::vector<uint8_t> written_data;
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) {
+          written_data.insert(written_data.end(), data, data + length);
+        },
+        0);
+    writer.writeParameter("MPC_XY_P", 0.95F);
+    writer.writeParameter("COM_MODE", int32_t{3});
+    writer.writeMessageFormat<MergeSample>();
+    writer.headerComplete();
+    const auto id = writer.writeAddLoggedMessage<MergeSample>();
+    writer.writeData(id, MergeSample{100, 0, 0});
+    writer.writeParameterChange("MPC_XY_P", 1.2F);
+    writer.writeData(id, MergeSample{200, 0, 0});
+    writer.writeParameterChange("MPC_XY_P", 1.5F);
+    writer.writeParameterChange("COM_MODE", int32_t{4});
+    writer.writeParameterChange("NEW_PARAM", int32_t{1});
+    writer.writeData(id, MergeSample{300, 0, 0});
+  }
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(written_data.data(), static_cast<int>(written_data.size()));
+  REQUIRE(data_container->parsingErrors().empty());
+  const std::vector<uint64_t> expected_timestamps = {100, 200, 200, 200};
+  CHECK_EQ(data_container->changedParameterTimestamps(), expected_timestamps);
+
+  const ulog_cpp::ParameterTimeline timeline(*data_container);
+  CHECK_EQ(timeline.numParameters(), 3);
+  const auto xy_p = timeline.id("MPC_XY_P");
+  REQUIRE_NE(xy_p, ulog_cpp::ParameterTimeline::kInvalidId);
+  CHECK_EQ(timeline.name(xy_p), "MPC_XY_P");
+  CHECK_EQ(timeline.points(xy_p).size(), 3);
+  CHECK_EQ(std::get<float>(timeline.value(xy_p, 0)), 0.95F);
+  CHECK_EQ(std::get<float>(timeline.value(xy_p, 99)), 0.95F);
+  CHECK_EQ(std::get<float>(timeline.value(xy_p, 100)), 1.2F);
+  CHECK_EQ(std::get<float>(timeline.value(xy_p, 199)), 1.2F);
+  CHECK_EQ(std::get<float>(timeline.value(xy_p, 1000)), 1.5F);
+  CHECK_EQ(std::get<int32_t>(timeline.value("COM_MODE", 150)), 3);
+  CHECK_EQ(std::get<int32_t>(timeline.value("COM_MODE", 200)), 4);
+
+  const auto new_param = timeline.id("NEW_PARAM");
+  CHECK_EQ(timeline.find(new_param, 199), nullptr);
+  CHECK_THROWS_AS(timeline.value(new_param, 199), ulog_cpp::AccessException);
+  CHECK_EQ(std::get<int32_t>(timeline.value(new_param, 200)), 1);
+
+  CHECK_EQ(timeline.id("MISSING"), ulog_cpp::ParameterTimeline::kInvalidId);
+  CHECK_THROWS_AS(timeline.value("MISSING", 0), ulog_cpp::AccessException);
+  CHECK_THROWS_AS(timeline.points(ulog_cpp::ParameterTimeline::kInvalidId),
+                  ulog_cpp::AccessException);
+}
+
+TEST_CASE("Flattened message format layout")
+{
+  using ulog_cpp::Field;
+  using ulog_cpp::MessageFormat;
+  std::map<std::string, std::shared_ptr<MessageFormat>> formats;
+  formats["report"] = std::make_shared<MessageFormat>(
+      "report", std::vector<Field>{{"int32_t", "rpm"}, {"uint8_t", "state"}});
+  formats["status"] =
+      std::make_shared<MessageFormat>("status", std::vector<Field>{{"uint64_t", "timestamp"},
+                                                                   {"float", "values", 3},
+                                                                   {"report", "esc", 2},
+                                                                   {"report", "main"}});
+  const auto& status = *formats["status"];
+  CHECK_FALSE(status.resolved());
+  CHECK_THROWS_AS(status.layout(), ulog_cpp::UsageException);
+  status.resolveDefinition(formats);
+  REQUIRE(status.resolved());
+  CHECK(formats["report"]->resolved());
+  CHECK_EQ(status.sizeBytes(), 8 + 12 + 3 * 5);
+
+  const auto& layout = status.layout();
+  REQUIRE_EQ(layout.size(), 8);
+  std::vector<std::string> paths;
+  std::vector<int> offsets;
+  for (const auto& leaf : layout) {
+    paths.push_back(leaf.path);
+    offsets.push_back(leaf.offset);
+  }
+  const std::vector<std::string> expected_paths = {
+      "timestamp",    "values",   "esc[0].rpm", "esc[0].state", "esc[1].rpm",
+      "esc[1].state", "main.rpm", "main.state"};
+  const std::vector<int> expected_offsets = {0, 8, 20, 24, 25, 29, 30, 34};
+  CHECK_EQ(paths, expected_paths);
+  CHECK_EQ(offsets, expected_offsets);
+  CHECK_EQ(layout[1].type, Field::BasicType::FLOAT);
+  CHECK_EQ(layout[1].size, 4);
+  CHECK_EQ(layout[1].count, 3);
+  CHECK_EQ(layout[0].count, 1);
+
+  // Equal formats have equal hashes, different ones (most likely) not
+  std::map<std::string, std::shared_ptr<MessageFormat>> other_formats;
+  other_formats["report"] = std::make_shared<MessageFormat>(
+      "report", std::vector<Field>{{"int32_t", "rpm"}, {"uint8_t", "state"}});
+  const MessageFormat same("status", {{"uint64_t", "timestamp"},
+                                      {"float", "values", 3},
+                                      {"report", "esc", 2},
+                                      {"report", "main"}});
+  const MessageFormat different("status", {{"uint64_t", "timestamp"}, {"float", "values", 4}});
+  same.resolveDefinition(other_formats);
+  different.resolveDefinition(other_formats);
+  CHECK_EQ(same.contentHash(), status.contentHash());
+  CHECK_NE(different.contentHash(), status.contentHash());
+}
+
+TEST_CASE("Lazy storage")
+{
+  const auto file = std::make_shared<ulog_cpp::MappedFile>(sampleLogPath());
+  REQUIRE_GT(file->size(), 0);
+  const auto full_log = parseFullLog(readSampleLog());
+
+  const auto lazy =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::Lazy);
+  lazy->setLazySource(file);
+  lazy->enableMessageIndex();
+  ulog_cpp::Reader lazy_reader{lazy};
+  // Small chunks, so messages are also assembled in the partial message buffer
+  for (uint64_t offset = 0; offset < file->size(); offset += 777) {
+    lazy_reader.readChunk(file->data() + offset,
+                          static_cast<int>(std::min<uint64_t>(777, file->size() - offset)));
+  }
+  REQUIRE_EQ(lazy->parsingErrors(), full_log->parsingErrors());
+  CHECK_EQ(lazy->changedParameterTimestamps(), full_log->changedParameterTimestamps());
+
+  const auto& subscriptions = lazy->subscriptionsByMessageId();
+  REQUIRE_EQ(subscriptions.size(), full_log->subscriptionsByMessageId().size());
+  size_t num_samples = 0;
+  for (const auto& [msg_id, subscription] : subscriptions) {
+    CHECK(subscription->isLazy());
+    CHECK_FALSE(subscription->isDecoded());
+    const auto& expected = full_log->subscriptionsByMessageId().at(msg_id)->rawSamples();
+    REQUIRE_EQ(subscription->size(), expected.size());
+    CHECK(subscription->rawSamples() == expected);
+    CHECK(subscription->isDecoded());
+    num_samples += subscription->size();
+  }
+  CHECK_EQ(lazy->messageIndex().size(), num_samples + lazy->logging().size() +
+                                            lazy->changedParameters().size());
+
+  lazy->evictDecodedSamples();
+  const auto subscription = lazy->subscription("actuator_outputs");
+  CHECK_FALSE(subscription->isDecoded());
+  CHECK_GT(subscription->size(), 0);
+  CHECK_EQ(subscription->at(0)["noutputs"].as<uint32_t>(),
+           full_log->subscription("actuator_outputs")->at(0)["noutputs"].as<uint32_t>());
+  CHECK(subscription->isDecoded());
+  CHECK_THROWS_AS(subscription->emplaceSample(subscription->rawSamples()[0]),
+                  ulog_cpp::UsageException);
+
+  // Copies decode independently
+  ulog_cpp::Subscription copy(*subscription);
+  copy.evict();
+  CHECK(subscription->isDecoded());
+  CHECK(copy.rawSamples() == subscription->rawSamples());
+  ulog_cpp::Subscription assigned(*full_log->subscription("vehicle_attitude"));
+  assigned = copy;
+  CHECK(assigned.isLazy());
+  CHECK(assigned.rawSamples() == subscription->rawSamples());
+
+  // A lazy container needs a source
+  const auto no_source =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::Lazy);
+  ulog_cpp::Reader no_source_reader{no_source};
+  CHECK_THROWS_AS(no_source_reader.readChunk(file->data(), static_cast<int>(file->size())),
+                  ulog_cpp::UsageException);
+  const auto full_log_with_source =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  CHECK_THROWS_AS(full_log_with_source->setLazySource(file), ulog_cpp::UsageException);
+}
+
+TEST_CASE("Memory budget with spilling")
+{
+  const auto data = readSampleLog();
+  const auto full_log = parseFullLog(data);
+
+  // Spilled subscriptions keep the file offsets in memory, so the budget cannot be arbitrarily low
+  const uint64_t budget = full_log->memoryUsage() / 4;
+  const auto budgeted =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  budgeted->setMemoryBudget(budget);
+  ulog_cpp::Reader budgeted_reader{budgeted};
+  budgeted_reader.readChunk(data.data(), static_cast<int>(data.size()));
+  REQUIRE_EQ(budgeted->parsingErrors(), full_log->parsingErrors());
+  CHECK_LE(budgeted->memoryUsage(), budget);
+
+  // Iterating decodes spilled samples block-wise, so the budget holds
+  int num_spilled = 0;
+  for (const auto& [msg_id, subscription] : budgeted->subscriptionsByMessageId()) {
+    const auto& expected = full_log->subscriptionsByMessageId().at(msg_id)->rawSamples();
+    REQUIRE_EQ(subscription->size(), expected.size());
+    auto expected_it = expected.begin();
+    for (const auto& sample : *subscription) {
+      CHECK(sample.rawData() == (expected_it++)->data());
+    }
+    num_spilled += subscription->isSpilled() ? 1 : 0;
+  }
+  CHECK_GT(num_spilled, 0);
+  CHECK_LE(budgeted->memoryUsage(), budget);
+  CHECK_FALSE(budgeted->memoryBudgetExceeded());
+
+  // Decoded spilled samples count towards the budget, but are only evicted explicitly, so
+  // references into them stay valid
+  std::vector<const std::vector<ulog_cpp::Data>*> decoded;
+  for (const auto& [msg_id, subscription] : budgeted->subscriptionsByMessageId()) {
+    decoded.push_back(&subscription->rawSamples());
+  }
+  CHECK(budgeted->memoryBudgetExceeded());
+  CHECK_GT(budgeted->memoryUsage(), budget);
+  size_t index = 0;
+  for (const auto& [msg_id, subscription] : full_log->subscriptionsByMessageId()) {
+    CHECK(*decoded[index++] == subscription->rawSamples());
+  }
+  budgeted->evictDecodedSamples();
+  CHECK_LE(budgeted->memoryUsage(), budget);
+  CHECK_FALSE(budgeted->memoryBudgetExceeded());
+
+  // Samples added after spilling go to the spill file, also while decoded
+  ulog_cpp::Subscription subscription(
+      ulog_cpp::AddLoggedMessage(0, 1, "test"), {ulog_cpp::Data(1, {1, 2, 3})},
+      std::make_shared<ulog_cpp::MessageFormat>("test", std::vector<ulog_cpp::Field>{}));
+  const auto spill_file = std::make_shared<ulog_cpp::SpillFile>();
+  subscription.spill(spill_file);
+  CHECK_FALSE(subscription.isDecoded());
+  subscription.emplaceSample(ulog_cpp::Data(1, {4, 5}));
+  CHECK_EQ(subscription.size(), 2);
+  CHECK_EQ(subscription.rawSamples()[1].data().size(), 2);
+  subscription.emplaceSample(ulog_cpp::Data(1, {6}));
+  CHECK_EQ(subscription.rawSamples().size(), 3);
+  subscription.evict();
+  CHECK_EQ(subscription.rawSamples()[2].data()[0], 6);
+}
+
+TEST_CASE("Compressed storage")
+{
+  const auto data = readSampleLog();
+  const auto full_log = parseFullLog(data);
+
+  const auto compressed =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  compressed->enableCompression(64);
+  ulog_cpp::Reader compressed_reader{compressed};
+  compressed_reader.readChunk(data.data(), static_cast<int>(data.size()));
+  REQUIRE_EQ(compressed->parsingErrors(), full_log->parsingErrors());
+  const uint64_t compressed_usage = compressed->memoryUsage();
+  CHECK_LT(compressed_usage * 2, full_log->memoryUsage());
+
+  std::vector<ulog_cpp::Data> block;
+  for (const auto& [msg_id, subscription] : compressed->subscriptionsByMessageId()) {
+    REQUIRE(subscription->isCompressed());
+    const auto& expected = full_log->subscriptionsByMessageId().at(msg_id)->rawSamples();
+    REQUIRE_EQ(subscription->size(), expected.size());
+
+    // Block-wise decoding
+    const ulog_cpp::CompressedSamples& samples = *subscription->compressedSamples();
+    size_t index = 0;
+    for (size_t i = 0; i < samples.numBlocks(); ++i) {
+      samples.decodeBlock(i, block);
+      for (const auto& sample : block) {
+        REQUIRE_LT(index, expected.size());
+        CHECK(sample == expected[index++]);
+      }
+    }
+    CHECK_EQ(index, expected.size());
+    CHECK_FALSE(subscription->isDecoded());
+
+    // Iterators decompress one block at a time
+    index = 0;
+    for (const auto& sample : *subscription) {
+      REQUIRE_LT(index, expected.size());
+      CHECK(sample.rawData() == expected[index++].data());
+    }
+    CHECK_EQ(index, expected.size());
+    if (expected.size() > 65) {
+      auto last = subscription->end() - 1;
+      CHECK(last[0].rawData() == expected.back().data());
+      CHECK(last[-65].rawData() == expected[expected.size() - 66].data());
+    }
+    CHECK_FALSE(subscription->isDecoded());
+
+    // Transparent decoding
+    CHECK(subscription->rawSamples() == expected);
+    CHECK(subscription->isDecoded());
+  }
+  compressed->evictDecodedSamples();
+  CHECK_EQ(compressed->memoryUsage(), compressed_usage);
+
+  // Timestamp jumps, negative deltas, special float values, and samples of different sizes
+  std::vector<ulog_cpp::Field> fields{{"uint64_t", "timestamp"}, {"float", "values", 2},
+                                      {"int8_t", "count"}};
+  const auto format = std::make_shared<ulog_cpp::MessageFormat>("test", fields);
+  format->resolveDefinition({});
+  std::vector<ulog_cpp::Data> expected;
+  const uint64_t timestamps[] = {0,    100,  200,  300,   250,   1ULL << 40, (1ULL << 40) + 7,
+                                 5000, 5000, 5001, ~0ULL, 12345, 0,          1000000};
+  const float values[] = {0.F, -0.F, 1.5F, 1e30F, -3.25F, std::numeric_limits<float>::infinity()};
+  for (int i = 0; i < 14; ++i) {
+    const float sample_values[] = {values[i % 6], values[(i * 5) % 6]};
+    std::vector<uint8_t> payload(sizeof(uint64_t) + sizeof(sample_values) + 1);
+    memcpy(payload.data(), &timestamps[i], sizeof(uint64_t));
+    memcpy(payload.data() + sizeof(uint64_t), sample_values, sizeof(sample_values));
+    payload.back() = static_cast<uint8_t>(-i);
+    if (i == 3) {
+      payload.pop_back();  // shorter, like without trailing padding
+    }
+    if (i == 9) {
+      payload.push_back(0xff);  // longer than the format: stored uncompressed
+    }
+    expected.emplace_back(1, payload);
+  }
+  ulog_cpp::CompressedSamples samples(format, 4);
+  for (const auto& sample : expected) {
+    samples.append(sample);
+  }
+  CHECK_EQ(samples.size(), expected.size());
+  CHECK_EQ(samples.numBlocks(), 4);
+  std::vector<ulog_cpp::Data> decoded;
+  samples.decodeAll(decoded);
+  CHECK(decoded == expected);
+  CHECK_THROWS_AS(samples.decodeBlock(4, decoded), ulog_cpp::AccessException);
+  CHECK_EQ(samples.findBlock(3), 0);
+  CHECK_EQ(samples.findBlock(13), 3);
+  CHECK_EQ(samples.blockStart(3), 12);
+  CHECK_THROWS_AS(samples.findBlock(14), ulog_cpp::AccessException);
+}
+
+TEST_CASE("Decimation policies")
+{
+  const auto data = readSampleLog();
+  const auto full_log = parseFullLog(data);
+
+  const uint64_t bucket_us = 100000;
+  const auto decimated =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  decimated->setDecimationPolicy("sensor_combined", ulog_cpp::DecimationPolicy::everyNth(10));
+  decimated->setDecimationPolicy("vehicle_attitude",
+                                 ulog_cpp::DecimationPolicy::minMax(bucket_us, "rollspeed"));
+  decimated->setDefaultDecimationPolicy(ulog_cpp::DecimationPolicy::maxSamples(100));
+  CHECK_THROWS_AS(decimated->enableMessageIndex(), ulog_cpp::UsageException);
+  ulog_cpp::Reader decimated_reader{decimated};
+  decimated_reader.readChunk(data.data(), static_cast<int>(data.size()));
+  REQUIRE_EQ(decimated->parsingErrors(), full_log->parsingErrors());
+  CHECK_LT(decimated->memoryUsage() * 10, full_log->memoryUsage());
+
+  // Every n-th
+  {
+    const auto& samples = decimated->subscription("sensor_combined")->rawSamples();
+    const auto& expected = full_log->subscription("sensor_combined")->rawSamples();
+    REQUIRE_EQ(samples.size(), (expected.size() + 9) / 10);
+    for (size_t i = 0; i < samples.size(); ++i) {
+      CHECK(samples[i] == expected[i * 10]);
+    }
+  }
+
+  // Min/max per bucket, compared against a direct computation
+  {
+    const auto subscription = decimated->subscription("vehicle_attitude");
+    const auto full_subscription = full_log->subscription("vehicle_attitude");
+    const auto timestamps = ulog_cpp::timestampColumn(*full_subscription);
+    const auto values = ulog_cpp::column(*full_subscription, "rollspeed");
+    std::vector<ulog_cpp::Data> expected;
+    size_t bucket_start = 0;
+    while (bucket_start < values.size()) {
+      size_t bucket_end = bucket_start;
+      size_t min_index = bucket_start;
+      size_t max_index = bucket_start;
+      while (bucket_end < values.size() &&
+             timestamps[bucket_end] / bucket_us == timestamps[bucket_start] / bucket_us) {
+        min_index = values[bucket_end] < values[min_index] ? bucket_end : min_index;
+        max_index = values[bucket_end] > values[max_index] ? bucket_end : max_index;
+        ++bucket_end;
+      }
+      expected.push_back(full_subscription->rawSamples()[std::min(min_index, max_index)]);
+      if (min_index != max_index) {
+        expected.push_back(full_subscription->rawSamples()[std::max(min_index, max_index)]);
+      }
+      bucket_start = bucket_end;
+    }
+    CHECK_LT(expected.size(), full_subscription->size());
+    CHECK(subscription->rawSamples() == expected);
+  }
+
+  // Default: at most 100 samples, evenly spaced
+  {
+    const auto& samples = decimated->subscription("vehicle_rates_setpoint")->rawSamples();
+    const auto& expected = full_log->subscription("vehicle_rates_setpoint")->rawSamples();
+    REQUIRE_LE(samples.size(), 100);
+    REQUIRE_GE(samples.size(), 50);
+    size_t stride = 1;
+    while ((expected.size() + stride - 1) / stride > 100) {
+      stride *= 2;
+    }
+    for (size_t i = 0; i < samples.size(); ++i) {
+      CHECK(samples[i] == expected[i * stride]);
+    }
+  }
+  CHECK_THROWS_AS(
+      decimated->setDecimationPolicy("sensor_combined", ulog_cpp::DecimationPolicy::everyNth(2)),
+      ulog_cpp::UsageException);
+
+  // Min/max skips NaN values, also at the start of a bucket
+  {
+    std::vector<ulog_cpp::Field> fields{{"uint64_t", "timestamp"}, {"float", "value"}};
+    ulog_cpp::MessageFormat format("test", fields);
+    format.resolveDefinition({});
+    ulog_cpp::Decimator decimator(ulog_cpp::DecimationPolicy::minMax(10, "value"), format);
+    const auto makeSample = [](uint64_t timestamp, float value) {
+      std::vector<uint8_t> payload(sizeof(timestamp) + sizeof(value));
+      memcpy(payload.data(), &timestamp, sizeof(timestamp));
+      memcpy(payload.data() + sizeof(timestamp), &value, sizeof(value));
+      return ulog_cpp::Data(1, payload);
+    };
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const std::vector<std::pair<uint64_t, float>> input{
+        {0, nan}, {1, 2.F}, {2, nan}, {3, -1.F}, {4, 5.F}, {10, nan}, {20, 3.F}, {21, nan}};
+    std::vector<ulog_cpp::Data> samples;
+    int64_t payload_bytes = 0;
+    for (const auto& [timestamp, value] : input) {
+      payload_bytes += decimator.add(makeSample(timestamp, value), samples);
+    }
+    const std::vector<ulog_cpp::Data> expected{makeSample(3, -1.F), makeSample(4, 5.F),
+                                               makeSample(10, nan), makeSample(20, 3.F)};
+    CHECK(samples == expected);
+    CHECK_EQ(payload_bytes, 4 * 12);
+  }
+}
+
+TEST_CASE("Level of detail pyramid")
+{
+  const auto data_container = parseFullLog(readSampleLog());
+
+  const auto subscription = data_container->subscription("vehicle_attitude");
+  const ulog_cpp::LodPyramid pyramid(*subscription);
+  CHECK_EQ(pyramid.fieldIndex("timestamp"), ulog_cpp::LodPyramid::kInvalidField);
+  const int field = pyramid.fieldIndex("q[2]");
+  REQUIRE_NE(field, ulog_cpp::LodPyramid::kInvalidField);
+  CHECK_NE(pyramid.fieldIndex("rollspeed"), ulog_cpp::LodPyramid::kInvalidField);
+  CHECK_EQ(pyramid.levelSize(0), subscription->size());
+  CHECK_EQ(pyramid.levelSize(pyramid.numLevels() - 1), 1);
+
+  const auto timestamps = ulog_cpp::timestampColumn(*subscription);
+  const auto values = ulog_cpp::column(*subscription, "q", 2);
+  const uint64_t start = timestamps[1000] + 1;
+  const uint64_t end = timestamps[5000];
+  const auto points = pyramid.query(field, start, end, 500);
+  REQUIRE_LE(points.size(), 500);
+  REQUIRE_GT(points.size(), 500 / pyramid.factor());
+  CHECK_LE(points.front().start_timestamp, start);
+  CHECK_GE(points.front().end_timestamp, start);
+  CHECK_GE(points.back().end_timestamp, end);
+
+  // Compare each point against the samples it covers
+  size_t index = 0;
+  for (const auto& point : points) {
+    while (timestamps[index] < point.start_timestamp) {
+      ++index;
+    }
+    double min = values[index];
+    double max = values[index];
+    double sum = 0;
+    int count = 0;
+    for (; index < timestamps.size() && timestamps[index] <= point.end_timestamp; ++index) {
+      min = std::min(min, values[index]);
+      max = std::max(max, values[index]);
+      sum += values[index];
+      ++count;
+    }
+    CHECK_EQ(point.min, min);
+    CHECK_EQ(point.max, max);
+    CHECK_LT(std::abs(point.mean - sum / count), 1e-9);
+  }
+
+  // Zoomed in to single samples
+  const auto samples = pyramid.query("q[2]", timestamps[10], timestamps[19], 100);
+  REQUIRE_EQ(samples.size(), 10);
+  CHECK_EQ(samples[3].start_timestamp, timestamps[13]);
+  CHECK_EQ(samples[3].mean, values[13]);
+
+  // Built block-wise from compressed samples
+  ulog_cpp::Subscription compressed_subscription(*subscription);
+  compressed_subscription.compress();
+  const ulog_cpp::LodPyramid compressed(compressed_subscription);
+  CHECK_FALSE(compressed_subscription.isDecoded());
+  CHECK_EQ(compressed.fieldNames(), pyramid.fieldNames());
+  for (const int level : {0, pyramid.numLevels() - 1}) {
+    const auto expected = pyramid.level(field, level);
+    const auto actual = compressed.level(field, level);
+    REQUIRE_EQ(actual.size(), expected.size());
+    CHECK_EQ(actual.back().end_timestamp, expected.back().end_timestamp);
+    CHECK_EQ(actual.back().mean, expected.back().mean);
+  }
+
+  // Persisted next to the log
+  const std::string lod_file_name =
+      (std::filesystem::temp_directory_path() / "ulog_cpp_test_pyramid.lod").string();
+  pyramid.save(lod_file_name);
+  const ulog_cpp::LodPyramid loaded(lod_file_name, *subscription);
+  CHECK_EQ(loaded.fieldNames(), pyramid.fieldNames());
+  CHECK_EQ(loaded.numLevels(), pyramid.numLevels());
+  for (int level = 0; level < pyramid.numLevels(); ++level) {
+    const auto expected = pyramid.level(field, level);
+    const auto actual = loaded.level(field, level);
+    REQUIRE_EQ(actual.size(), expected.size());
+    CHECK(std::equal(actual.begin(), actual.end(), expected.begin(),
+                     [](const ulog_cpp::LodPoint& a, const ulog_cpp::LodPoint& b) {
+                       return a.start_timestamp == b.start_timestamp &&
+                              a.end_timestamp == b.end_timestamp && a.min == b.min &&
+                              a.max == b.max && a.mean == b.mean;
+                     }));
+  }
+  const auto other_subscription = data_container->subscription("sensor_combined");
+  CHECK_THROWS_AS(ulog_cpp::LodPyramid(lod_file_name, *other_subscription),
+                  ulog_cpp::ParsingException);
+  std::filesystem::remove(lod_file_name);
+}
+
 TEST_SUITE_END();
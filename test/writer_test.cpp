@@ -0,0 +1,671 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <set>
+#include <thread>
+#include <ulog_cpp/async_writer.hpp>
+#include <ulog_cpp/data_container.hpp>
+#include <ulog_cpp/reader.hpp>
+#include <ulog_cpp/segment_buffer.hpp>
+#include <ulog_cpp/simple_writer.hpp>
+#include <ulog_cpp/writer.hpp>
+#include <vector>
+
+// Count heap allocations, to check that the data path does not allocate.
+// GCC reports malloc/free in the replaced operators as mismatched once they are inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<int> g_num_allocations{0};
+
+void* operator new(std::size_t size)
+{
+  ++g_num_allocations;
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t size) noexcept
+{
+  std::free(ptr);
+}
+
+struct TraitsTestData {
+  uint64_t timestamp;
+  double position[3];
+  float values[12];
+  int32_t status;
+  uint16_t flags;
+  bool valid;
+  char label[3];
+  int8_t counter;
+};
+ULOG_CPP_MESSAGE_TRAITS(TraitsTestData, "traits_test", timestamp, position, values, status, flags,
+                        valid, label, counter)
+
+namespace {
+
+std::vector<uint8_t> readFile(const std::string& filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+struct WriteLog {
+  std::vector<uint8_t> data;
+  std::vector<int> chunk_sizes;
+
+  ulog_cpp::DataWriteCB callback()
+  {
+    return [this](const uint8_t* buffer, int length) {
+      data.insert(data.end(), buffer, buffer + length);
+      chunk_sizes.push_back(length);
+    };
+  }
+};
+
+/**
+ * Offsets in the serialized ULog stream where messages start (and the end of the stream)
+ */
+std::set<size_t> messageBoundaries(const std::vector<uint8_t>& data)
+{
+  std::set<size_t> boundaries;
+  size_t offset = sizeof(ulog_cpp::ulog_file_header_s);
+  while (offset + ULOG_MSG_HEADER_LEN <= data.size()) {
+    boundaries.insert(offset);
+    uint16_t msg_size;
+    memcpy(&msg_size, data.data() + offset, sizeof(msg_size));
+    offset += ULOG_MSG_HEADER_LEN + msg_size;
+  }
+  boundaries.insert(offset);
+  return boundaries;
+}
+
+void writeLog(ulog_cpp::SimpleWriter& writer, int num_samples)
+{
+  writer.writeInfo("sys_name", "BufferedWriterTest");
+  writer.writeParameter("PARAM_A", 312);
+  writer.writeMessageFormat("my_data", {{"uint64_t", "timestamp"}, {"float", "value"}});
+  writer.headerComplete();
+  const uint16_t msg_id = writer.writeAddLoggedMessage("my_data");
+  writer.writeTextMessage(ulog_cpp::Logging::Level::Warning, "Some text", 0);
+  struct MyData {
+    uint64_t timestamp;
+    float value;
+  };
+  for (int i = 0; i < num_samples; ++i) {
+    writer.writeData(msg_id, MyData{static_cast<uint64_t>(i) * 1000, static_cast<float>(i)});
+  }
+}
+
+}  // namespace
+
+TEST_SUITE_BEGIN("Writer");
+
+TEST_CASE("Buffered writer produces the same output in fewer calls")
+{
+  const int kNumSamples = 5000;
+  const int kBufferSize = 4096;
+
+  WriteLog unbuffered;
+  {
+    ulog_cpp::SimpleWriter writer(unbuffered.callback(), 0);
+    writeLog(writer, kNumSamples);
+  }
+
+  WriteLog buffered;
+  {
+    ulog_cpp::SimpleWriter writer(buffered.callback(), 0, kBufferSize);
+    writeLog(writer, kNumSamples);
+  }
+
+  CHECK_EQ(unbuffered.data, buffered.data);
+  CHECK_GT(unbuffered.chunk_sizes.size(), static_cast<size_t>(kNumSamples));
+  CHECK_LT(buffered.chunk_sizes.size(),
+           buffered.data.size() / static_cast<size_t>(kBufferSize) + 2);
+
+  // Each call must end at a message boundary
+  const std::set<size_t> boundaries = messageBoundaries(buffered.data);
+  size_t offset = 0;
+  for (size_t i = 0; i < buffered.chunk_sizes.size(); ++i) {
+    offset += buffered.chunk_sizes[i];
+    CHECK(boundaries.count(offset) == 1);
+    if (i + 1 < buffered.chunk_sizes.size()) {
+      CHECK_GE(buffered.chunk_sizes[i], kBufferSize);
+    }
+  }
+
+  // And the result must still be parseable
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(buffered.data.data(), static_cast<int>(buffered.data.size()));
+  CHECK(data_container->parsingErrors().empty());
+  CHECK_EQ(data_container->subscription("my_data")->size(), kNumSamples);
+}
+
+TEST_CASE("Buffered writer flushes on fsync()")
+{
+  WriteLog log;
+  ulog_cpp::SimpleWriter writer(log.callback(), 0, 1024 * 1024);
+  writeLog(writer, 10);
+  CHECK(log.data.empty());
+  writer.fsync();
+  CHECK_FALSE(log.data.empty());
+  const size_t size = log.data.size();
+  writer.fsync();
+  CHECK_EQ(log.data.size(), size);
+}
+
+TEST_CASE("SimpleWriter writeData does not allocate")
+{
+  std::vector<uint8_t> output;
+  output.reserve(1024 * 1024);
+  const ulog_cpp::DataWriteCB sink = [&output](const uint8_t* data, int length) {
+    if (output.size() + length > output.capacity()) {
+      output.clear();
+    }
+    output.insert(output.end(), data, data + length);
+  };
+  struct MyData {
+    uint64_t timestamp;
+    float value;
+  };
+
+  for (const int buffer_size : {0, 4096}) {
+    ulog_cpp::SimpleWriter writer(sink, 0, buffer_size);
+    writer.writeMessageFormat("my_data", {{"uint64_t", "timestamp"}, {"float", "value"}});
+    writer.headerComplete();
+    const uint16_t msg_id = writer.writeAddLoggedMessage("my_data");
+    // Warm up, so the buffer reached its final size
+    for (int i = 0; i < 1000; ++i) {
+      writer.writeData(msg_id, MyData{static_cast<uint64_t>(i), 1.F});
+    }
+    const int num_allocations = g_num_allocations;
+    for (int i = 0; i < 10000; ++i) {
+      writer.writeData(msg_id, MyData{static_cast<uint64_t>(i), 1.F});
+    }
+    CHECK_EQ(g_num_allocations - num_allocations, 0);
+
+    CHECK_THROWS_AS(writer.writeData(msg_id, uint32_t{0}), ulog_cpp::UsageException);
+  }
+}
+
+TEST_CASE("Sync policy inserts Sync messages and writes an index")
+{
+  const int kNumSamples = 5000;
+  const uint64_t kIntervalBytes = 4096;
+  for (const int buffer_size : {0, 16 * 1024}) {
+    WriteLog log;
+    {
+      ulog_cpp::SimpleWriter writer(log.callback(), 0, buffer_size);
+      ulog_cpp::SyncPolicy sync_policy;
+      sync_policy.interval_bytes = kIntervalBytes;
+      sync_policy.record_offsets = true;
+      writer.setSyncPolicy(sync_policy);
+      writeLog(writer, kNumSamples);
+    }
+
+    const auto data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+    ulog_cpp::Reader reader{data_container};
+    reader.readChunk(log.data.data(), static_cast<int>(log.data.size()));
+    CHECK(data_container->parsingErrors().empty());
+    CHECK_EQ(data_container->subscription("my_data")->size(), kNumSamples);
+
+    // The index lists all Sync messages, which are at most an interval (plus a message) apart
+    const auto index_iter = data_container->messageInfoMulti().find("sync_offsets");
+    REQUIRE(index_iter != data_container->messageInfoMulti().end());
+    REQUIRE_EQ(index_iter->second.size(), 1);
+    const auto offsets = index_iter->second[0][0].value().as<std::vector<uint64_t>>();
+    CHECK_GE(offsets.size(), log.data.size() / (kIntervalBytes + 100));
+    uint64_t previous_offset = 0;
+    for (const uint64_t offset : offsets) {
+      REQUIRE_LT(offset + ULOG_MSG_HEADER_LEN, log.data.size());
+      CHECK_EQ(log.data[offset + 2], static_cast<uint8_t>(ulog_cpp::ULogMessageType::SYNC));
+      if (previous_offset > 0) {
+        CHECK_LE(offset - previous_offset, kIntervalBytes + 100);
+      }
+      previous_offset = offset;
+    }
+
+    // The index can be located from the end of the file
+    const uint8_t* trailer =
+        log.data.data() + log.data.size() - ulog_cpp::Writer::kSyncIndexTrailerSize;
+    REQUIRE_EQ(trailer[2], static_cast<uint8_t>(ulog_cpp::ULogMessageType::INFO));
+    const ulog_cpp::MessageInfo index_offset(trailer);
+    CHECK_EQ(index_offset.field().name(), ulog_cpp::Writer::kSyncIndexOffsetKey);
+    uint64_t index_position;
+    memcpy(&index_position, log.data.data() + log.data.size() - sizeof(index_position),
+           sizeof(index_position));
+    CHECK_EQ(data_container->messageInfo().at("sync_index_offset").value().as<uint64_t>(),
+             index_position);
+    CHECK_EQ(log.data[index_position + 2],
+             static_cast<uint8_t>(ulog_cpp::ULogMessageType::INFO_MULTIPLE));
+  }
+
+  // Time-based interval (the samples are 1 ms apart)
+  WriteLog log;
+  {
+    ulog_cpp::SimpleWriter writer(log.callback(), 0);
+    ulog_cpp::SyncPolicy sync_policy;
+    sync_policy.interval_us = 100000;
+    writer.setSyncPolicy(sync_policy);
+    writeLog(writer, kNumSamples);
+  }
+  int num_syncs = 0;
+  for (const size_t offset : messageBoundaries(log.data)) {
+    if (offset + ULOG_MSG_HEADER_LEN <= log.data.size() &&
+        log.data[offset + 2] == static_cast<uint8_t>(ulog_cpp::ULogMessageType::SYNC)) {
+      ++num_syncs;
+    }
+  }
+  CHECK_EQ(num_syncs, kNumSamples / 100 - 1);
+}
+
+TEST_CASE("SimpleWriter file rotation")
+{
+  const int kNumSamples = 5000;
+  const auto filename = [](int file_index) {
+    return (std::filesystem::temp_directory_path() /
+            ("ulog_cpp_rotation_test_" + std::to_string(file_index) + ".ulg"))
+        .string();
+  };
+  struct MyData {
+    uint64_t timestamp;
+    float value;
+  };
+
+  for (const bool multi_producer : {false, true}) {
+    int num_files = 0;
+    {
+      ulog_cpp::RotationPolicy rotation_policy;
+      rotation_policy.max_file_size = 16 * 1024;
+      ulog_cpp::SimpleWriter writer(
+          [&](int file_index) {
+            num_files = std::max(num_files, file_index + 1);
+            return std::make_unique<ulog_cpp::StdioFileSink>(filename(file_index));
+          },
+          rotation_policy, 0, 1024);
+      if (multi_producer) {
+        writer.enableMultiProducer(512);
+      }
+      writeLog(writer, 0);
+      const uint16_t msg_id = writer.writeAddLoggedMessage("my_data", 1);
+      for (int i = 0; i < kNumSamples; ++i) {
+        if (i == kNumSamples / 2) {
+          writer.writeParameterChange("PARAM_A", 1000);
+        }
+        writer.writeData(msg_id, MyData{static_cast<uint64_t>(i) * 1000, static_cast<float>(i)});
+      }
+    }
+    REQUIRE_GT(num_files, 3);
+
+    // Every file is complete, and together they contain all data
+    std::vector<float> values;
+    for (int file_index = 0; file_index < num_files; ++file_index) {
+      if (!std::filesystem::exists(filename(file_index))) {
+        // Opened in advance, but not used: discarded
+        CHECK_EQ(file_index, num_files - 1);
+        continue;
+      }
+      const auto data = readFile(filename(file_index));
+      std::filesystem::remove(filename(file_index));
+      REQUIRE_FALSE(data.empty());
+      CHECK_LE(data.size(), 16 * 1024 + 1024 + 512);
+      const auto data_container = std::make_shared<ulog_cpp::DataContainer>(
+          ulog_cpp::DataContainer::StorageConfig::FullLog);
+      ulog_cpp::Reader reader{data_container};
+      reader.readChunk(data.data(), static_cast<int>(data.size()));
+      CHECK(data_container->parsingErrors().empty());
+      CHECK_EQ(data_container->messageInfo().at("sys_name").value().as<std::string>(),
+               "BufferedWriterTest");
+      const auto subscription = data_container->subscription("my_data", 1);
+      REQUIRE_GT(subscription->size(), 0);
+      for (const auto& sample : *subscription) {
+        values.push_back(sample["value"].as<float>());
+      }
+
+      // Files started after the parameter change have the new value in the header
+      const float first_value = (*subscription)[0]["value"].as<float>();
+      const int param_a =
+          data_container->initialParameters().at("PARAM_A").value().as<int32_t>();
+      if (first_value < kNumSamples / 2) {
+        CHECK_EQ(param_a, 312);
+      } else if (first_value > kNumSamples / 2) {
+        CHECK_EQ(param_a, 1000);
+      }
+    }
+    REQUIRE_EQ(values.size(), kNumSamples);
+    for (int i = 0; i < kNumSamples; ++i) {
+      CHECK_EQ(values[i], static_cast<float>(i));
+    }
+  }
+}
+
+TEST_CASE("Message traits")
+{
+  using Traits = ulog_cpp::MessageTraits<TraitsTestData>;
+  static_assert(ulog_cpp::HasMessageTraits<TraitsTestData>::value);
+  static_assert(!ulog_cpp::HasMessageTraits<int>::value);
+  static_assert(Traits::kSize == 8 + 3 * 8 + 12 * 4 + 4 + 2 + 1 + 3 + 1);
+  static_assert(std::size(Traits::kFields) == 8);
+  static_assert(Traits::kFields[2].array_length == 12 && Traits::kFields[2].offset == 32);
+  CHECK_EQ(std::string(Traits::kFormat.c_str()),
+           "traits_test:uint64_t timestamp;double[3] position;float[12] values;int32_t status;"
+           "uint16_t flags;bool valid;char[3] label;int8_t counter;");
+  CHECK_EQ(Traits::kFormat.size(), strlen(Traits::kFormat.c_str()));
+
+  // The typed API writes the same as the untyped one
+  TraitsTestData data{};
+  data.position[1] = 12.5;
+  data.label[0] = 'x';
+  data.counter = -3;
+  WriteLog typed_log;
+  WriteLog untyped_log;
+  {
+    ulog_cpp::SimpleWriter typed_writer(typed_log.callback(), 0);
+    ulog_cpp::SimpleWriter untyped_writer(untyped_log.callback(), 0);
+    typed_writer.writeMessageFormat<TraitsTestData>();
+    untyped_writer.writeMessageFormat(
+        "traits_test", {{"uint64_t", "timestamp"},
+                        {"double", "position", 3},
+                        {"float", "values", 12},
+                        {"int32_t", "status"},
+                        {"uint16_t", "flags"},
+                        {"bool", "valid"},
+                        {"char", "label", 3},
+                        {"int8_t", "counter"}});
+    typed_writer.headerComplete();
+    untyped_writer.headerComplete();
+    const ulog_cpp::MessageId<TraitsTestData> typed_id =
+        typed_writer.writeAddLoggedMessage<TraitsTestData>();
+    const uint16_t untyped_id = untyped_writer.writeAddLoggedMessage("traits_test");
+    CHECK_EQ(typed_id.id, untyped_id);
+    for (int i = 0; i < 10; ++i) {
+      data.timestamp = i * 1000;
+      typed_writer.writeData(typed_id, data);
+      untyped_writer.writeData(untyped_id, data);
+    }
+    CHECK_THROWS_AS(typed_writer.writeMessageFormat<TraitsTestData>(), ulog_cpp::UsageException);
+  }
+  CHECK_EQ(typed_log.data, untyped_log.data);
+
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(typed_log.data.data(), static_cast<int>(typed_log.data.size()));
+  CHECK(data_container->parsingErrors().empty());
+  const auto subscription = data_container->subscription("traits_test");
+  REQUIRE_EQ(subscription->size(), 10);
+  CHECK_EQ((*subscription)[3]["timestamp"].as<uint64_t>(), 3000);
+  CHECK_EQ((*subscription)[3]["position"].as<std::vector<double>>()[1], 12.5);
+  CHECK_EQ((*subscription)[3]["counter"].as<int>(), -3);
+}
+
+TEST_CASE("Async writer")
+{
+  const int kNumSamples = 5000;
+  WriteLog log;
+  int num_syncs = 0;
+  auto async_writer = std::make_shared<ulog_cpp::AsyncWriter>(log.callback(), 1024 * 1024, 4096,
+                                                              [&num_syncs]() { ++num_syncs; });
+  {
+    ulog_cpp::SimpleWriter writer(async_writer, 0);
+    writeLog(writer, kNumSamples);
+    writer.fsync();
+    CHECK_EQ(num_syncs, 1);
+  }
+  const auto stats = async_writer->stats();
+  CHECK_EQ(stats.num_dropped, 0);
+  CHECK_EQ(stats.bytes_written, log.data.size());
+  CHECK_GT(stats.num_writes, static_cast<uint64_t>(kNumSamples));
+  CHECK_GE(stats.max_write_latency_ns * stats.num_writes, stats.total_write_latency_ns);
+
+  // Compare against synchronous writing
+  WriteLog sync_log;
+  {
+    ulog_cpp::SimpleWriter writer(sync_log.callback(), 0);
+    writeLog(writer, kNumSamples);
+  }
+  CHECK_EQ(sync_log.data, log.data);
+}
+
+TEST_CASE("Async writer drops data and writes dropouts")
+{
+  const int kNumSamples = 2000;
+  std::atomic<bool> blocked{true};
+  std::vector<uint8_t> written_data;
+  auto async_writer = std::make_shared<ulog_cpp::AsyncWriter>(
+      [&](const uint8_t* data, int length) {
+        while (blocked) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      4096, 1);
+  {
+    ulog_cpp::SimpleWriter writer(async_writer, 0);
+    writeLog(writer, kNumSamples);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    blocked = false;
+    // Does not get dropped, and is preceded by the dropout
+    writer.writeTextMessage(ulog_cpp::Logging::Level::Info, "after dropout", 0);
+    writer.fsync();
+  }
+  const auto stats = async_writer->stats();
+  CHECK_GT(stats.num_dropped, 0);
+  CHECK_EQ(stats.num_dropouts, 1);
+
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(written_data.data(), static_cast<int>(written_data.size()));
+  CHECK(data_container->parsingErrors().empty());
+  REQUIRE_EQ(data_container->dropouts().size(), 1);
+  CHECK_GE(data_container->dropouts()[0].durationMs(), 20);
+  CHECK_EQ(data_container->subscription("my_data")->size() + stats.num_dropped, kNumSamples);
+  REQUIRE_EQ(data_container->logging().size(), 2);
+  CHECK_EQ(data_container->logging()[1].message(), "after dropout");
+}
+
+TEST_CASE("Multi-producer SimpleWriter")
+{
+  const int kNumThreads = 4;
+  const int kNumSamples = 20000;
+  struct ThreadData {
+    uint64_t timestamp;
+    uint32_t thread_index;
+    uint32_t counter;
+  };
+
+  for (const bool use_async_writer : {false, true}) {
+    WriteLog log;
+    std::shared_ptr<ulog_cpp::AsyncWriter> async_writer;
+    std::unique_ptr<ulog_cpp::SimpleWriter> writer;
+    if (use_async_writer) {
+      // Large enough buffer to not drop anything
+      async_writer = std::make_shared<ulog_cpp::AsyncWriter>(log.callback(), 8 * 1024 * 1024);
+      writer = std::make_unique<ulog_cpp::SimpleWriter>(async_writer, 0);
+    } else {
+      writer = std::make_unique<ulog_cpp::SimpleWriter>(log.callback(), 0);
+    }
+    writer->enableMultiProducer(1024);
+    writer->writeMessageFormat("thread_data", {{"uint64_t", "timestamp"},
+                                               {"uint32_t", "thread_index"},
+                                               {"uint32_t", "counter"}});
+    writer->headerComplete();
+
+    std::vector<std::thread> threads;
+    for (int thread_index = 0; thread_index < kNumThreads; ++thread_index) {
+      threads.emplace_back([&writer, thread_index]() {
+        const uint16_t msg_id = writer->writeAddLoggedMessage("thread_data", thread_index);
+        for (int i = 0; i < kNumSamples; ++i) {
+          writer->writeData(msg_id, ThreadData{static_cast<uint64_t>(i) * 1000,
+                                               static_cast<uint32_t>(thread_index),
+                                               static_cast<uint32_t>(i)});
+          if (i == kNumSamples / 2) {
+            writer->writeTextMessage(ulog_cpp::Logging::Level::Info, "half way", i * 1000);
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    writer->fsync();
+    writer.reset();
+    async_writer.reset();
+
+    const auto data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+    ulog_cpp::Reader reader{data_container};
+    reader.readChunk(log.data.data(), static_cast<int>(log.data.size()));
+    CHECK(data_container->parsingErrors().empty());
+    CHECK_EQ(data_container->logging().size(), kNumThreads);
+    for (int thread_index = 0; thread_index < kNumThreads; ++thread_index) {
+      const auto subscription = data_container->subscription("thread_data", thread_index);
+      REQUIRE_EQ(subscription->size(), kNumSamples);
+      bool in_order = true;
+      for (int i = 0; i < kNumSamples; ++i) {
+        const auto sample = (*subscription)[i];
+        in_order = in_order && sample["counter"].as<uint32_t>() == static_cast<uint32_t>(i) &&
+                   sample["thread_index"].as<int>() == thread_index;
+      }
+      CHECK(in_order);
+    }
+  }
+}
+
+TEST_CASE("Gather-I/O serialization")
+{
+  const ulog_cpp::MessageInfo info("sys_name", "ULogExampleWriter");
+  const ulog_cpp::Logging logging(ulog_cpp::Logging::Level::Info, "Hello", 1234);
+  const ulog_cpp::Data small_data(3, std::vector<uint8_t>(16, 0x11));
+  const ulog_cpp::Data large_data(4, std::vector<uint8_t>(1000, 0x22));
+
+  WriteLog reference;
+  info.serialize(reference.callback());
+  logging.serialize(reference.callback());
+  ulog_cpp::Dropout(10).serialize(reference.callback());
+  small_data.serialize(reference.callback());
+  large_data.serialize(reference.callback());
+
+  ulog_cpp::SegmentBuffer buffer(128);
+  info.serialize(buffer);
+  logging.serialize(buffer);
+  ulog_cpp::Dropout(10).serialize(buffer.copyCallback());
+  small_data.serialize(buffer);
+  large_data.serialize(buffer);
+
+  std::vector<uint8_t> gathered;
+  buffer.forEachSegment([&](const ulog_cpp::WriteSegment& segment) {
+    gathered.insert(gathered.end(), segment.data, segment.data + segment.length);
+  });
+  CHECK_EQ(gathered, reference.data);
+  CHECK_EQ(buffer.size(), reference.data.size());
+
+  // Small parts are merged into a single copied segment, the large payload is referenced
+  const auto segments = buffer.segments();
+  REQUIRE_EQ(segments.size(), 2);
+  CHECK_EQ(segments[1].data, large_data.data().data());
+  CHECK_EQ(segments[1].length, large_data.data().size());
+
+  buffer.clear();
+  CHECK(buffer.empty());
+  CHECK_EQ(buffer.numSegments(), 0);
+}
+
+#ifndef _WIN32
+TEST_CASE("Preallocated file sink")
+{
+  const int kNumSamples = 5000;
+  WriteLog reference;
+  {
+    ulog_cpp::SimpleWriter writer(reference.callback(), 0);
+    writeLog(writer, kNumSamples);
+  }
+
+  const std::string filename =
+      (std::filesystem::temp_directory_path() / "ulog_cpp_preallocated_test.ulg").string();
+  for (const bool direct_io : {false, true}) {
+    ulog_cpp::PreallocatedFileSinkOptions options;
+    options.preallocation_step = 32 * 1024;
+    options.block_size = 8192;
+    options.direct_io = direct_io;
+    options.sync_interval_bytes = 16 * 1024;
+    auto file_sink = std::make_unique<ulog_cpp::PreallocatedFileSink>(filename, options);
+    const auto* file_sink_ptr = file_sink.get();
+    {
+      ulog_cpp::SimpleWriter writer(std::move(file_sink), 0);
+      writeLog(writer, kNumSamples);
+      // The file is extended in steps of the preallocation size
+      CHECK_EQ(file_sink_ptr->size(), reference.data.size());
+      CHECK_EQ(std::filesystem::file_size(filename) % options.preallocation_step, 0);
+      CHECK_GT(std::filesystem::file_size(filename), reference.data.size());
+
+      // After a sync, all data is in the file
+      writer.fsync();
+      const auto synced_data = readFile(filename);
+      REQUIRE_GE(synced_data.size(), reference.data.size());
+      CHECK(std::equal(reference.data.begin(), reference.data.end(), synced_data.begin()));
+    }
+    // On close, the file is truncated
+    CHECK_EQ(readFile(filename), reference.data);
+  }
+  std::filesystem::remove(filename);
+
+  ulog_cpp::PreallocatedFileSinkOptions invalid_options;
+  invalid_options.block_size = 1000;
+  CHECK_THROWS_AS(ulog_cpp::PreallocatedFileSink(filename, invalid_options),
+                  ulog_cpp::UsageException);
+}
+
+TEST_CASE("Memory-mapped file sink")
+{
+  const int kNumSamples = 5000;
+  WriteLog reference;
+  {
+    ulog_cpp::SimpleWriter writer(reference.callback(), 0);
+    writeLog(writer, kNumSamples);
+  }
+
+  const std::string filename =
+      (std::filesystem::temp_directory_path() / "ulog_cpp_mmap_test.ulg").string();
+  {
+    // Small growth step, so the mapping is extended several times
+    const uint64_t growth_step = 16 * 1024;
+    auto file_sink = std::make_unique<ulog_cpp::MmapFileSink>(filename, growth_step);
+    const auto* file_sink_ptr = file_sink.get();
+    ulog_cpp::SimpleWriter writer(std::move(file_sink), 0);
+    writeLog(writer, kNumSamples);
+    CHECK_EQ(file_sink_ptr->size(), reference.data.size());
+    CHECK_GT(reference.data.size(), 4 * growth_step);
+    CHECK_EQ(std::filesystem::file_size(filename) % growth_step, 0);
+
+    writer.fsync();
+    const auto synced_data = readFile(filename);
+    REQUIRE_GE(synced_data.size(), reference.data.size());
+    CHECK(std::equal(reference.data.begin(), reference.data.end(), synced_data.begin()));
+  }
+  CHECK_EQ(readFile(filename), reference.data);
+  std::filesystem::remove(filename);
+}
+#endif
+
+TEST_SUITE_END();
@@ -0,0 +1,268 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "async_writer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace ulog_cpp {
+
+AsyncWriter::AsyncWriter(DataWriteCB data_write_cb, int buffer_size, int write_block_size,
+                         std::function<void()> sync_cb)
+    : _data_write_cb(std::move(data_write_cb)),
+      _sync_cb(std::move(sync_cb)),
+      _write_block_size(std::max(write_block_size, 1))
+{
+  if (buffer_size < 1024) {
+    throw UsageException("AsyncWriter buffer too small");
+  }
+  _buffer.resize(buffer_size);
+  _thread = std::thread([this]() { threadMain(); });
+}
+
+AsyncWriter::~AsyncWriter()
+{
+  {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _should_exit = true;
+  }
+  _data_cv.notify_one();
+  _thread.join();
+}
+
+size_t AsyncWriter::freeSpace(size_t length)
+{
+  // Only read the writer thread's position (and its cache line) if needed
+  if (_buffer.size() - (_head - _cached_tail) < length) {
+    _cached_tail = _tail.load(std::memory_order_acquire);
+  }
+  return _buffer.size() - (_head - _cached_tail);
+}
+
+void AsyncWriter::copyIn(const uint8_t* data, size_t length)
+{
+  const size_t index = _head % _buffer.size();
+  const size_t first = std::min(length, _buffer.size() - index);
+  memcpy(_buffer.data() + index, data, first);
+  memcpy(_buffer.data(), data + first, length - first);
+  _head += length;
+}
+
+void AsyncWriter::updateStats(Clock::time_point start, size_t length)
+{
+  _published_head.store(_head, std::memory_order_release);
+  if (_head - _notified_head >= _write_block_size) {
+    // Wake up the writer thread once per block
+    _notified_head = _head;
+    _data_cv.notify_one();
+    _cached_tail = _tail.load(std::memory_order_acquire);
+    const size_t fill = _head - _cached_tail;
+    if (fill > _max_buffer_fill.load(std::memory_order_relaxed)) {
+      _max_buffer_fill.store(fill, std::memory_order_relaxed);
+    }
+  }
+
+  const uint64_t latency_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  _num_writes.store(_num_writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  _total_write_latency_ns.store(
+      _total_write_latency_ns.load(std::memory_order_relaxed) + latency_ns,
+      std::memory_order_relaxed);
+  if (latency_ns > _max_write_latency_ns.load(std::memory_order_relaxed)) {
+    _max_write_latency_ns.store(latency_ns, std::memory_order_relaxed);
+  }
+}
+
+bool AsyncWriter::writeDropoutIfPending(size_t additional_length)
+{
+  if (!_dropout_pending) {
+    return true;
+  }
+  ulog_message_dropout_s dropout_msg;
+  if (freeSpace(sizeof(dropout_msg) + additional_length) <
+      sizeof(dropout_msg) + additional_length) {
+    return false;
+  }
+  const auto duration_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - _dropout_start)
+          .count();
+  dropout_msg.duration = static_cast<uint16_t>(
+      std::clamp<int64_t>(duration_ms, 1, std::numeric_limits<uint16_t>::max()));
+  copyIn(reinterpret_cast<const uint8_t*>(&dropout_msg), sizeof(dropout_msg));
+  _dropout_pending = false;
+  _num_dropouts.store(_num_dropouts.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+  return true;
+}
+
+void AsyncWriter::write(const uint8_t* data, int length)
+{
+  throwIfFailed();
+  const auto start = Clock::now();
+  if (static_cast<size_t>(length) + sizeof(ulog_message_dropout_s) > _buffer.size()) {
+    throw UsageException("AsyncWriter buffer too small for message");
+  }
+  const size_t head_before = _head;
+  while (!writeDropoutIfPending(length) || freeSpace(length) < static_cast<size_t>(length)) {
+    throwIfFailed();
+    _data_cv.notify_one();
+    std::this_thread::yield();
+  }
+  copyIn(data, length);
+  updateStats(start, _head - head_before);
+}
+
+bool AsyncWriter::writeData(uint16_t msg_id, const uint8_t* payload, int length)
+{
+  throwIfFailed();
+  const auto start = Clock::now();
+  const int msg_size = length + 2;
+  if (msg_size > std::numeric_limits<uint16_t>::max()) {
+    throw ParsingException("message too long");
+  }
+  ulog_message_data_s data_msg;
+  data_msg.msg_id = msg_id;
+  data_msg.msg_size = msg_size;
+  const size_t header_size = ULOG_MSG_HEADER_LEN + 2;
+  const size_t total_size = header_size + length;
+
+  const size_t head_before = _head;
+  if (!writeDropoutIfPending(total_size) || freeSpace(total_size) < total_size) {
+    markDropped(start, total_size, 1);
+    return false;
+  }
+  copyIn(reinterpret_cast<const uint8_t*>(&data_msg), header_size);
+  copyIn(payload, length);
+  updateStats(start, _head - head_before);
+  return true;
+}
+
+bool AsyncWriter::tryWrite(const uint8_t* data, int length, int num_messages)
+{
+  throwIfFailed();
+  const auto start = Clock::now();
+  const size_t head_before = _head;
+  if (!writeDropoutIfPending(length) || freeSpace(length) < static_cast<size_t>(length)) {
+    markDropped(start, length, num_messages);
+    return false;
+  }
+  copyIn(data, length);
+  updateStats(start, _head - head_before);
+  return true;
+}
+
+void AsyncWriter::markDropped(Clock::time_point start, size_t length, int num_messages)
+{
+  if (!_dropout_pending) {
+    _dropout_pending = true;
+    _dropout_start = start;
+  }
+  _num_dropped.store(_num_dropped.load(std::memory_order_relaxed) + num_messages,
+                     std::memory_order_relaxed);
+  _dropped_bytes.store(_dropped_bytes.load(std::memory_order_relaxed) + length,
+                       std::memory_order_relaxed);
+  updateStats(start, 0);
+}
+
+void AsyncWriter::sync()
+{
+  throwIfFailed();
+  {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _sync_requested_position = _head;
+    _sync_requested = true;
+    _sync_done = false;
+  }
+  _data_cv.notify_one();
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _sync_cv.wait(lock, [this]() { return _sync_done; });
+  }
+  throwIfFailed();
+}
+
+AsyncWriter::Stats AsyncWriter::stats() const
+{
+  Stats stats;
+  stats.bytes_written = _bytes_written.load(std::memory_order_relaxed);
+  stats.num_writes = _num_writes.load(std::memory_order_relaxed);
+  stats.num_dropped = _num_dropped.load(std::memory_order_relaxed);
+  stats.num_dropouts = _num_dropouts.load(std::memory_order_relaxed);
+  stats.dropped_bytes = _dropped_bytes.load(std::memory_order_relaxed);
+  stats.max_write_latency_ns = _max_write_latency_ns.load(std::memory_order_relaxed);
+  stats.total_write_latency_ns = _total_write_latency_ns.load(std::memory_order_relaxed);
+  stats.max_buffer_fill = _max_buffer_fill.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void AsyncWriter::throwIfFailed()
+{
+  if (_failed.load()) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    std::rethrow_exception(_error);
+  }
+}
+
+void AsyncWriter::threadMain()
+{
+  bool should_exit = false;
+  while (!should_exit) {
+    bool sync_requested;
+    size_t sync_position;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      // The producer notifies without holding the lock, so a wakeup can get lost. The timeout
+      // bounds the resulting delay.
+      _data_cv.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+        return _should_exit || _sync_requested ||
+               _published_head.load(std::memory_order_acquire) - _tail.load() >=
+                   _write_block_size;
+      });
+      should_exit = _should_exit;
+      sync_requested = _sync_requested;
+      sync_position = _sync_requested_position;
+    }
+
+    const size_t head = _published_head.load(std::memory_order_acquire);
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    try {
+      while (tail != head) {
+        const size_t index = tail % _buffer.size();
+        const size_t length = std::min(head - tail, _buffer.size() - index);
+        if (!_failed.load(std::memory_order_relaxed)) {
+          _data_write_cb(_buffer.data() + index, static_cast<int>(length));
+          _bytes_written.store(_bytes_written.load(std::memory_order_relaxed) + length,
+                               std::memory_order_relaxed);
+        }
+        tail += length;
+        _tail.store(tail, std::memory_order_release);
+      }
+      if (sync_requested && tail >= sync_position && _sync_cb &&
+          !_failed.load(std::memory_order_relaxed)) {
+        _sync_cb();
+      }
+    } catch (...) {
+      // Discard everything from now on, the producer gets the exception on the next call
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _error = std::current_exception();
+      _failed.store(true);
+      _tail.store(head, std::memory_order_release);
+    }
+
+    if (sync_requested && _tail.load() >= sync_position) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _sync_requested = false;
+      _sync_done = true;
+      _sync_cv.notify_all();
+    }
+    if (should_exit && _tail.load() != _published_head.load(std::memory_order_acquire)) {
+      should_exit = false;  // drain everything before exiting
+    }
+  }
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,144 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Asynchronous output stage for serialized ULog data: the producer copies messages into a
+ * lock-free single-producer/single-consumer ring buffer, and a background thread writes it out in
+ * large blocks.
+ *
+ * Data messages never block the producer: if the buffer is full, they are dropped and a Dropout
+ * message with the measured duration is inserted before the next message that fits (as the PX4
+ * logger does). All other messages wait for free space, as dropping them would make the log
+ * unreadable.
+ *
+ * Only a single producer thread may call write(), writeData(), tryWrite() and sync() at a time.
+ */
+class AsyncWriter {
+ public:
+  struct Stats {
+    uint64_t bytes_written{0};           ///< bytes passed to the write callback
+    uint64_t num_writes{0};              ///< number of calls to write(), writeData(), tryWrite()
+    uint64_t num_dropped{0};             ///< number of dropped data messages
+    uint64_t num_dropouts{0};            ///< number of written Dropout messages
+    uint64_t dropped_bytes{0};           ///< bytes of dropped data messages
+    uint64_t max_write_latency_ns{0};    ///< maximum time spent in a single write call
+    uint64_t total_write_latency_ns{0};  ///< total time spent in write calls
+    uint64_t max_buffer_fill{0};         ///< ring buffer high watermark (sampled per block)
+  };
+
+  /**
+   * Constructor, starts the writer thread.
+   * @param data_write_cb called from the writer thread with blocks of serialized data
+   * @param buffer_size ring buffer size [bytes]
+   * @param write_block_size the writer thread waits until at least this amount of data is
+   * available (or 100 ms passed) before calling data_write_cb
+   * @param sync_cb optional callback called from the writer thread on sync(), e.g. to fsync()
+   */
+  AsyncWriter(DataWriteCB data_write_cb, int buffer_size, int write_block_size = 64 * 1024,
+              std::function<void()> sync_cb = nullptr);
+
+  /**
+   * Writes out all remaining data and stops the thread
+   */
+  ~AsyncWriter();
+
+  AsyncWriter(const AsyncWriter&) = delete;
+  AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+  /**
+   * Enqueue a (part of a) message. Waits if there is not enough space in the buffer.
+   */
+  void write(const uint8_t* data, int length);
+
+  /**
+   * Enqueue a data message. Does not wait: if there is not enough space, the message is dropped.
+   * @return true if enqueued, false if dropped
+   */
+  bool writeData(uint16_t msg_id, const uint8_t* payload, int length);
+
+  /**
+   * Enqueue a block of serialized data messages. Does not wait: if there is not enough space,
+   * the whole block is dropped.
+   * @param num_messages number of data messages in the block (for the statistics)
+   * @return true if enqueued, false if dropped
+   */
+  bool tryWrite(const uint8_t* data, int length, int num_messages);
+
+  /**
+   * Wait until all enqueued data is written, then call the sync callback.
+   */
+  void sync();
+
+  Stats stats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  size_t freeSpace(size_t length);
+  void copyIn(const uint8_t* data, size_t length);
+  bool writeDropoutIfPending(size_t additional_length);
+  void markDropped(Clock::time_point start, size_t length, int num_messages);
+  void updateStats(Clock::time_point start, size_t length);
+  void throwIfFailed();
+  void threadMain();
+
+  const DataWriteCB _data_write_cb;
+  const std::function<void()> _sync_cb;
+  const size_t _write_block_size;
+
+  std::vector<uint8_t> _buffer;
+
+  // Monotonically increasing positions, the buffer index is position % buffer size.
+  // Producer and writer thread data are kept on separate cache lines.
+  alignas(64) std::atomic<size_t> _tail{0};  ///< written by the writer thread only
+  alignas(64) std::atomic<size_t> _published_head{0};
+
+  // Producer state
+  alignas(64) size_t _head{0};
+  size_t _cached_tail{0};    ///< last value of _tail seen by the producer
+  size_t _notified_head{0};  ///< _head when the writer thread was last notified
+  bool _dropout_pending{false};
+  Clock::time_point _dropout_start;
+
+  // Statistics (written by the producer, relaxed reads from stats())
+  std::atomic<uint64_t> _num_writes{0};
+  std::atomic<uint64_t> _num_dropped{0};
+  std::atomic<uint64_t> _num_dropouts{0};
+  std::atomic<uint64_t> _dropped_bytes{0};
+  std::atomic<uint64_t> _max_write_latency_ns{0};
+  std::atomic<uint64_t> _total_write_latency_ns{0};
+  std::atomic<uint64_t> _max_buffer_fill{0};
+  std::atomic<uint64_t> _bytes_written{0};
+
+  // Writer thread signaling. The producer only notifies, it never takes the mutex on the data path
+  std::mutex _mutex;
+  std::condition_variable _data_cv;
+  std::condition_variable _sync_cv;
+  bool _should_exit{false};
+  size_t _sync_requested_position{0};
+  bool _sync_requested{false};
+  bool _sync_done{false};
+  std::atomic<bool> _failed{false};
+  std::exception_ptr _error;
+
+  std::thread _thread;
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,425 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "compressed_samples.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ulog_cpp {
+
+namespace {
+
+int countLeadingZeros(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return value == 0 ? 64 : __builtin_clzll(value);
+#else
+  int count = 0;
+  for (uint64_t mask = 1ULL << 63; mask != 0 && !(value & mask); mask >>= 1) {
+    ++count;
+  }
+  return count;
+#endif
+}
+
+int countTrailingZeros(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return value == 0 ? 64 : __builtin_ctzll(value);
+#else
+  int count = 0;
+  for (uint64_t mask = 1; mask != 0 && !(value & mask); mask <<= 1) {
+    ++count;
+  }
+  return count;
+#endif
+}
+
+uint64_t lowBits(uint64_t value, int num_bits)
+{
+  return num_bits >= 64 ? value : value & ((1ULL << num_bits) - 1);
+}
+
+/**
+ * MSB-first bit stream writer
+ */
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>& bytes) : _bytes(bytes) {}
+
+  void write(uint64_t value, int num_bits)
+  {
+    if (num_bits > 32) {
+      write(value >> 32, num_bits - 32);
+      num_bits = 32;
+    }
+    _accumulator = (_accumulator << num_bits) | lowBits(value, num_bits);
+    _num_bits += num_bits;
+    while (_num_bits >= 8) {
+      _num_bits -= 8;
+      _bytes.push_back(static_cast<uint8_t>(_accumulator >> _num_bits));
+    }
+  }
+
+  void finish()
+  {
+    if (_num_bits > 0) {
+      _bytes.push_back(static_cast<uint8_t>(_accumulator << (8 - _num_bits)));
+      _num_bits = 0;
+    }
+  }
+
+ private:
+  std::vector<uint8_t>& _bytes;
+  uint64_t _accumulator{0};
+  int _num_bits{0};  ///< number of valid bits in _accumulator, < 8 between calls
+};
+
+class BitReader {
+ public:
+  explicit BitReader(const std::vector<uint8_t>& bytes) : _bytes(bytes) {}
+
+  uint64_t read(int num_bits)
+  {
+    if (num_bits > 32) {
+      const uint64_t high = read(num_bits - 32);
+      return (high << 32) | read(32);
+    }
+    if (_position + num_bits > _bytes.size() * 8) {
+      throw ParsingException("Compressed block too short");
+    }
+    uint64_t value = 0;
+    while (num_bits > 0) {
+      const int available = 8 - static_cast<int>(_position & 7);
+      const int take = std::min(available, num_bits);
+      const uint8_t byte = _bytes[_position >> 3];
+      value = (value << take) | ((byte >> (available - take)) & ((1U << take) - 1));
+      _position += take;
+      num_bits -= take;
+    }
+    return value;
+  }
+
+ private:
+  const std::vector<uint8_t>& _bytes;
+  size_t _position{0};
+};
+
+uint64_t load(const uint8_t* data, int size)
+{
+  uint64_t value = 0;
+  memcpy(&value, data, size);  // little endian
+  return value;
+}
+
+int log2(int bits)
+{
+  int result = 0;
+  while ((1 << result) < bits) {
+    ++result;
+  }
+  return result;
+}
+
+// Delta-of-delta buckets: prefix length (number of 1 bits, terminated by 0 except for the last)
+// and number of value bits of the zigzag-encoded value
+constexpr int kDeltaOfDeltaBuckets[] = {7, 9, 12, 20};
+
+void encodeDeltaOfDelta(BitWriter& writer, const uint8_t* data, int stride, uint32_t count,
+                        int size)
+{
+  uint64_t previous = load(data, size);
+  writer.write(previous, size * 8);
+  uint64_t previous_delta = 0;
+  for (uint32_t i = 1; i < count; ++i) {
+    const uint64_t value = load(data + i * stride, size);
+    const uint64_t delta = value - previous;
+    const auto delta_of_delta = static_cast<int64_t>(delta - previous_delta);
+    const uint64_t zigzag =
+        (static_cast<uint64_t>(delta_of_delta) << 1) ^ static_cast<uint64_t>(delta_of_delta >> 63);
+    if (zigzag == 0) {
+      writer.write(0, 1);
+    } else {
+      int bucket = 0;
+      for (; bucket < 4; ++bucket) {
+        if (zigzag < (1ULL << kDeltaOfDeltaBuckets[bucket])) {
+          break;
+        }
+      }
+      if (bucket < 4) {
+        // 'bucket + 1' ones, followed by a zero
+        writer.write(((1ULL << (bucket + 1)) - 1) << 1, bucket + 2);
+        writer.write(zigzag, kDeltaOfDeltaBuckets[bucket]);
+      } else {
+        writer.write(0x1f, 5);
+        writer.write(zigzag, 64);
+      }
+    }
+    previous = value;
+    previous_delta = delta;
+  }
+}
+
+void decodeDeltaOfDelta(BitReader& reader, uint8_t* data, int stride, uint32_t count, int size)
+{
+  uint64_t previous = reader.read(size * 8);
+  memcpy(data, &previous, size);
+  uint64_t previous_delta = 0;
+  for (uint32_t i = 1; i < count; ++i) {
+    int bucket = 0;
+    while (bucket < 5 && reader.read(1) == 1) {
+      ++bucket;
+    }
+    uint64_t zigzag = 0;
+    if (bucket > 0) {
+      zigzag = reader.read(bucket <= 4 ? kDeltaOfDeltaBuckets[bucket - 1] : 64);
+    }
+    const uint64_t delta_of_delta = (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+    const uint64_t delta = previous_delta + delta_of_delta;
+    const uint64_t value = lowBits(previous + delta, size * 8);
+    memcpy(data + i * stride, &value, size);
+    previous = value;
+    previous_delta = delta;
+  }
+}
+
+void encodeXor(BitWriter& writer, const uint8_t* data, int stride, uint32_t count, int size)
+{
+  const int bits = size * 8;
+  const int field_bits = log2(bits);
+  uint64_t previous = load(data, size);
+  writer.write(previous, bits);
+  int window_leading = -1;
+  int window_trailing = 0;
+  for (uint32_t i = 1; i < count; ++i) {
+    const uint64_t value = load(data + i * stride, size);
+    const uint64_t x = value ^ previous;
+    previous = value;
+    if (x == 0) {
+      writer.write(0, 1);
+      continue;
+    }
+    const int leading = countLeadingZeros(x) - (64 - bits);
+    const int trailing = countTrailingZeros(x);
+    if (window_leading >= 0 && leading >= window_leading && trailing >= window_trailing) {
+      // Reuse the previous window of meaningful bits
+      writer.write(0b10, 2);
+      writer.write(x >> window_trailing, bits - window_leading - window_trailing);
+    } else {
+      const int length = bits - leading - trailing;
+      writer.write(0b11, 2);
+      writer.write(leading, field_bits);
+      writer.write(length - 1, field_bits);
+      writer.write(x >> trailing, length);
+      window_leading = leading;
+      window_trailing = trailing;
+    }
+  }
+}
+
+void decodeXor(BitReader& reader, uint8_t* data, int stride, uint32_t count, int size)
+{
+  const int bits = size * 8;
+  const int field_bits = log2(bits);
+  uint64_t previous = reader.read(bits);
+  memcpy(data, &previous, size);
+  int window_leading = 0;
+  int window_trailing = 0;
+  for (uint32_t i = 1; i < count; ++i) {
+    if (reader.read(1) == 1) {
+      if (reader.read(1) == 1) {
+        window_leading = static_cast<int>(reader.read(field_bits));
+        const int length = static_cast<int>(reader.read(field_bits)) + 1;
+        window_trailing = bits - window_leading - length;
+        if (window_trailing < 0) {
+          throw ParsingException("Invalid compressed block");
+        }
+      }
+      const int length = bits - window_leading - window_trailing;
+      previous ^= reader.read(length) << window_trailing;
+    }
+    memcpy(data + i * stride, &previous, size);
+  }
+}
+
+}  // namespace
+
+CompressedSamples::CompressedSamples(std::shared_ptr<MessageFormat> format, int block_size)
+    : _format(std::move(format)), _block_size(std::max(block_size, 1))
+{
+  _format_size = _format->sizeBytes();
+  for (const auto& leaf : _format->layout()) {
+    const bool is_integer64 =
+        leaf.type == Field::BasicType::UINT64 || leaf.type == Field::BasicType::INT64;
+    for (int i = 0; i < leaf.count; ++i) {
+      _columns.push_back({leaf.offset + i * leaf.size, leaf.size,
+                          is_integer64 ? Encoding::DeltaOfDelta : Encoding::Xor});
+    }
+  }
+  std::sort(_columns.begin(), _columns.end(),
+            [](const Column& a, const Column& b) { return a.offset < b.offset; });
+  // The layout of a resolved format covers every byte
+  int offset = 0;
+  for (const auto& column : _columns) {
+    if (column.offset != offset) {
+      throw UsageException("Unsupported layout of " + _format->name());
+    }
+    offset += column.size;
+  }
+  _pending.reserve(_block_size);
+}
+
+void CompressedSamples::append(const Data& sample)
+{
+  if (!_pending.empty() && _pending.front().msgId() != sample.msgId()) {
+    compressPending();
+  }
+  _pending.push_back(sample);
+  _pending_bytes += sample.data().size();
+  if (static_cast<int>(_pending.size()) >= _block_size) {
+    compressPending();
+  }
+}
+
+void CompressedSamples::compressPending()
+{
+  if (_pending.empty()) {
+    return;
+  }
+  Block block;
+  block.first_sample = _num_compressed;
+  block.msg_id = _pending.front().msgId();
+  block.num_samples = static_cast<uint32_t>(_pending.size());
+  block.sample_size = static_cast<int>(_pending.front().data().size());
+  size_t total_size = 0;
+  for (const auto& sample : _pending) {
+    const int sample_size = static_cast<int>(sample.data().size());
+    if (sample_size != block.sample_size) {
+      block.sample_size = -1;
+    }
+    block.raw = block.raw || sample_size > _format_size;
+    total_size += sample_size;
+  }
+  if (block.sample_size == -1) {
+    for (const auto& sample : _pending) {
+      block.sample_sizes.push_back(static_cast<uint16_t>(sample.data().size()));
+    }
+  }
+
+  if (block.raw) {
+    block.data.reserve(total_size);
+    for (const auto& sample : _pending) {
+      block.data.insert(block.data.end(), sample.data().begin(), sample.data().end());
+    }
+  } else {
+    // Transpose into a zero-padded row buffer (PX4 omits trailing padding in samples)
+    std::vector<uint8_t> rows(static_cast<size_t>(_format_size) * block.num_samples, 0);
+    for (uint32_t i = 0; i < block.num_samples; ++i) {
+      const auto& data = _pending[i].data();
+      std::copy(data.begin(), data.end(), rows.begin() + static_cast<size_t>(i) * _format_size);
+    }
+    BitWriter writer(block.data);
+    for (const auto& column : _columns) {
+      const uint8_t* column_data = rows.data() + column.offset;
+      if (column.encoding == Encoding::DeltaOfDelta) {
+        encodeDeltaOfDelta(writer, column_data, _format_size, block.num_samples, column.size);
+      } else {
+        encodeXor(writer, column_data, _format_size, block.num_samples, column.size);
+      }
+    }
+    writer.finish();
+  }
+  block.data.shrink_to_fit();
+  _num_compressed += block.num_samples;
+  _block_bytes += block.data.capacity() + block.sample_sizes.capacity() * sizeof(uint16_t);
+  _blocks.push_back(std::move(block));
+  _pending.clear();
+  _pending_bytes = 0;
+}
+
+void CompressedSamples::appendDecoded(const Block& block, std::vector<Data>& samples) const
+{
+  const auto sampleSize = [&block](uint32_t i) {
+    return block.sample_size >= 0 ? block.sample_size : block.sample_sizes[i];
+  };
+  if (block.raw) {
+    size_t offset = 0;
+    for (uint32_t i = 0; i < block.num_samples; ++i) {
+      const auto begin = block.data.begin() + offset;
+      offset += sampleSize(i);
+      samples.emplace_back(block.msg_id, std::vector<uint8_t>(begin, block.data.begin() + offset));
+    }
+    return;
+  }
+  std::vector<uint8_t> rows(static_cast<size_t>(_format_size) * block.num_samples);
+  BitReader reader(block.data);
+  for (const auto& column : _columns) {
+    uint8_t* column_data = rows.data() + column.offset;
+    if (column.encoding == Encoding::DeltaOfDelta) {
+      decodeDeltaOfDelta(reader, column_data, _format_size, block.num_samples, column.size);
+    } else {
+      decodeXor(reader, column_data, _format_size, block.num_samples, column.size);
+    }
+  }
+  for (uint32_t i = 0; i < block.num_samples; ++i) {
+    const auto begin = rows.begin() + static_cast<size_t>(i) * _format_size;
+    samples.emplace_back(block.msg_id, std::vector<uint8_t>(begin, begin + sampleSize(i)));
+  }
+}
+
+size_t CompressedSamples::findBlock(size_t sample_index) const
+{
+  if (sample_index >= size()) {
+    throw AccessException("Sample index out of range: " + std::to_string(sample_index));
+  }
+  if (sample_index >= _num_compressed) {
+    return _blocks.size();
+  }
+  const auto block = std::upper_bound(
+      _blocks.begin(), _blocks.end(), sample_index,
+      [](size_t index, const Block& other) { return index < other.first_sample; });
+  return static_cast<size_t>(block - _blocks.begin()) - 1;
+}
+
+size_t CompressedSamples::blockStart(size_t block_index) const
+{
+  if (block_index < _blocks.size()) {
+    return _blocks[block_index].first_sample;
+  }
+  if (block_index == _blocks.size() && !_pending.empty()) {
+    return _num_compressed;
+  }
+  throw AccessException("Block index out of range: " + std::to_string(block_index));
+}
+
+void CompressedSamples::decodeBlock(size_t block_index, std::vector<Data>& samples) const
+{
+  samples.clear();
+  if (block_index < _blocks.size()) {
+    appendDecoded(_blocks[block_index], samples);
+  } else if (block_index == _blocks.size() && !_pending.empty()) {
+    samples = _pending;
+  } else {
+    throw AccessException("Block index out of range: " + std::to_string(block_index));
+  }
+}
+
+void CompressedSamples::decodeAll(std::vector<Data>& samples) const
+{
+  samples.reserve(samples.size() + size());
+  for (const auto& block : _blocks) {
+    appendDecoded(block, samples);
+  }
+  samples.insert(samples.end(), _pending.begin(), _pending.end());
+}
+
+uint64_t CompressedSamples::memoryUsage() const
+{
+  return _blocks.capacity() * sizeof(Block) + _block_bytes + _pending.capacity() * sizeof(Data) +
+         _pending_bytes;
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,107 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Compressed in-memory storage for the samples of a subscription.
+ *
+ * Samples are compressed in blocks of a fixed number of samples. Within a block, each basic-type
+ * element of the message format (@see MessageFormat::layout()) is stored as a column:
+ * - 64 bit integers (e.g. timestamps) with delta-of-delta encoding
+ * - all other types with XOR encoding against the previous value (as in Facebook's Gorilla),
+ *   which is efficient for slowly changing floats and constant values.
+ * Blocks are decompressed individually, so consumers can process a subscription block by block.
+ * The last, incomplete block is kept uncompressed.
+ */
+class CompressedSamples {
+ public:
+  static constexpr int kDefaultBlockSize = 512;
+
+  /**
+   * @param format resolved message format of the samples
+   * @param block_size number of samples per block
+   */
+  explicit CompressedSamples(std::shared_ptr<MessageFormat> format,
+                             int block_size = kDefaultBlockSize);
+
+  void append(const Data& sample);
+
+  size_t size() const { return _num_compressed + _pending.size(); }
+
+  /**
+   * @return number of blocks, including the incomplete one
+   */
+  size_t numBlocks() const { return _blocks.size() + (_pending.empty() ? 0 : 1); }
+
+  /**
+   * @return index of the block containing the sample with the given index
+   */
+  size_t findBlock(size_t sample_index) const;
+
+  /**
+   * @return index of the first sample of a block
+   */
+  size_t blockStart(size_t block_index) const;
+
+  /**
+   * Decode a single block, replacing the contents of samples
+   */
+  void decodeBlock(size_t block_index, std::vector<Data>& samples) const;
+
+  /**
+   * Decode all samples, appending them to samples
+   */
+  void decodeAll(std::vector<Data>& samples) const;
+
+  /**
+   * @return estimated heap memory used in bytes
+   */
+  uint64_t memoryUsage() const;
+
+ private:
+  enum class Encoding : uint8_t {
+    DeltaOfDelta,
+    Xor,
+  };
+
+  struct Column {
+    int offset;
+    int size;  ///< 1, 2, 4 or 8 bytes
+    Encoding encoding;
+  };
+
+  struct Block {
+    size_t first_sample{};  ///< index of the first sample in the subscription
+    uint16_t msg_id{};
+    uint32_t num_samples{};
+    int sample_size{};                  ///< payload size of all samples, -1 if they differ
+    std::vector<uint16_t> sample_sizes;  ///< per sample, if sample_size == -1
+    bool raw{false};                     ///< samples are concatenated uncompressed (fallback)
+    std::vector<uint8_t> data;
+  };
+
+  void compressPending();
+  void appendDecoded(const Block& block, std::vector<Data>& samples) const;
+
+  const std::shared_ptr<MessageFormat> _format;
+  const int _block_size;
+  int _format_size{};
+  std::vector<Column> _columns;
+  std::vector<Block> _blocks;
+  size_t _num_compressed{0};
+  uint64_t _block_bytes{0};  ///< heap memory of the blocks' data
+  std::vector<Data> _pending;
+  uint64_t _pending_bytes{0};  ///< payload size of _pending
+};
+
+}  // namespace ulog_cpp
@@ -5,12 +5,153 @@
 
 #include "data_container.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace ulog_cpp {
 
 DataContainer::DataContainer(DataContainer::StorageConfig storage_config)
     : _storage_config(storage_config)
 {
 }
+void DataContainer::enableMessageIndex()
+{
+  if (_storage_config == StorageConfig::Header) {
+    throw UsageException("Message index requires StorageConfig::FullLog or StorageConfig::Lazy");
+  }
+  for (const auto& [name, policy] : _decimation_policies) {
+    if (!policy.appendOnly()) {
+      throw UsageException("Decimation policy cannot be combined with the message index");
+    }
+  }
+  if (!_default_decimation_policy.appendOnly()) {
+    throw UsageException("Decimation policy cannot be combined with the message index");
+  }
+  _message_index_enabled = true;
+}
+void DataContainer::setDecimationPolicy(const std::string& message_name,
+                                        const DecimationPolicy& policy)
+{
+  checkDecimationPolicy(policy);
+  _decimation_policies[message_name] = policy;
+}
+void DataContainer::setDefaultDecimationPolicy(const DecimationPolicy& policy)
+{
+  checkDecimationPolicy(policy);
+  _default_decimation_policy = policy;
+}
+void DataContainer::checkDecimationPolicy(const DecimationPolicy& policy) const
+{
+  if (policy.type == DecimationPolicy::Type::KeepAll) {
+    return;
+  }
+  if (_storage_config != StorageConfig::FullLog) {
+    throw UsageException("Decimation requires StorageConfig::FullLog");
+  }
+  if (!_subscriptions_by_message_id.empty()) {
+    throw UsageException("Decimation policies must be set before parsing");
+  }
+  if (_message_index_enabled && !policy.appendOnly()) {
+    throw UsageException("Decimation policy cannot be combined with the message index");
+  }
+}
+void DataContainer::setLazySource(std::shared_ptr<const MappedFile> file)
+{
+  if (_storage_config != StorageConfig::Lazy) {
+    throw UsageException("Lazy source requires StorageConfig::Lazy");
+  }
+  if (!_subscriptions_by_message_id.empty()) {
+    throw UsageException("Lazy source must be set before parsing");
+  }
+  _lazy_source = std::move(file);
+}
+void DataContainer::enableCompression(int block_size)
+{
+  if (_storage_config != StorageConfig::FullLog) {
+    throw UsageException("Compression requires StorageConfig::FullLog");
+  }
+  if (!_subscriptions_by_message_id.empty()) {
+    throw UsageException("Compression must be enabled before parsing");
+  }
+  if (block_size <= 0) {
+    throw UsageException("Invalid compression block size");
+  }
+  _compression_block_size = block_size;
+}
+void DataContainer::evictDecodedSamples()
+{
+  for (auto& [msg_id, subscription] : _subscriptions_by_message_id) {
+    subscription->evict();
+  }
+}
+void DataContainer::setMemoryBudget(uint64_t budget_bytes, const std::string& spill_directory)
+{
+  if (_storage_config != StorageConfig::FullLog) {
+    throw UsageException("Memory budget requires StorageConfig::FullLog");
+  }
+  if (!_subscriptions_by_message_id.empty()) {
+    throw UsageException("Memory budget must be set before parsing");
+  }
+  _memory_budget = budget_bytes > 0 ? std::make_shared<MemoryBudget>(budget_bytes) : nullptr;
+  _next_budget_check = budget_bytes;
+  _spill_directory = spill_directory;
+}
+uint64_t DataContainer::memoryUsage() const
+{
+  uint64_t usage = 0;
+  for (const auto& [msg_id, subscription] : _subscriptions_by_message_id) {
+    usage += subscription->memoryUsage();
+  }
+  return usage;
+}
+bool DataContainer::memoryBudgetExceeded() const
+{
+  return _memory_budget && _memory_budget->exceeded();
+}
+void DataContainer::enforceMemoryBudget()
+{
+  // Spill down to a fraction of the budget, so this does not run again on the next sample
+  const uint64_t budget = _memory_budget->budget();
+  const uint64_t target = budget / 4 * 3;
+  std::vector<std::pair<uint64_t, Subscription*>> usages;
+  uint64_t usage = 0;
+  for (const auto& [msg_id, subscription] : _subscriptions_by_message_id) {
+    usages.emplace_back(subscription->memoryUsage(), subscription.get());
+    usage += usages.back().first;
+  }
+  std::sort(usages.begin(), usages.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (const auto& [subscription_usage, subscription] : usages) {
+    if (usage <= target) {
+      break;
+    }
+    if (subscription->isDecimated()) {
+      continue;
+    }
+    if (subscription->isSpilled() || subscription->isCompressed()) {
+      subscription->evict();
+    } else {
+      if (!_spill_file) {
+        _spill_file = std::make_shared<SpillFile>(_spill_directory);
+      }
+      subscription->spill(_spill_file);
+    }
+    usage = usage - subscription_usage + subscription->memoryUsage();
+  }
+  // If still over the budget, the sample offsets of spilled subscriptions, and compressed or
+  // decimated samples exceed it on their own
+  _memory_budget->set(usage);
+  // Check again once the usage grew by a quarter of the budget, or exceeds the budget
+  _next_budget_check = std::max(budget, usage + budget / 4);
+}
+const MessageIndex& DataContainer::messageIndex()
+{
+  if (!_message_index_enabled) {
+    throw UsageException("Message index not enabled");
+  }
+  _message_index.finalize();
+  return _message_index;
+}
 void DataContainer::error(const std::string& msg, bool is_recoverable)
 {
   if (!is_recoverable) {
@@ -20,6 +161,9 @@ void DataContainer::error(const std::string& msg, bool is_recoverable)
 }
 void DataContainer::headerComplete()
 {
+  if (_storage_config == StorageConfig::Lazy && !_lazy_source) {
+    throw UsageException("StorageConfig::Lazy requires a lazy source");
+  }
   // try to resolve all fields in message formats
   for (auto& it : _message_formats) {
     auto& message_format = it.second;
@@ -89,10 +233,11 @@ void DataContainer::messageInfo(const MessageInfo& message_info_arg)
 }
 void DataContainer::messageFormat(const MessageFormat& message_format)
 {
-  if (_message_formats.find(message_format.name()) != _message_formats.end()) {
+  auto format = std::make_shared<MessageFormat>(message_format);
+  if (!_message_format_lookup.insert(message_format.name(), format)) {
     throw ParsingException("Duplicate message format");
   }
-  _message_formats.insert({message_format.name(), std::make_shared<MessageFormat>(message_format)});
+  _message_formats.insert({message_format.name(), std::move(format)});
 }
 void DataContainer::parameter(const Parameter& parameter_arg)
 {
@@ -104,6 +249,11 @@ void DataContainer::parameter(const Parameter& parameter_arg)
     // if header is complete, we can resolve definition here
     parameter.field().resolveDefinition(_message_formats, 0);
     _changed_parameters.push_back(parameter);
+    _changed_parameter_timestamps.push_back(_last_timestamp);
+    if (_message_index_enabled) {
+      _message_index.addParameter(static_cast<uint32_t>(_changed_parameters.size() - 1),
+                                  _last_timestamp);
+    }
   } else {
     _initial_parameters.insert({parameter_arg.field().name(), parameter_arg});
   }
@@ -127,18 +277,46 @@ void DataContainer::addLoggedMessage(const AddLoggedMessage& add_logged_message)
     throw ParsingException("Duplicate AddLoggedMessage message ID");
   }
 
-  auto format_iter = _message_formats.find(add_logged_message.messageName());
-  if (format_iter == _message_formats.end()) {
+  const auto* format_ptr = _message_format_lookup.find(add_logged_message.messageName());
+  if (!format_ptr) {
     throw ParsingException("AddLoggedMessage message format not found");
   }
+  const std::shared_ptr<MessageFormat>& format = *format_ptr;
 
   auto new_subscription =
-      std::make_shared<Subscription>(add_logged_message, std::vector<Data>{}, format_iter->second);
+      std::make_shared<Subscription>(add_logged_message, std::vector<Data>{}, format);
+  new_subscription->setMemoryBudget(_memory_budget);
+  if (_storage_config == StorageConfig::Lazy) {
+    new_subscription->setLazySource(_lazy_source);
+  } else {
+    const auto policy_iter = _decimation_policies.find(add_logged_message.messageName());
+    const DecimationPolicy& policy = policy_iter == _decimation_policies.end()
+                                         ? _default_decimation_policy
+                                         : policy_iter->second;
+    if (policy.type != DecimationPolicy::Type::KeepAll) {
+      new_subscription->setDecimation(policy);
+    } else if (_compression_block_size > 0) {
+      new_subscription->compress(_compression_block_size);
+    }
+  }
   _subscriptions_by_message_id.insert({add_logged_message.msgId(), new_subscription});
 
   const NameAndMultiIdKey key{add_logged_message.messageName(),
                               static_cast<int>(add_logged_message.multiId())};
   _subscriptions_by_name_and_multi_id.insert({key, new_subscription});
+
+  // Timestamp field offset, for changed parameter timestamps and the message index
+  const auto timestamp_field = format->findField("timestamp");
+  int offset = -1;
+  if (timestamp_field && timestamp_field->definitionResolved() &&
+      timestamp_field->type().type == Field::BasicType::UINT64 &&
+      timestamp_field->arrayLength() == -1) {
+    offset = timestamp_field->offsetInMessage();
+  }
+  if (add_logged_message.msgId() >= _timestamp_offsets.size()) {
+    _timestamp_offsets.resize(add_logged_message.msgId() + 1, -1);
+  }
+  _timestamp_offsets[add_logged_message.msgId()] = offset;
 }
 void DataContainer::logging(const Logging& logging)
 {
@@ -146,6 +324,9 @@ void DataContainer::logging(const Logging& logging)
     return;
   }
   _logging.emplace_back(std::move(logging));
+  if (_message_index_enabled) {
+    _message_index.addLogging(static_cast<uint32_t>(_logging.size() - 1), logging.timestamp());
+  }
 }
 void DataContainer::data(const Data& data)
 {
@@ -156,7 +337,46 @@ void DataContainer::data(const Data& data)
   if (iter == _subscriptions_by_message_id.end()) {
     throw ParsingException("Invalid subscription");
   }
+  const size_t num_samples = iter->second->size();
+  const uint64_t memory_usage = _memory_budget ? iter->second->memoryUsage() : 0;
   iter->second->emplaceSample(std::move(data));
+  // Decimated subscriptions might not store the sample
+  const bool stored = iter->second->size() > num_samples;
+  sampleAdded(data.msgId(), data.data().data(), static_cast<int>(data.data().size()),
+              iter->second->size(), stored);
+  if (_memory_budget) {
+    // Includes the growth of the sample offsets and compressed samples
+    _memory_budget->add(static_cast<int64_t>(iter->second->memoryUsage()) -
+                        static_cast<int64_t>(memory_usage));
+    if (_memory_budget->usage() > _next_budget_check) {
+      enforceMemoryBudget();
+    }
+  }
+}
+void DataContainer::dataLocation(const uint8_t* message, uint64_t file_offset)
+{
+  const auto* header = reinterpret_cast<const ulog_message_data_s*>(message);
+  if (header->msg_size < 3) {
+    throw ParsingException("message too short");
+  }
+  const auto& iter = _subscriptions_by_message_id.find(header->msg_id);
+  if (iter == _subscriptions_by_message_id.end()) {
+    throw ParsingException("Invalid subscription");
+  }
+  iter->second->addSampleLocation(file_offset);
+  sampleAdded(header->msg_id, message + sizeof(ulog_message_data_s), header->msg_size - 2,
+              iter->second->size(), true);
+}
+void DataContainer::sampleAdded(uint16_t msg_id, const uint8_t* payload, int payload_size,
+                                size_t num_samples, bool stored)
+{
+  const int offset = _timestamp_offsets[msg_id];
+  if (offset >= 0 && payload_size >= offset + static_cast<int>(sizeof(uint64_t))) {
+    memcpy(&_last_timestamp, payload + offset, sizeof(_last_timestamp));
+  }
+  if (_message_index_enabled && stored) {
+    _message_index.addData(msg_id, static_cast<uint32_t>(num_samples - 1), _last_timestamp);
+  }
 }
 void DataContainer::dropout(const Dropout& dropout)
 {
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "data_handler_interface.hpp"
+#include "message_index.hpp"
 #include "subscription.hpp"
 
 namespace ulog_cpp {
@@ -20,6 +21,11 @@ class DataContainer : public DataHandlerInterface {
   enum class StorageConfig {
     Header,   ///< keep header in memory
     FullLog,  ///< keep full log in memory
+    /**
+     * Like FullLog, but only the file offsets of data samples are stored while parsing. Samples
+     * are decoded from the file on first access of a subscription (@see setLazySource()).
+     */
+    Lazy,
   };
 
   struct NameAndMultiIdKey {
@@ -49,6 +55,80 @@ class DataContainer : public DataHandlerInterface {
   explicit DataContainer(StorageConfig storage_config);
   virtual ~DataContainer() = default;
 
+  /**
+   * Build a time-ordered MessageIndex of data samples, logging messages and parameter changes
+   * while parsing. Must be called before parsing, and requires StorageConfig::FullLog or
+   * StorageConfig::Lazy.
+   * Data samples are indexed by their 'uint64_t timestamp' field. Parameter changes (and samples
+   * without timestamp field) get the latest data timestamp seen before them
+   * (@see changedParameterTimestamps()).
+   */
+  void enableMessageIndex();
+
+  /**
+   * Set the file to decode data samples from, for StorageConfig::Lazy. Must be called before
+   * parsing, and the Reader must be fed with the contents of the same file.
+   */
+  void setLazySource(std::shared_ptr<const MappedFile> file);
+
+  /**
+   * Store the data samples of all subscriptions compressed in memory, with StorageConfig::FullLog
+   * (@see Subscription::compress()). Iterating a subscription decompresses one block at a time,
+   * while rawSamples() or at() decompress all samples, until evicted with evictDecodedSamples().
+   * Subscription::compressedSamples() allows to decompress them block by block as well.
+   * Must be called before parsing.
+   * @param block_size number of samples per compressed block
+   */
+  void enableCompression(int block_size = CompressedSamples::kDefaultBlockSize);
+
+  /**
+   * Set the storage policy for the samples of all subscriptions of a message name, to reduce the
+   * number of samples while parsing (@see DecimationPolicy). Requires StorageConfig::FullLog and
+   * must be called before parsing. Decimated subscriptions are kept uncompressed in memory, and
+   * policies other than KeepAll and EveryNth cannot be combined with the message index.
+   */
+  void setDecimationPolicy(const std::string& message_name, const DecimationPolicy& policy);
+
+  /**
+   * Set the storage policy for all subscriptions without a policy set by setDecimationPolicy()
+   */
+  void setDefaultDecimationPolicy(const DecimationPolicy& policy);
+
+  /**
+   * Free the decoded samples of all lazy, spilled and compressed subscriptions
+   * (@see Subscription::evict())
+   */
+  void evictDecodedSamples();
+
+  /**
+   * Limit the memory used for data samples with StorageConfig::FullLog. When the estimated usage
+   * exceeds the budget while parsing, the samples of the largest subscriptions are moved to a
+   * temporary file in spill_directory (the system temporary directory if empty), and decoded from a
+   * read-only mapping on access (@see Subscription::spill()). Spilled subscriptions keep the file
+   * offset of each sample in memory (8 bytes), which also counts towards the budget.
+   * With compression enabled (@see enableCompression()), the decompressed samples are evicted
+   * instead of spilling.
+   * Decoded samples of spilled and compressed subscriptions count towards the budget as well
+   * (iterating these only decodes one block of samples at a time, rawSamples() or at() all). They
+   * are not evicted automatically, as that would invalidate references still held by callers:
+   * check memoryBudgetExceeded() and call evictDecodedSamples() when done with them.
+   * Must be called before parsing.
+   * @param budget_bytes memory budget, 0 for unlimited
+   */
+  void setMemoryBudget(uint64_t budget_bytes, const std::string& spill_directory = "");
+
+  /**
+   * @return estimated heap memory used by the data samples of all subscriptions in bytes
+   */
+  uint64_t memoryUsage() const;
+
+  /**
+   * @return true if the estimated usage is over the memory budget, because of decoded samples, or
+   * because the samples that cannot be spilled (e.g. the sample offsets of the spilled
+   * subscriptions) exceed it on their own
+   */
+  bool memoryBudgetExceeded() const;
+
   void error(const std::string& msg, bool is_recoverable) override;
 
   void headerComplete() override;
@@ -61,6 +141,8 @@ class DataContainer : public DataHandlerInterface {
   void addLoggedMessage(const AddLoggedMessage& add_logged_message) override;
   void logging(const Logging& logging) override;
   void data(const Data& data) override;
+  bool dataLocationsOnly() const override { return _storage_config == StorageConfig::Lazy; }
+  void dataLocation(const uint8_t* message, uint64_t file_offset) override;
   void dropout(const Dropout& dropout) override;
 
   // Stored data
@@ -83,6 +165,14 @@ class DataContainer : public DataHandlerInterface {
     return _default_parameters;
   }
   const std::vector<Parameter>& changedParameters() const { return _changed_parameters; }
+  /**
+   * @return for each changed parameter, the timestamp of the last data sample before it, as
+   * parameter messages have no timestamp
+   */
+  const std::vector<uint64_t>& changedParameterTimestamps() const
+  {
+    return _changed_parameter_timestamps;
+  }
   const std::vector<Logging>& logging() const { return _logging; }
   const std::vector<Dropout>& dropouts() const { return _dropouts; }
 
@@ -105,6 +195,12 @@ class DataContainer : public DataHandlerInterface {
     return names;
   }
 
+  /**
+   * Get the message index (@see enableMessageIndex()). This merges the entries added since the
+   * last call.
+   */
+  const MessageIndex& messageIndex();
+
   std::shared_ptr<Subscription> subscription(const std::string& name, int multi_id = 0) const
   {
     const auto it = _subscriptions_by_name_and_multi_id.find({name, multi_id});
@@ -127,7 +223,21 @@ class DataContainer : public DataHandlerInterface {
   std::vector<Dropout>& dropoutsRef() { return _dropouts; }
 
  private:
+  void sampleAdded(uint16_t msg_id, const uint8_t* payload, int payload_size, size_t num_samples,
+                   bool stored);
+  void checkDecimationPolicy(const DecimationPolicy& policy) const;
+  void enforceMemoryBudget();
+
   const StorageConfig _storage_config;
+  std::shared_ptr<const MappedFile> _lazy_source;
+
+  std::shared_ptr<MemoryBudget> _memory_budget;  ///< nullptr if unlimited
+  uint64_t _next_budget_check{0};                ///< enforce the budget again above this usage
+  std::string _spill_directory;
+  std::shared_ptr<SpillFile> _spill_file;  ///< created on the first spill
+  int _compression_block_size{0};          ///< 0 if compression is disabled
+  std::map<std::string, DecimationPolicy> _decimation_policies;
+  DecimationPolicy _default_decimation_policy;
 
   bool _header_complete{false};
   bool _had_fatal_error{false};
@@ -137,6 +247,7 @@ class DataContainer : public DataHandlerInterface {
   std::map<std::string, MessageInfo> _message_info;
   std::map<std::string, std::vector<std::vector<MessageInfo>>> _message_info_multi;
   std::map<std::string, std::shared_ptr<MessageFormat>> _message_formats;
+  NameMap<std::shared_ptr<MessageFormat>> _message_format_lookup;  ///< same as _message_formats
   std::map<std::string, Parameter> _initial_parameters;
   std::map<std::string, ParameterDefault> _default_parameters;
   std::vector<Parameter> _changed_parameters;
@@ -144,6 +255,12 @@ class DataContainer : public DataHandlerInterface {
   std::map<NameAndMultiIdKey, std::shared_ptr<Subscription>> _subscriptions_by_name_and_multi_id;
   std::vector<Logging> _logging;
   std::vector<Dropout> _dropouts;
+
+  bool _message_index_enabled{false};
+  MessageIndex _message_index;
+  std::vector<int> _timestamp_offsets;  ///< by message id, -1 if none
+  uint64_t _last_timestamp{0};  ///< of the last data sample with a timestamp
+  std::vector<uint64_t> _changed_parameter_timestamps;
 };
 
 }  // namespace ulog_cpp
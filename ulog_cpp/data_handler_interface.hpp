@@ -25,6 +25,17 @@ class DataHandlerInterface {
   virtual void addLoggedMessage(const AddLoggedMessage& add_logged_message) {}
   virtual void logging(const Logging& logging) {}
   virtual void data(const Data& data) {}
+
+  /**
+   * If this returns true, the Reader calls dataLocation() instead of data() for DATA messages,
+   * without decoding them. It is queried once, when the header is complete.
+   */
+  virtual bool dataLocationsOnly() const { return false; }
+  /**
+   * @param message raw DATA message (including the message header), only valid during the call
+   * @param file_offset offset of the message within the parsed byte stream
+   */
+  virtual void dataLocation(const uint8_t* message, uint64_t file_offset) {}
   virtual void dropout(const Dropout& dropout) {}
   virtual void sync(const Sync& sync) {}
 
@@ -0,0 +1,212 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "decimation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ulog_cpp {
+
+namespace {
+
+template <typename T>
+double read(const uint8_t* data)
+{
+  T value;
+  memcpy(&value, data, sizeof(T));
+  return static_cast<double>(value);
+}
+
+double readNumeric(const uint8_t* data, Field::BasicType type)
+{
+  switch (type) {
+    case Field::BasicType::INT8:
+      return read<int8_t>(data);
+    case Field::BasicType::UINT8:
+      return read<uint8_t>(data);
+    case Field::BasicType::INT16:
+      return read<int16_t>(data);
+    case Field::BasicType::UINT16:
+      return read<uint16_t>(data);
+    case Field::BasicType::INT32:
+      return read<int32_t>(data);
+    case Field::BasicType::UINT32:
+      return read<uint32_t>(data);
+    case Field::BasicType::INT64:
+      return read<int64_t>(data);
+    case Field::BasicType::UINT64:
+      return read<uint64_t>(data);
+    case Field::BasicType::FLOAT:
+      return read<float>(data);
+    case Field::BasicType::DOUBLE:
+      return read<double>(data);
+    case Field::BasicType::CHAR:
+      return read<char>(data);
+    case Field::BasicType::BOOL:
+      return read<bool>(data);
+    case Field::BasicType::NESTED:
+      break;
+  }
+  throw UsageException("Field is not numeric");
+}
+
+const Field& resolvedField(const MessageFormat& format, const std::string& field_name)
+{
+  const auto field = format.findField(field_name);
+  if (!field || !field->definitionResolved()) {
+    throw AccessException("Field " + field_name + " not found in " + format.name());
+  }
+  return *field;
+}
+
+}  // namespace
+
+Decimator::Decimator(DecimationPolicy policy, const MessageFormat& format)
+    : _policy(std::move(policy))
+{
+  switch (_policy.type) {
+    case DecimationPolicy::Type::KeepAll:
+      break;
+    case DecimationPolicy::Type::EveryNth:
+      if (_policy.n == 0) {
+        throw UsageException("Invalid decimation factor");
+      }
+      break;
+    case DecimationPolicy::Type::MinMax: {
+      if (_policy.bucket_us == 0) {
+        throw UsageException("Invalid decimation bucket size");
+      }
+      const Field& field = resolvedField(format, _policy.field);
+      if (field.type().type == Field::BasicType::NESTED) {
+        throw UsageException("Field " + _policy.field + " is not numeric");
+      }
+      if (_policy.array_index < 0 || _policy.array_index >= std::max(field.arrayLength(), 1)) {
+        throw AccessException("Array index out of range: " + std::to_string(_policy.array_index));
+      }
+      _value_offset = field.offsetInMessage() + _policy.array_index * field.type().size;
+      _value_type = field.type().type;
+      _value_size = field.type().size;
+      const Field& timestamp = resolvedField(format, _policy.timestamp_field);
+      if (timestamp.type().type != Field::BasicType::UINT64 || timestamp.arrayLength() != -1) {
+        throw UsageException("Field " + _policy.timestamp_field + " is not of type uint64_t");
+      }
+      _timestamp_offset = timestamp.offsetInMessage();
+      break;
+    }
+    case DecimationPolicy::Type::MaxSamples:
+      if (_policy.max_samples < 2) {
+        throw UsageException("Decimation requires a maximum of at least 2 samples");
+      }
+      break;
+  }
+}
+
+int64_t Decimator::add(const Data& sample, std::vector<Data>& samples)
+{
+  const auto payload_size = static_cast<int64_t>(sample.data().size());
+  switch (_policy.type) {
+    case DecimationPolicy::Type::KeepAll:
+      samples.push_back(sample);
+      return payload_size;
+
+    case DecimationPolicy::Type::EveryNth:
+      if (_num_added++ % _policy.n != 0) {
+        return 0;
+      }
+      samples.push_back(sample);
+      return payload_size;
+
+    case DecimationPolicy::Type::MinMax:
+      return addMinMax(sample, samples);
+
+    case DecimationPolicy::Type::MaxSamples: {
+      if (_num_added++ % _stride != 0) {
+        return 0;
+      }
+      samples.push_back(sample);
+      int64_t delta = payload_size;
+      if (samples.size() > _policy.max_samples) {
+        // Keep the even indices, which are the multiples of the doubled stride
+        for (size_t i = 1; i < samples.size(); i += 2) {
+          delta -= static_cast<int64_t>(samples[i].data().size());
+        }
+        for (size_t i = 1; 2 * i < samples.size(); ++i) {
+          samples[i] = std::move(samples[2 * i]);
+        }
+        samples.erase(samples.begin() + (samples.size() + 1) / 2, samples.end());
+        _stride *= 2;
+      }
+      return delta;
+    }
+  }
+  return 0;
+}
+
+int64_t Decimator::addMinMax(const Data& sample, std::vector<Data>& samples)
+{
+  const auto& data = sample.data();
+  if (data.size() < _timestamp_offset + sizeof(uint64_t) ||
+      data.size() < static_cast<size_t>(_value_offset + _value_size)) {
+    throw ParsingException("Sample too short");
+  }
+  uint64_t timestamp;
+  memcpy(&timestamp, data.data() + _timestamp_offset, sizeof(timestamp));
+  const uint64_t bucket = timestamp / _policy.bucket_us;
+  const double value = readNumeric(data.data() + _value_offset, _value_type);
+  const auto payload_size = static_cast<int64_t>(data.size());
+
+  if (!_in_bucket || bucket != _bucket || samples.size() <= _bucket_start) {
+    _in_bucket = true;
+    _bucket = bucket;
+    _bucket_start = samples.size();
+    _min = _max = value;
+    _min_index = _max_index = 0;
+    samples.push_back(sample);
+    return payload_size;
+  }
+
+  if (std::isnan(value)) {
+    return 0;
+  }
+  if (std::isnan(_min)) {
+    // The bucket started with NaN, which is the only sample so far: replace it
+    const auto delta = payload_size - static_cast<int64_t>(samples[_bucket_start].data().size());
+    samples[_bucket_start] = sample;
+    _min = _max = value;
+    return delta;
+  }
+
+  const bool new_min = value < _min;
+  if (!new_min && !(value > _max)) {
+    return 0;
+  }
+  // Keep the other extreme, followed by the new sample
+  const int other_index = new_min ? _max_index : _min_index;
+  int64_t delta = payload_size;
+  if (samples.size() - _bucket_start == 1) {
+    samples.push_back(sample);
+  } else {
+    // Drop the sample which is not the other extreme
+    delta -= static_cast<int64_t>(samples[_bucket_start + 1 - other_index].data().size());
+    if (other_index == 1) {
+      samples[_bucket_start] = std::move(samples[_bucket_start + 1]);
+    }
+    samples[_bucket_start + 1] = sample;
+  }
+  if (new_min) {
+    _min = value;
+    _min_index = 1;
+    _max_index = 0;
+  } else {
+    _max = value;
+    _max_index = 1;
+    _min_index = 0;
+  }
+  return delta;
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,119 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Storage policy to reduce the number of stored samples of a subscription while parsing, e.g. for
+ * overview plots (@see DataContainer::setDecimationPolicy()).
+ */
+struct DecimationPolicy {
+  enum class Type {
+    KeepAll,
+    EveryNth,  ///< keep every n-th sample, starting with the first
+    /**
+     * Split the time into buckets of bucket_us, and keep the samples with the minimum and the
+     * maximum value of a numeric field per bucket (at most 2, in time order). This preserves the
+     * envelope of the signal, including spikes. NaN values are skipped, a bucket only keeps a NaN
+     * sample if it has no other values.
+     */
+    MinMax,
+    /**
+     * Keep at most max_samples, evenly spaced over the whole log: when the limit is reached, every
+     * second stored sample is dropped, and from then on only every second sample is stored.
+     * Between max_samples / 2 and max_samples samples are kept.
+     */
+    MaxSamples,
+  };
+
+  Type type{Type::KeepAll};
+  uint32_t n{1};          ///< EveryNth
+  uint64_t bucket_us{0};  ///< MinMax
+  std::string field;      ///< MinMax
+  int array_index{0};     ///< MinMax, element index for array fields
+  size_t max_samples{0};  ///< MaxSamples
+  std::string timestamp_field{"timestamp"};
+
+  static DecimationPolicy everyNth(uint32_t n)
+  {
+    DecimationPolicy policy;
+    policy.type = Type::EveryNth;
+    policy.n = n;
+    return policy;
+  }
+
+  static DecimationPolicy minMax(uint64_t bucket_us, std::string field, int array_index = 0)
+  {
+    DecimationPolicy policy;
+    policy.type = Type::MinMax;
+    policy.bucket_us = bucket_us;
+    policy.field = std::move(field);
+    policy.array_index = array_index;
+    return policy;
+  }
+
+  static DecimationPolicy maxSamples(size_t max_samples)
+  {
+    DecimationPolicy policy;
+    policy.type = Type::MaxSamples;
+    policy.max_samples = max_samples;
+    return policy;
+  }
+
+  /**
+   * @return true if the policy only appends samples, i.e. stored samples are never replaced or
+   * removed
+   */
+  bool appendOnly() const { return type == Type::KeepAll || type == Type::EveryNth; }
+};
+
+/**
+ * Applies a DecimationPolicy to the samples of a subscription as they are added
+ */
+class Decimator {
+ public:
+  /**
+   * @param format resolved message format of the samples
+   */
+  Decimator(DecimationPolicy policy, const MessageFormat& format);
+
+  /**
+   * Add a sample to samples, if the policy keeps it. This may replace or remove previously added
+   * samples.
+   * @return change of the summed payload size of samples in bytes
+   */
+  int64_t add(const Data& sample, std::vector<Data>& samples);
+
+  const DecimationPolicy& policy() const { return _policy; }
+
+ private:
+  int64_t addMinMax(const Data& sample, std::vector<Data>& samples);
+
+  const DecimationPolicy _policy;
+  uint64_t _num_added{0};
+  uint64_t _stride{1};  ///< MaxSamples
+
+  // MinMax
+  int _value_offset{0};
+  Field::BasicType _value_type{Field::BasicType::FLOAT};
+  int _value_size{0};
+  int _timestamp_offset{0};
+  bool _in_bucket{false};
+  uint64_t _bucket{0};
+  size_t _bucket_start{0};  ///< index of the first sample of the current bucket
+  double _min{0};
+  double _max{0};
+  int _min_index{0};  ///< relative to _bucket_start
+  int _max_index{0};
+};
+
+}  // namespace ulog_cpp
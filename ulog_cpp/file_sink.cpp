@@ -0,0 +1,375 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "file_sink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "exception.hpp"
+
+#ifdef _WIN32
+// clang-format off
+#include <windows.h>
+#include <fileapi.h>
+// clang-format on
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ulog_cpp {
+
+StdioFileSink::StdioFileSink(const std::string& filename) : _filename(filename)
+{
+  _file = std::fopen(filename.c_str(), "wb");
+  if (!_file) {
+    throw ParsingException("Failed to open file");
+  }
+}
+
+StdioFileSink::~StdioFileSink()
+{
+  if (_file) {
+    std::fclose(_file);
+  }
+}
+
+void StdioFileSink::write(const uint8_t* data, int length)
+{
+  if (std::fwrite(data, 1, length, _file) != static_cast<size_t>(length)) {
+    throw ParsingException("Failed to write to file");
+  }
+}
+
+void StdioFileSink::sync()
+{
+  if (!_file) {
+    return;
+  }
+  fflush(_file);
+#ifdef _WIN32
+  FlushFileBuffers(reinterpret_cast<HANDLE>(static_cast<uintptr_t>(_fileno(_file))));
+#else
+  ::fsync(fileno(_file));
+#endif
+}
+
+void StdioFileSink::close()
+{
+  if (_file) {
+    const int ret = std::fclose(_file);
+    _file = nullptr;
+    if (ret != 0) {
+      throw ParsingException("Failed to close file");
+    }
+  }
+}
+
+void StdioFileSink::discard()
+{
+  close();
+  std::remove(_filename.c_str());
+}
+
+#ifndef _WIN32
+
+namespace {
+std::string errnoString()
+{
+  return std::string(" (") + strerror(errno) + ")";
+}
+}  // namespace
+
+void PreallocatedFileSink::FreeDeleter::operator()(uint8_t* ptr) const
+{
+  std::free(ptr);
+}
+
+PreallocatedFileSink::PreallocatedFileSink(const std::string& filename,
+                                           const PreallocatedFileSinkOptions& options)
+    : _filename(filename), _options(options), _last_sync(std::chrono::steady_clock::now())
+{
+  if (_options.block_size <= 0 || _options.block_size % kAlignment != 0) {
+    throw UsageException("Block size must be a multiple of " + std::to_string(kAlignment));
+  }
+  void* buffer = nullptr;
+  if (posix_memalign(&buffer, kAlignment, _options.block_size) != 0) {
+    throw std::bad_alloc();
+  }
+  _buffer.reset(static_cast<uint8_t*>(buffer));
+
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+  if (_options.direct_io) {
+    _fd = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+    // Not all file systems support it (e.g. tmpfs)
+    _direct_io = _fd >= 0;
+  }
+#endif
+  if (_fd < 0) {
+    _fd = ::open(filename.c_str(), flags, 0644);
+  }
+  if (_fd < 0) {
+    throw ParsingException("Failed to open file" + errnoString());
+  }
+  preallocate(_options.preallocation_step);
+}
+
+PreallocatedFileSink::~PreallocatedFileSink()
+{
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+void PreallocatedFileSink::write(const uint8_t* data, int length)
+{
+  while (length > 0) {
+    const int num_copy = std::min(length, _options.block_size - _buffer_fill);
+    memcpy(_buffer.get() + _buffer_fill, data, num_copy);
+    _buffer_fill += num_copy;
+    data += num_copy;
+    length -= num_copy;
+    if (_buffer_fill == _options.block_size) {
+      writeBlock(_options.block_size);
+      _file_offset += _options.block_size;
+      _buffer_fill = 0;
+      _bytes_since_sync += _options.block_size;
+      syncIfDue();
+    }
+  }
+}
+
+void PreallocatedFileSink::writeBlock(int length)
+{
+  if (_file_offset + length > _allocated_size) {
+    preallocate(_file_offset + length + _options.preallocation_step);
+  }
+  int written = 0;
+  while (written < length) {
+    const ssize_t ret = ::pwrite(_fd, _buffer.get() + written, length - written,
+                                 static_cast<off_t>(_file_offset + written));
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw ParsingException("Failed to write to file" + errnoString());
+    }
+    written += static_cast<int>(ret);
+  }
+}
+
+void PreallocatedFileSink::preallocate(uint64_t end)
+{
+  // Round to a multiple of the preallocation step
+  const uint64_t step = std::max<uint64_t>(_options.preallocation_step, kAlignment);
+  end = (end + step - 1) / step * step;
+  if (end <= _allocated_size) {
+    return;
+  }
+#ifdef __linux__
+  if (::fallocate(_fd, 0, static_cast<off_t>(_allocated_size),
+                  static_cast<off_t>(end - _allocated_size)) == 0) {
+    _allocated_size = end;
+    return;
+  }
+#endif
+  // Fallback: at least avoid extending the file size with every write
+  if (::ftruncate(_fd, static_cast<off_t>(end)) != 0) {
+    throw ParsingException("Failed to extend file" + errnoString());
+  }
+  _allocated_size = end;
+}
+
+void PreallocatedFileSink::syncIfDue()
+{
+  bool due = _options.sync_interval_bytes > 0 && _bytes_since_sync >= _options.sync_interval_bytes;
+  if (!due && _options.sync_interval.count() > 0) {
+    due = std::chrono::steady_clock::now() - _last_sync >= _options.sync_interval;
+  }
+  if (due) {
+    dataSync();
+  }
+}
+
+void PreallocatedFileSink::dataSync()
+{
+#ifdef __linux__
+  const int ret = ::fdatasync(_fd);
+#else
+  const int ret = ::fsync(_fd);
+#endif
+  if (ret != 0) {
+    throw ParsingException("Failed to sync file" + errnoString());
+  }
+  _bytes_since_sync = 0;
+  _last_sync = std::chrono::steady_clock::now();
+}
+
+void PreallocatedFileSink::sync()
+{
+  if (_fd < 0) {
+    return;
+  }
+  if (_buffer_fill > 0) {
+    // Write the partial block, padded to the alignment. It is overwritten with the next block.
+    const int length = (_buffer_fill + kAlignment - 1) / kAlignment * kAlignment;
+    memset(_buffer.get() + _buffer_fill, 0, length - _buffer_fill);
+    writeBlock(length);
+  }
+  dataSync();
+}
+
+void PreallocatedFileSink::close()
+{
+  if (_fd < 0) {
+    return;
+  }
+  const int fd = _fd;
+  try {
+    sync();
+    if (::ftruncate(_fd, static_cast<off_t>(size())) != 0) {
+      throw ParsingException("Failed to truncate file" + errnoString());
+    }
+  } catch (...) {
+    ::close(fd);
+    _fd = -1;
+    throw;
+  }
+  _fd = -1;
+  if (::close(fd) != 0) {
+    throw ParsingException("Failed to close file" + errnoString());
+  }
+}
+
+void PreallocatedFileSink::discard()
+{
+  close();
+  ::unlink(_filename.c_str());
+}
+
+MmapFileSink::MmapFileSink(const std::string& filename, uint64_t growth_step)
+    : _filename(filename),
+      _growth_step(std::max<uint64_t>(growth_step, PreallocatedFileSink::kAlignment))
+{
+  _fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (_fd < 0) {
+    throw ParsingException("Failed to open file" + errnoString());
+  }
+  try {
+    grow(_growth_step);
+  } catch (...) {
+    ::close(_fd);
+    _fd = -1;
+    throw;
+  }
+}
+
+MmapFileSink::~MmapFileSink()
+{
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+void MmapFileSink::grow(uint64_t min_size)
+{
+  const uint64_t new_size = (min_size + _growth_step - 1) / _growth_step * _growth_step;
+#ifdef __linux__
+  // Reserve the blocks, so a full disk is reported here, and not by a SIGBUS on the first store
+  // into a sparse part of the mapping
+  const int ret = ::posix_fallocate(_fd, static_cast<off_t>(_mapped_size),
+                                    static_cast<off_t>(new_size - _mapped_size));
+  if (ret != 0) {
+    errno = ret;
+    throw ParsingException("Failed to extend file" + errnoString());
+  }
+#else
+  if (::ftruncate(_fd, static_cast<off_t>(new_size)) != 0) {
+    throw ParsingException("Failed to extend file" + errnoString());
+  }
+#endif
+  void* mapping = MAP_FAILED;
+#ifdef __linux__
+  if (_mapping) {
+    mapping = ::mremap(_mapping, _mapped_size, new_size, MREMAP_MAYMOVE);
+  }
+#endif
+  if (mapping == MAP_FAILED) {
+    unmap();
+    mapping = ::mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (mapping == MAP_FAILED) {
+      throw ParsingException("Failed to map file" + errnoString());
+    }
+  }
+  _mapping = static_cast<uint8_t*>(mapping);
+  _mapped_size = new_size;
+}
+
+void MmapFileSink::unmap()
+{
+  if (_mapping) {
+    ::munmap(_mapping, _mapped_size);
+    _mapping = nullptr;
+    _mapped_size = 0;
+  }
+}
+
+void MmapFileSink::write(const uint8_t* data, int length)
+{
+  if (_fd < 0) {
+    throw ParsingException("File is closed");
+  }
+  if (_size + length > _mapped_size) {
+    grow(_size + length);
+  }
+  memcpy(_mapping + _size, data, length);
+  _size += length;
+}
+
+void MmapFileSink::sync()
+{
+  if (!_mapping || _size == 0) {
+    return;
+  }
+  if (::msync(_mapping, _size, MS_SYNC) != 0) {
+    throw ParsingException("Failed to sync file" + errnoString());
+  }
+}
+
+void MmapFileSink::close()
+{
+  if (_fd < 0) {
+    return;
+  }
+  const int fd = _fd;
+  _fd = -1;
+  // munmap() writes back dirty pages asynchronously, so no msync() is needed for correctness
+  unmap();
+  if (::ftruncate(fd, static_cast<off_t>(_size)) != 0) {
+    ::close(fd);
+    throw ParsingException("Failed to truncate file" + errnoString());
+  }
+  if (::close(fd) != 0) {
+    throw ParsingException("Failed to close file" + errnoString());
+  }
+}
+
+void MmapFileSink::discard()
+{
+  close();
+  ::unlink(_filename.c_str());
+}
+
+#endif  // _WIN32
+
+}  // namespace ulog_cpp
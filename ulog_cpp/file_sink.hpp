@@ -0,0 +1,158 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace ulog_cpp {
+
+/**
+ * Output file for serialized ULog data. Errors are reported with a ParsingException().
+ */
+class FileSink {
+ public:
+  virtual ~FileSink() = default;
+
+  virtual void write(const uint8_t* data, int length) = 0;
+
+  /**
+   * Write all buffered data and make sure it is stored on the device (fsync)
+   */
+  virtual void sync() = 0;
+
+  /**
+   * Write all buffered data and close the file. Called on destruction if not called before.
+   */
+  virtual void close() = 0;
+
+  /**
+   * Close and delete the file, e.g. a file that was opened ahead of time and is not used. The
+   * default implementation only closes it.
+   */
+  virtual void discard() { close(); }
+};
+
+/**
+ * File sink using the C stdio API (fopen/fwrite)
+ */
+class StdioFileSink : public FileSink {
+ public:
+  explicit StdioFileSink(const std::string& filename);
+  ~StdioFileSink() override;
+
+  void write(const uint8_t* data, int length) override;
+  void sync() override;
+  void close() override;
+  void discard() override;
+
+ private:
+  const std::string _filename;
+  std::FILE* _file{nullptr};
+};
+
+#ifndef _WIN32
+
+struct PreallocatedFileSinkOptions {
+  uint64_t preallocation_step{64 * 1024 * 1024};  ///< extend the file in steps of this size
+  int block_size{256 * 1024};                     ///< write size, multiple of kAlignment
+  bool direct_io{false};                          ///< open with O_DIRECT if supported
+
+  uint64_t sync_interval_bytes{0};             ///< fdatasync() every N bytes, 0 to disable
+  std::chrono::milliseconds sync_interval{0};  ///< fdatasync() at this interval, 0 to disable
+};
+
+/**
+ * File sink for constant write latency: the file is preallocated in large steps (fallocate() on
+ * Linux), so writes do not trigger file system metadata updates for extending the file. Data is
+ * written in aligned blocks of a fixed size, optionally with direct I/O. On close, the file is
+ * truncated to the size of the written data.
+ *
+ * The periodic sync policy is checked whenever a block is written.
+ */
+class PreallocatedFileSink : public FileSink {
+ public:
+  static constexpr int kAlignment = 4096;
+
+  explicit PreallocatedFileSink(const std::string& filename,
+                                const PreallocatedFileSinkOptions& options = {});
+  ~PreallocatedFileSink() override;
+
+  void write(const uint8_t* data, int length) override;
+  void sync() override;
+  void close() override;
+  void discard() override;
+
+  /**
+   * @return true if the file was opened with O_DIRECT. If not supported by the file system, the
+   * sink falls back to buffered I/O.
+   */
+  bool directIo() const { return _direct_io; }
+
+  uint64_t size() const { return _file_offset + _buffer_fill; }
+
+ private:
+  struct FreeDeleter {
+    void operator()(uint8_t* ptr) const;
+  };
+
+  void writeBlock(int length);
+  void preallocate(uint64_t end);
+  void syncIfDue();
+  void dataSync();
+
+  const std::string _filename;
+  const PreallocatedFileSinkOptions _options;
+  int _fd{-1};
+  bool _direct_io{false};
+
+  std::unique_ptr<uint8_t, FreeDeleter> _buffer;  ///< aligned block buffer
+  int _buffer_fill{0};
+  uint64_t _file_offset{0};  ///< file offset of the buffer start (always block-aligned)
+  uint64_t _allocated_size{0};
+
+  uint64_t _bytes_since_sync{0};
+  std::chrono::steady_clock::time_point _last_sync;
+};
+
+/**
+ * File sink writing through a shared memory mapping of the file, for bulk conversions: data is
+ * copied directly into the mapped pages, without a user-space buffer or a system call per write.
+ * The file (and the mapping) grows in steps of growth_step, and is truncated to the size of the
+ * written data on close. sync() calls msync(). On Linux, the blocks of each step are reserved with
+ * posix_fallocate(), so running out of disk space throws instead of raising SIGBUS.
+ */
+class MmapFileSink : public FileSink {
+ public:
+  static constexpr uint64_t kDefaultGrowthStep = 64 * 1024 * 1024;
+
+  explicit MmapFileSink(const std::string& filename, uint64_t growth_step = kDefaultGrowthStep);
+  ~MmapFileSink() override;
+
+  void write(const uint8_t* data, int length) override;
+  void sync() override;
+  void close() override;
+  void discard() override;
+
+  uint64_t size() const { return _size; }
+
+ private:
+  void grow(uint64_t min_size);
+  void unmap();
+
+  const std::string _filename;
+  const uint64_t _growth_step;
+  int _fd{-1};
+  uint8_t* _mapping{nullptr};
+  uint64_t _mapped_size{0};
+  uint64_t _size{0};
+};
+
+#endif  // _WIN32
+
+}  // namespace ulog_cpp
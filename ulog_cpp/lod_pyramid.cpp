@@ -0,0 +1,420 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "lod_pyramid.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <thread>
+
+#include "file_sink.hpp"
+#include "mapped_file.hpp"
+#include "resample.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+// Below this number of values, building on multiple threads is not worth it
+constexpr size_t kParallelBuildThreshold = 256 * 1024;
+
+constexpr char kFileMagic[8] = {'U', 'L', 'o', 'g', 'L', 'O', 'D', '\0'};
+constexpr uint32_t kFileVersion = 1;
+
+class FileWriter {
+ public:
+  explicit FileWriter(const std::string& filename) : _sink(filename) {}
+
+  template <typename T>
+  void write(const T& value)
+  {
+    _sink.write(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  void writeArray(const std::vector<T>& values)
+  {
+    const auto* data = reinterpret_cast<const uint8_t*>(values.data());
+    size_t remaining = values.size() * sizeof(T);
+    while (remaining > 0) {
+      const int length = static_cast<int>(std::min<size_t>(remaining, 1 << 30));
+      _sink.write(data, length);
+      data += length;
+      remaining -= length;
+    }
+  }
+
+  void writeString(const std::string& value)
+  {
+    write(static_cast<uint16_t>(value.size()));
+    _sink.write(reinterpret_cast<const uint8_t*>(value.data()), static_cast<int>(value.size()));
+  }
+
+ private:
+  StdioFileSink _sink;
+};
+
+class FileReader {
+ public:
+  explicit FileReader(const std::string& filename) : _file(filename) {}
+
+  template <typename T>
+  T read()
+  {
+    T value;
+    memcpy(&value, advance(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  void readArray(std::vector<T>& values, size_t size)
+  {
+    if (size > (_file.size() - _position) / sizeof(T)) {
+      throw ParsingException("LOD file too short");
+    }
+    values.resize(size);
+    memcpy(values.data(), advance(size * sizeof(T)), size * sizeof(T));
+  }
+
+  std::string readString()
+  {
+    const auto length = read<uint16_t>();
+    const auto* data = reinterpret_cast<const char*>(advance(length));
+    return {data, length};
+  }
+
+ private:
+  const uint8_t* advance(size_t length)
+  {
+    if (length > _file.size() - _position) {
+      throw ParsingException("LOD file too short");
+    }
+    const uint8_t* data = _file.data() + _position;
+    _position += length;
+    return data;
+  }
+
+  MappedFile _file;
+  size_t _position{0};
+};
+
+}  // namespace
+
+LodPyramid::LodPyramid(const Subscription& subscription, const LodOptions& options)
+    : _factor(options.factor)
+{
+  if (_factor < 2) {
+    throw UsageException("Invalid LOD factor: " + std::to_string(_factor));
+  }
+  const MessageFormat& format = *subscription.format();
+  _format_hash = format.contentHash();
+
+  const auto timestamp_field = format.findField(options.timestamp_field);
+  if (!timestamp_field || !timestamp_field->definitionResolved() ||
+      timestamp_field->type().type != Field::BasicType::UINT64 ||
+      timestamp_field->arrayLength() != -1) {
+    throw UsageException("Field " + options.timestamp_field + " in " + format.name() +
+                         " is not of type uint64_t");
+  }
+
+  // Numeric elements of the flattened layout
+  std::vector<ColumnElement> elements;
+  for (const auto& leaf : format.layout()) {
+    if (leaf.type == Field::BasicType::CHAR || leaf.path.rfind("_padding", 0) == 0 ||
+        leaf.path == options.timestamp_field) {
+      continue;
+    }
+    for (int i = 0; i < leaf.count; ++i) {
+      _field_names.push_back(leaf.count > 1 ? leaf.path + "[" + std::to_string(i) + "]"
+                                            : leaf.path);
+      elements.push_back({leaf.offset + i * leaf.size, leaf.type});
+    }
+  }
+  if (!options.fields.empty()) {
+    indexFieldNames();
+    std::vector<ColumnElement> selected_elements;
+    for (const auto& name : options.fields) {
+      const int index = fieldIndex(name);
+      if (index == kInvalidField) {
+        throw AccessException("Field " + name + " not found in " + format.name());
+      }
+      selected_elements.push_back(elements[index]);
+    }
+    _field_names = options.fields;
+    elements = std::move(selected_elements);
+  }
+  indexFieldNames();
+
+  // Extract all values in a single (block-wise) pass over the samples
+  const size_t num_samples = subscription.size();
+  buildLevels(num_samples);
+  Level& base = _levels.front();
+  base.start_timestamps = timestampColumn(subscription, options.timestamp_field);
+  base.mean = columns(subscription, elements);
+  for (size_t level = 1; level < _levels.size(); ++level) {
+    const Level& source = _levels[level - 1];
+    Level& target = _levels[level];
+    const auto& source_end = level == 1 ? source.start_timestamps : source.end_timestamps;
+    for (size_t i = 0; i < target.start_timestamps.size(); ++i) {
+      const size_t first = i * _factor;
+      const size_t last = std::min(first + _factor, source.start_timestamps.size()) - 1;
+      target.start_timestamps[i] = source.start_timestamps[first];
+      target.end_timestamps[i] = source_end[last];
+    }
+  }
+
+  // The fields are independent, distribute them over threads
+  const size_t num_fields = elements.size();
+  const size_t num_threads =
+      num_samples * num_fields < kParallelBuildThreshold
+          ? 1
+          : std::min<size_t>(num_fields, std::max(1U, std::thread::hardware_concurrency()));
+  std::vector<std::future<void>> futures;
+  for (size_t thread = 1; thread < num_threads; ++thread) {
+    futures.push_back(std::async(std::launch::async, [&, thread]() {
+      for (size_t field = thread; field < num_fields; field += num_threads) {
+        aggregateField(static_cast<int>(field));
+      }
+    }));
+  }
+  for (size_t field = 0; field < num_fields; field += num_threads) {
+    aggregateField(static_cast<int>(field));
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+}
+
+void LodPyramid::buildLevels(size_t num_samples)
+{
+  const size_t num_fields = _field_names.size();
+  size_t size = num_samples;
+  do {
+    Level& level = _levels.emplace_back();
+    level.start_timestamps.resize(size);
+    level.mean.resize(num_fields);
+    if (_levels.size() > 1) {
+      level.end_timestamps.resize(size);
+      level.min.resize(num_fields);
+      level.max.resize(num_fields);
+    }
+    size = (size + _factor - 1) / _factor;
+  } while (_levels.back().start_timestamps.size() > 1);
+}
+
+void LodPyramid::aggregateField(int field_index)
+{
+  const std::vector<double>& values = _levels.front().mean[field_index];
+
+  // Sums and counts of the non-NaN values of the previous level, for exact means
+  std::vector<double> sums;
+  std::vector<uint64_t> counts;
+  for (size_t level_index = 1; level_index < _levels.size(); ++level_index) {
+    const Level& source = _levels[level_index - 1];
+    Level& target = _levels[level_index];
+    const size_t size = target.start_timestamps.size();
+    const size_t source_size = source.start_timestamps.size();
+    auto& min = target.min[field_index];
+    auto& max = target.max[field_index];
+    auto& mean = target.mean[field_index];
+    min.resize(size);
+    max.resize(size);
+    mean.resize(size);
+    std::vector<double> next_sums(size);
+    std::vector<uint64_t> next_counts(size);
+    const bool from_values = level_index == 1;
+    const auto& source_min = from_values ? values : source.min[field_index];
+    const auto& source_max = from_values ? values : source.max[field_index];
+    for (size_t i = 0; i < size; ++i) {
+      const size_t first = i * _factor;
+      const size_t last = std::min(first + _factor, source_size);
+      double bucket_min = NAN;
+      double bucket_max = NAN;
+      double sum = 0;
+      uint64_t count = 0;
+      for (size_t j = first; j < last; ++j) {
+        bucket_min = std::fmin(bucket_min, source_min[j]);
+        bucket_max = std::fmax(bucket_max, source_max[j]);
+        if (from_values) {
+          if (!std::isnan(values[j])) {
+            sum += values[j];
+            ++count;
+          }
+        } else {
+          sum += sums[j];
+          count += counts[j];
+        }
+      }
+      min[i] = bucket_min;
+      max[i] = bucket_max;
+      mean[i] = count > 0 ? sum / static_cast<double>(count) : NAN;
+      next_sums[i] = sum;
+      next_counts[i] = count;
+    }
+    sums = std::move(next_sums);
+    counts = std::move(next_counts);
+  }
+}
+
+void LodPyramid::indexFieldNames()
+{
+  _field_indices.clear();
+  for (size_t i = 0; i < _field_names.size(); ++i) {
+    _field_indices.emplace(_field_names[i], static_cast<int>(i));
+  }
+}
+
+int LodPyramid::fieldIndex(const std::string& field_name) const
+{
+  const auto iter = _field_indices.find(field_name);
+  return iter == _field_indices.end() ? kInvalidField : iter->second;
+}
+
+void LodPyramid::checkField(int field_index) const
+{
+  if (field_index < 0 || field_index >= static_cast<int>(_field_names.size())) {
+    throw AccessException("Invalid field index: " + std::to_string(field_index));
+  }
+}
+
+std::vector<LodPoint> LodPyramid::level(int field_index, int level, uint64_t start,
+                                        uint64_t end) const
+{
+  checkField(field_index);
+  if (level < 0 || level >= numLevels()) {
+    throw AccessException("Invalid level: " + std::to_string(level));
+  }
+  const Level& data = _levels[level];
+  const auto& end_timestamps = level == 0 ? data.start_timestamps : data.end_timestamps;
+  // First point ending at or after start, up to the last point starting at or before end
+  const size_t first = std::lower_bound(end_timestamps.begin(), end_timestamps.end(), start) -
+                       end_timestamps.begin();
+  const size_t last = std::upper_bound(data.start_timestamps.begin() + first,
+                                       data.start_timestamps.end(), std::max(start, end)) -
+                      data.start_timestamps.begin();
+  std::vector<LodPoint> points;
+  points.reserve(last - first);
+  const auto& mean = data.mean[field_index];
+  for (size_t i = first; i < last; ++i) {
+    if (level == 0) {
+      points.push_back({data.start_timestamps[i], data.start_timestamps[i], mean[i], mean[i],
+                        mean[i]});
+    } else {
+      points.push_back({data.start_timestamps[i], data.end_timestamps[i],
+                        data.min[field_index][i], data.max[field_index][i], mean[i]});
+    }
+  }
+  return points;
+}
+
+std::vector<LodPoint> LodPyramid::query(int field_index, uint64_t start, uint64_t end,
+                                        size_t max_points) const
+{
+  checkField(field_index);
+  if (max_points == 0) {
+    throw UsageException("max_points must be > 0");
+  }
+  end = std::max(start, end);
+  for (int level_index = 0; level_index < numLevels(); ++level_index) {
+    const Level& data = _levels[level_index];
+    const auto& end_timestamps = level_index == 0 ? data.start_timestamps : data.end_timestamps;
+    const auto first =
+        std::lower_bound(end_timestamps.begin(), end_timestamps.end(), start) -
+        end_timestamps.begin();
+    const auto last =
+        std::upper_bound(data.start_timestamps.begin() + first, data.start_timestamps.end(), end) -
+        data.start_timestamps.begin();
+    if (static_cast<size_t>(last - first) <= max_points || level_index == numLevels() - 1) {
+      return level(field_index, level_index, start, end);
+    }
+  }
+  return {};
+}
+
+std::vector<LodPoint> LodPyramid::query(const std::string& field_name, uint64_t start,
+                                        uint64_t end, size_t max_points) const
+{
+  const int index = fieldIndex(field_name);
+  if (index == kInvalidField) {
+    throw AccessException("Field not found: " + field_name);
+  }
+  return query(index, start, end, max_points);
+}
+
+void LodPyramid::save(const std::string& filename) const
+{
+  FileWriter writer(filename);
+  writer.write(kFileMagic);
+  writer.write(kFileVersion);
+  writer.write(static_cast<uint32_t>(_factor));
+  writer.write(_format_hash);
+  writer.write(static_cast<uint64_t>(_levels.front().start_timestamps.size()));
+  writer.write(static_cast<uint32_t>(_field_names.size()));
+  writer.write(static_cast<uint32_t>(_levels.size()));
+  for (const auto& name : _field_names) {
+    writer.writeString(name);
+  }
+  for (size_t level_index = 0; level_index < _levels.size(); ++level_index) {
+    const Level& level = _levels[level_index];
+    writer.write(static_cast<uint64_t>(level.start_timestamps.size()));
+    writer.writeArray(level.start_timestamps);
+    writer.writeArray(level.end_timestamps);
+    for (size_t field = 0; field < _field_names.size(); ++field) {
+      if (level_index > 0) {
+        writer.writeArray(level.min[field]);
+        writer.writeArray(level.max[field]);
+      }
+      writer.writeArray(level.mean[field]);
+    }
+  }
+}
+
+LodPyramid::LodPyramid(const std::string& filename, const Subscription& subscription)
+{
+  FileReader reader(filename);
+  const auto magic = reader.read<std::array<char, sizeof(kFileMagic)>>();
+  if (memcmp(magic.data(), kFileMagic, sizeof(kFileMagic)) != 0 ||
+      reader.read<uint32_t>() != kFileVersion) {
+    throw ParsingException("Invalid LOD file: " + filename);
+  }
+  _factor = static_cast<int>(reader.read<uint32_t>());
+  _format_hash = reader.read<uint64_t>();
+  const auto num_samples = reader.read<uint64_t>();
+  if (_factor < 2 || _format_hash != subscription.format()->contentHash() ||
+      num_samples != subscription.size()) {
+    throw ParsingException("LOD file does not match the subscription: " + filename);
+  }
+  const auto num_fields = reader.read<uint32_t>();
+  const auto num_levels = reader.read<uint32_t>();
+  for (uint32_t i = 0; i < num_fields; ++i) {
+    _field_names.push_back(reader.readString());
+  }
+  indexFieldNames();
+  buildLevels(num_samples);
+  if (num_levels != _levels.size()) {
+    throw ParsingException("Invalid LOD file: " + filename);
+  }
+  for (size_t level_index = 0; level_index < _levels.size(); ++level_index) {
+    Level& level = _levels[level_index];
+    const size_t size = level.start_timestamps.size();
+    if (reader.read<uint64_t>() != size) {
+      throw ParsingException("Invalid LOD file: " + filename);
+    }
+    reader.readArray(level.start_timestamps, size);
+    reader.readArray(level.end_timestamps, level_index > 0 ? size : 0);
+    for (size_t field = 0; field < num_fields; ++field) {
+      if (level_index > 0) {
+        reader.readArray(level.min[field], size);
+        reader.readArray(level.max[field], size);
+      }
+      reader.readArray(level.mean[field], size);
+    }
+  }
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,125 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "subscription.hpp"
+
+namespace ulog_cpp {
+
+struct LodOptions {
+  int factor{4};  ///< number of buckets aggregated into one bucket of the next level, >= 2
+  /**
+   * Fields to aggregate, as paths of MessageFormat::layout() with an element index for arrays
+   * (e.g. "q[0]", "esc[1].esc_rpm"). Empty for all numeric fields, except the timestamp.
+   */
+  std::vector<std::string> fields;
+  std::string timestamp_field{"timestamp"};
+};
+
+/**
+ * Aggregated value of a range of samples
+ */
+struct LodPoint {
+  uint64_t start_timestamp;  ///< timestamp of the first sample
+  uint64_t end_timestamp;    ///< timestamp of the last sample
+  double min;
+  double max;
+  double mean;  ///< NaN values are ignored for min, max and mean
+};
+
+/**
+ * Multi-resolution (level of detail) cache of numeric fields of a subscription, for plotting at
+ * any zoom level without rescanning the samples.
+ *
+ * Level 0 contains the values of each sample, level l aggregates factor^l consecutive samples into
+ * min, max and mean. The levels are built once, in parallel over the fields. A range query picks
+ * the finest level with at most the requested number of points, and finds the range with a binary
+ * search, so it runs in O(log n + points). The samples must be ordered by timestamp.
+ *
+ * The pyramid can be saved to a file (e.g. next to the log), and loaded again for the same
+ * subscription.
+ */
+class LodPyramid {
+ public:
+  static constexpr int kInvalidField = -1;
+
+  explicit LodPyramid(const Subscription& subscription, const LodOptions& options = {});
+
+  /**
+   * Load a pyramid saved with save(). Throws a ParsingException if the file is invalid or does not
+   * match the subscription (message format or number of samples).
+   */
+  LodPyramid(const std::string& filename, const Subscription& subscription);
+
+  void save(const std::string& filename) const;
+
+  /**
+   * @return index of a field, or kInvalidField if it is not part of the pyramid
+   */
+  int fieldIndex(const std::string& field_name) const;
+
+  const std::vector<std::string>& fieldNames() const { return _field_names; }
+
+  int factor() const { return _factor; }
+
+  /**
+   * @return number of levels, including level 0 (the samples)
+   */
+  int numLevels() const { return static_cast<int>(_levels.size()); }
+
+  /**
+   * @return number of points of a level
+   */
+  size_t levelSize(int level) const { return _levels.at(level).start_timestamps.size(); }
+
+  /**
+   * Get the points of a level overlapping the time range [start, end]
+   */
+  std::vector<LodPoint> level(int field_index, int level, uint64_t start = 0,
+                              uint64_t end = std::numeric_limits<uint64_t>::max()) const;
+
+  /**
+   * Get at most max_points points covering the time range [start, end] (inclusive), from the
+   * finest level that has at most max_points in that range
+   */
+  std::vector<LodPoint> query(int field_index, uint64_t start, uint64_t end,
+                              size_t max_points) const;
+  std::vector<LodPoint> query(const std::string& field_name, uint64_t start, uint64_t end,
+                              size_t max_points) const;
+
+ private:
+  struct Level {
+    std::vector<uint64_t> start_timestamps;
+    std::vector<uint64_t> end_timestamps;  ///< empty for level 0 (equal to start_timestamps)
+    /**
+     * Per field. Level 0 only stores the values in mean.
+     */
+    std::vector<std::vector<double>> min;
+    std::vector<std::vector<double>> max;
+    std::vector<std::vector<double>> mean;
+  };
+
+  void checkField(int field_index) const;
+  void buildLevels(size_t num_samples);
+  /**
+   * Aggregate the levels > 0 of a field from its values in level 0
+   */
+  void aggregateField(int field_index);
+  void indexFieldNames();
+
+  int _factor;
+  uint64_t _format_hash{0};
+  std::vector<std::string> _field_names;
+  std::unordered_map<std::string, int> _field_indices;
+  std::vector<Level> _levels;
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,82 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "mapped_file.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "exception.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ulog_cpp {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename)
+{
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    throw ParsingException("Failed to open file");
+  }
+  std::fseek(file, 0, SEEK_END);
+  _contents.resize(static_cast<size_t>(_ftelli64(file)));
+  std::fseek(file, 0, SEEK_SET);
+  const size_t num_read = std::fread(_contents.data(), 1, _contents.size(), file);
+  std::fclose(file);
+  if (num_read != _contents.size()) {
+    throw ParsingException("Failed to read file");
+  }
+  _data = _contents.data();
+  _size = _contents.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#else
+
+MappedFile::MappedFile(const std::string& filename)
+{
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw ParsingException("Failed to open file (" + std::string(strerror(errno)) + ")");
+  }
+  struct stat file_stat {};
+  if (::fstat(fd, &file_stat) != 0) {
+    const std::string error = strerror(errno);
+    ::close(fd);
+    throw ParsingException("Failed to stat file (" + error + ")");
+  }
+  _size = static_cast<uint64_t>(file_stat.st_size);
+  if (_size > 0) {
+    void* mapping = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+      const std::string error = strerror(errno);
+      ::close(fd);
+      throw ParsingException("Failed to map file (" + error + ")");
+    }
+    _data = static_cast<const uint8_t*>(mapping);
+  }
+  // The mapping stays valid after closing the file descriptor
+  ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (_data) {
+    ::munmap(const_cast<uint8_t*>(_data), _size);
+  }
+}
+
+#endif  // _WIN32
+
+}  // namespace ulog_cpp
@@ -0,0 +1,36 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ulog_cpp {
+
+/**
+ * Read-only memory mapping of a complete file. On Windows, the file is read into memory instead.
+ * Errors are reported with a ParsingException().
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const { return _data; }
+  uint64_t size() const { return _size; }
+
+ private:
+  const uint8_t* _data{nullptr};
+  uint64_t _size{0};
+#ifdef _WIN32
+  std::vector<uint8_t> _contents;
+#endif
+};
+
+}  // namespace ulog_cpp
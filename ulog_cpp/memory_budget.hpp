@@ -0,0 +1,61 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ulog_cpp {
+
+/**
+ * Memory accounting for the samples of the subscriptions of a DataContainer
+ * (@see DataContainer::setMemoryBudget()).
+ *
+ * Subscriptions that decode their samples on access (spilled, lazy or compressed) report when they
+ * decode and evict them. Decoding never evicts other subscriptions, as callers may still hold
+ * references into their samples: exceeding the budget is only reported, and it is up to the
+ * caller to evict explicitly.
+ */
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(uint64_t budget_bytes) : _budget(budget_bytes) {}
+
+  uint64_t budget() const { return _budget; }
+
+  /**
+   * @return estimated heap memory used by all samples in bytes
+   */
+  uint64_t usage() const { return _usage.load(std::memory_order_relaxed); }
+
+  bool exceeded() const { return usage() > _budget; }
+
+  void add(int64_t bytes) { _usage.fetch_add(static_cast<uint64_t>(bytes)); }
+
+  /**
+   * Replace the usage with a recomputed one
+   */
+  void set(uint64_t bytes) { _usage.store(bytes); }
+
+  /**
+   * Called after a subscription decoded its samples, using bytes of memory
+   */
+  void decoded(uint64_t bytes) { _usage.fetch_add(bytes); }
+
+  /**
+   * Called after a subscription evicted its decoded samples, freeing bytes of memory
+   */
+  void evicted(uint64_t bytes)
+  {
+    uint64_t usage = _usage.load();
+    while (!_usage.compare_exchange_weak(usage, usage > bytes ? usage - bytes : 0)) {
+    }
+  }
+
+ private:
+  const uint64_t _budget;
+  std::atomic<uint64_t> _usage{0};
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,115 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "merge_iterator.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ulog_cpp {
+
+MergeIterator::MergeIterator(std::vector<std::shared_ptr<Subscription>> subscriptions,
+                             uint64_t start_timestamp, const std::string& timestamp_field)
+    : _subscriptions(std::move(subscriptions))
+{
+  _timestamp_offsets.reserve(_subscriptions.size());
+  for (const auto& subscription : _subscriptions) {
+    if (!subscription) {
+      throw AccessException("Invalid subscription");
+    }
+    const auto field_ptr = subscription->format()->findField(timestamp_field);
+    if (!field_ptr || !field_ptr->definitionResolved()) {
+      throw AccessException("Field " + timestamp_field + " not found in " +
+                            subscription->format()->name());
+    }
+    const Field& field = *field_ptr;
+    if (field.type().type != Field::BasicType::UINT64 || field.arrayLength() != -1) {
+      throw UsageException("Field " + timestamp_field + " in " + subscription->format()->name() +
+                           " is not of type uint64_t");
+    }
+    _timestamp_offsets.push_back(field.offsetInMessage());
+  }
+  _heap.reserve(_subscriptions.size());
+  seek(start_timestamp);
+}
+
+const Data& MergeIterator::sample(int subscription_index, size_t sample_index,
+                                  std::shared_ptr<const SampleBlock>& block) const
+{
+  const Subscription& subscription = *_subscriptions[subscription_index];
+  if (!subscription.decodedOnAccess()) {
+    return subscription.rawSamples()[sample_index];
+  }
+  if (!block || sample_index < block->first ||
+      sample_index >= block->first + block->samples.size()) {
+    block = subscription.decodeBlock(sample_index);
+  }
+  return block->samples[sample_index - block->first];
+}
+
+uint64_t MergeIterator::timestamp(int subscription_index, size_t sample_index,
+                                  std::shared_ptr<const SampleBlock>& block) const
+{
+  const auto& data = sample(subscription_index, sample_index, block).data();
+  const int offset = _timestamp_offsets[subscription_index];
+  if (data.size() < offset + sizeof(uint64_t)) {
+    throw ParsingException("Sample too short for the timestamp");
+  }
+  uint64_t timestamp;
+  memcpy(&timestamp, data.data() + offset, sizeof(timestamp));
+  return timestamp;
+}
+
+void MergeIterator::seek(uint64_t start_timestamp)
+{
+  _heap.clear();
+  for (int i = 0; i < static_cast<int>(_subscriptions.size()); ++i) {
+    // Binary search for the first sample >= start_timestamp
+    std::shared_ptr<const SampleBlock> block;
+    size_t first = 0;
+    size_t count = _subscriptions[i]->size();
+    while (count > 0) {
+      const size_t step = count / 2;
+      if (timestamp(i, first + step, block) < start_timestamp) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+    if (first < _subscriptions[i]->size()) {
+      const uint64_t first_timestamp = timestamp(i, first, block);
+      _heap.push_back({first_timestamp, i, first, std::move(block)});
+    }
+  }
+  std::make_heap(_heap.begin(), _heap.end(), later);
+}
+
+MergedSample MergeIterator::operator*() const
+{
+  const Cursor& cursor = _heap.front();
+  const Subscription& subscription = *_subscriptions[cursor.subscription_index];
+  // The cursor's block already contains the sample
+  auto block = cursor.block;
+  const Data& data = sample(cursor.subscription_index, cursor.sample_index, block);
+  return {cursor.subscription_index, subscription, TypedDataView(data, *subscription.format()),
+          cursor.timestamp, std::move(block)};
+}
+
+MergeIterator& MergeIterator::operator++()
+{
+  std::pop_heap(_heap.begin(), _heap.end(), later);
+  Cursor& cursor = _heap.back();
+  ++cursor.sample_index;
+  if (cursor.sample_index < _subscriptions[cursor.subscription_index]->size()) {
+    cursor.timestamp = timestamp(cursor.subscription_index, cursor.sample_index, cursor.block);
+    std::push_heap(_heap.begin(), _heap.end(), later);
+  } else {
+    _heap.pop_back();
+  }
+  return *this;
+}
+
+}  // namespace ulog_cpp
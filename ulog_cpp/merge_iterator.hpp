@@ -0,0 +1,143 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "subscription.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Sample yielded by MergeIterator. Like TypedDataView, it is only valid as long as the
+ * subscription is unchanged.
+ */
+struct MergedSample {
+  int subscription_index;  ///< index into MergeIterator::subscriptions()
+  const Subscription& subscription;
+  TypedDataView data;
+  uint64_t timestamp;
+  std::shared_ptr<const SampleBlock> block;  ///< keeps data alive, if decoded on access
+};
+
+/**
+ * Iterates over the samples of multiple subscriptions in global timestamp order (k-way merge).
+ *
+ * The timestamps are read in place from a uint64_t field of each subscription, and the
+ * samples of each subscription must be ordered by it (as logged). The iterator keeps a min-heap
+ * with one cursor per subscription, so it needs O(k) memory, and each step takes O(log k).
+ * Lazy, spilled and compressed subscriptions are not decoded as a whole: each cursor holds the
+ * decoded block of its current sample (@see Subscription::decodeBlock()), which adds O(k) blocks.
+ * Samples with equal timestamps are ordered by subscription index.
+ *
+ * Usage:
+ *   for (MergeIterator it(subscriptions); !it.done(); ++it) { ... (*it).data ... }
+ * or
+ *   for (const MergedSample& sample : MergeIterator(subscriptions)) { ... }
+ */
+class MergeIterator {
+ public:
+  /**
+   * Input iterator for range-based for loops, advancing the MergeIterator it belongs to
+   */
+  class RangeIterator {
+   public:
+    using iterator_category = std::input_iterator_tag;  // NOLINT(*-identifier-naming)
+    using value_type = MergedSample;                    // NOLINT(*-identifier-naming)
+    using difference_type = std::ptrdiff_t;             // NOLINT(*-identifier-naming)
+    using pointer = const MergedSample*;                // NOLINT(*-identifier-naming)
+    using reference = MergedSample;                     // NOLINT(*-identifier-naming)
+
+    explicit RangeIterator(MergeIterator* merge_iterator) : _merge_iterator(merge_iterator) {}
+
+    MergedSample operator*() const { return **_merge_iterator; }
+    RangeIterator& operator++()
+    {
+      ++*_merge_iterator;
+      return *this;
+    }
+    bool operator==(const RangeIterator& other) const { return atEnd() == other.atEnd(); }
+    bool operator!=(const RangeIterator& other) const { return !(*this == other); }
+
+   private:
+    bool atEnd() const { return !_merge_iterator || _merge_iterator->done(); }
+
+    MergeIterator* _merge_iterator;
+  };
+
+  /**
+   * @param subscriptions subscriptions to merge. Each must have a uint64_t timestamp_field.
+   * @param start_timestamp skip all samples before this timestamp (window start)
+   * @param timestamp_field name of the field to order by
+   */
+  explicit MergeIterator(std::vector<std::shared_ptr<Subscription>> subscriptions,
+                         uint64_t start_timestamp = 0,
+                         const std::string& timestamp_field = "timestamp");
+
+  /**
+   * @return true if all samples have been visited
+   */
+  bool done() const { return _heap.empty(); }
+
+  /**
+   * Get the current sample. Must not be called if done()
+   */
+  MergedSample operator*() const;
+
+  /**
+   * Advance to the next sample in timestamp order
+   */
+  MergeIterator& operator++();
+
+  /**
+   * Restart at the first sample with a timestamp >= start_timestamp. This uses a binary search
+   * per subscription.
+   */
+  void seek(uint64_t start_timestamp);
+
+  const std::vector<std::shared_ptr<Subscription>>& subscriptions() const
+  {
+    return _subscriptions;
+  }
+
+  RangeIterator begin() { return RangeIterator(this); }
+  RangeIterator end() { return RangeIterator(nullptr); }  // NOLINT(*-convert-member-*)
+
+ private:
+  struct Cursor {
+    uint64_t timestamp;
+    int subscription_index;
+    size_t sample_index;
+    std::shared_ptr<const SampleBlock> block;  ///< containing sample_index, if decoded on access
+  };
+  /**
+   * Heap comparison, the earliest cursor is at the front
+   */
+  static bool later(const Cursor& a, const Cursor& b)
+  {
+    if (a.timestamp != b.timestamp) {
+      return a.timestamp > b.timestamp;
+    }
+    return a.subscription_index > b.subscription_index;
+  }
+
+  /**
+   * @param block decoded block to read from, replaced if it does not contain the sample
+   */
+  const Data& sample(int subscription_index, size_t sample_index,
+                     std::shared_ptr<const SampleBlock>& block) const;
+  uint64_t timestamp(int subscription_index, size_t sample_index,
+                     std::shared_ptr<const SampleBlock>& block) const;
+
+  std::vector<std::shared_ptr<Subscription>> _subscriptions;
+  std::vector<int> _timestamp_offsets;  ///< per subscription
+  std::vector<Cursor> _heap;
+};
+
+}  // namespace ulog_cpp
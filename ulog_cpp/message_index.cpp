@@ -0,0 +1,105 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "message_index.hpp"
+
+#include <algorithm>
+#include <future>
+
+#include "exception.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+// Below this merged size, merging is faster than starting a thread
+constexpr size_t kParallelMergeThreshold = 64 * 1024;
+
+bool earlier(const MessageIndex::Entry& a, const MessageIndex::Entry& b)
+{
+  return a.timestamp < b.timestamp;
+}
+
+std::vector<MessageIndex::Entry> mergeRuns(std::vector<MessageIndex::Entry>& a,
+                                           std::vector<MessageIndex::Entry>& b)
+{
+  std::vector<MessageIndex::Entry> merged(a.size() + b.size());
+  std::merge(a.begin(), a.end(), b.begin(), b.end(), merged.begin(), earlier);
+  a = {};
+  b = {};
+  return merged;
+}
+
+}  // namespace
+
+void MessageIndex::finalize()
+{
+  if (_finalized) {
+    return;
+  }
+  // Collect the runs in tie-breaking order. Previously merged entries come first.
+  std::vector<std::vector<Entry>> runs;
+  if (!_entries.empty()) {
+    runs.push_back(std::move(_entries));
+  }
+  for (auto& run : _data_runs) {
+    if (!run.empty()) {
+      runs.push_back(std::move(run));
+    }
+  }
+  for (auto* run : {&_logging_run, &_parameter_run}) {
+    if (!run->empty()) {
+      runs.push_back(std::move(*run));
+    }
+  }
+  _data_runs.clear();
+  _logging_run.clear();
+  _parameter_run.clear();
+
+  // Logged timestamps are usually monotonic per source already
+  for (auto& run : runs) {
+    if (!std::is_sorted(run.begin(), run.end(), earlier)) {
+      std::stable_sort(run.begin(), run.end(), earlier);
+    }
+  }
+
+  // Pairwise merge tree, with the large merges running concurrently
+  while (runs.size() > 1) {
+    std::vector<std::vector<Entry>> merged((runs.size() + 1) / 2);
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i + 1 < runs.size(); i += 2) {
+      auto merge = [&runs, &merged, i]() { merged[i / 2] = mergeRuns(runs[i], runs[i + 1]); };
+      if (runs[i].size() + runs[i + 1].size() >= kParallelMergeThreshold) {
+        futures.push_back(std::async(std::launch::async, merge));
+      } else {
+        merge();
+      }
+    }
+    if (runs.size() % 2 == 1) {
+      merged.back() = std::move(runs.back());
+    }
+    for (auto& future : futures) {
+      future.get();
+    }
+    runs = std::move(merged);
+  }
+  _entries = runs.empty() ? std::vector<Entry>{} : std::move(runs.front());
+  _finalized = true;
+}
+
+MessageIndex::Slice MessageIndex::range(uint64_t start, uint64_t end) const
+{
+  if (!_finalized) {
+    throw UsageException("Message index not finalized");
+  }
+  const auto first = std::lower_bound(_entries.begin(), _entries.end(), start,
+                                      [](const Entry& e, uint64_t t) { return e.timestamp < t; });
+  const auto last = std::lower_bound(first, _entries.end(), std::max(start, end),
+                                     [](const Entry& e, uint64_t t) { return e.timestamp < t; });
+  const Entry* data = _entries.data();
+  return {data + (first - _entries.begin()), data + (last - _entries.begin())};
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,97 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ulog_cpp {
+
+/**
+ * Time-ordered index over all data samples, logging messages and parameter changes of a log.
+ *
+ * Entries are collected in one run per source (message id, logging, parameters) while parsing.
+ * finalize() sorts each run if needed and merges them pairwise (in parallel for large runs)
+ * into one contiguous array, so that range() can return a slice for any time range.
+ */
+class MessageIndex {
+ public:
+  enum class Type : uint8_t {
+    Data,
+    Logging,
+    Parameter,
+  };
+
+  struct Entry {
+    uint64_t timestamp;
+    /**
+     * Data: sample index in the subscription. Logging/Parameter: index in
+     * DataContainer::logging()/DataContainer::changedParameters()
+     */
+    uint32_t index;
+    uint16_t msg_id;  ///< Data only
+    Type type;
+  };
+
+  class Slice {
+   public:
+    Slice(const Entry* begin, const Entry* end) : _begin(begin), _end(end) {}
+
+    const Entry* begin() const { return _begin; }
+    const Entry* end() const { return _end; }
+    size_t size() const { return _end - _begin; }
+    bool empty() const { return _begin == _end; }
+    const Entry& operator[](size_t n) const { return _begin[n]; }
+
+   private:
+    const Entry* _begin;
+    const Entry* _end;
+  };
+
+  void addData(uint16_t msg_id, uint32_t sample_index, uint64_t timestamp)
+  {
+    if (msg_id >= _data_runs.size()) {
+      _data_runs.resize(msg_id + 1);
+    }
+    _data_runs[msg_id].push_back({timestamp, sample_index, msg_id, Type::Data});
+    _finalized = false;
+  }
+  void addLogging(uint32_t index, uint64_t timestamp)
+  {
+    _logging_run.push_back({timestamp, index, 0, Type::Logging});
+    _finalized = false;
+  }
+  void addParameter(uint32_t index, uint64_t timestamp)
+  {
+    _parameter_run.push_back({timestamp, index, 0, Type::Parameter});
+    _finalized = false;
+  }
+
+  /**
+   * Merge all added entries. Entries can still be added afterwards, requiring another call.
+   * Entries with equal timestamps are ordered by type, then message id, then index (among the
+   * entries added since the previous call).
+   */
+  void finalize();
+  bool finalized() const { return _finalized; }
+
+  /**
+   * @return entries with start <= timestamp < end. Must be finalized.
+   */
+  Slice range(uint64_t start, uint64_t end) const;
+
+  Slice all() const { return {_entries.data(), _entries.data() + _entries.size()}; }
+  size_t size() const { return _entries.size(); }
+
+ private:
+  std::vector<Entry> _entries;
+  std::vector<std::vector<Entry>> _data_runs;  ///< indexed by message id
+  std::vector<Entry> _logging_run;
+  std::vector<Entry> _parameter_run;
+  bool _finalized{true};
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,619 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Compile-time description of a C++ struct as ULog message format. Specialize it with the
+ * ULOG_CPP_MESSAGE_TRAITS() macro:
+ *
+ *   struct MyData {
+ *     uint64_t timestamp;
+ *     float debug_array[4];
+ *     int8_t counter;
+ *   };
+ *   ULOG_CPP_MESSAGE_TRAITS(MyData, "my_data", timestamp, debug_array, counter)
+ *
+ * This provides:
+ * - kName: format name
+ * - kFields: field descriptors (name, type, array length, offset)
+ * - kSize: serialized (packed) size [bytes]
+ * - kFormat: the ULog format string ("my_data:uint64_t timestamp;float[4] debug_array;...")
+ *
+ * Fields can be basic types, structs with MessageTraits (nested formats) or 1-dimensional arrays
+ * of them. The macro checks with static_assert that the format name is valid, and the fields are
+ * listed in declaration order without padding between them. Field names are only restricted when
+ * writing (@see SimpleWriter::writeMessageFormat()), as existing logs may use other names.
+ */
+template <typename T>
+struct MessageTraits;
+
+template <typename T, typename = void>
+struct HasMessageTraits : std::false_type {};
+template <typename T>
+struct HasMessageTraits<T, std::void_t<decltype(MessageTraits<T>::kName)>> : std::true_type {};
+
+/**
+ * Message id of a time-series with a known struct type (@see SimpleWriter::writeAddLoggedMessage())
+ */
+template <typename T>
+struct MessageId {
+  uint16_t id;
+};
+
+/**
+ * Field of a struct with MessageTraits
+ */
+struct FieldDescriptor {
+  const char* name;
+  const char* type_name;
+  Field::BasicType type;
+  int array_length;  ///< -1 if not an array
+  size_t offset;     ///< offset in the struct [bytes]
+  size_t size;       ///< total size [bytes]
+};
+
+namespace detail {
+
+template <typename T>
+struct BasicTypeTraits {
+  static constexpr bool kSupported = false;
+};
+
+#define ULOG_CPP_DETAIL_BASIC_TYPE(cpp_type, basic_type)       \
+  template <>                                                  \
+  struct BasicTypeTraits<cpp_type> {                           \
+    static constexpr bool kSupported = true;                   \
+    static constexpr const char* kName = #cpp_type;            \
+    static constexpr Field::BasicType kType = basic_type;      \
+  };
+ULOG_CPP_DETAIL_BASIC_TYPE(int8_t, Field::BasicType::INT8)
+ULOG_CPP_DETAIL_BASIC_TYPE(uint8_t, Field::BasicType::UINT8)
+ULOG_CPP_DETAIL_BASIC_TYPE(int16_t, Field::BasicType::INT16)
+ULOG_CPP_DETAIL_BASIC_TYPE(uint16_t, Field::BasicType::UINT16)
+ULOG_CPP_DETAIL_BASIC_TYPE(int32_t, Field::BasicType::INT32)
+ULOG_CPP_DETAIL_BASIC_TYPE(uint32_t, Field::BasicType::UINT32)
+ULOG_CPP_DETAIL_BASIC_TYPE(int64_t, Field::BasicType::INT64)
+ULOG_CPP_DETAIL_BASIC_TYPE(uint64_t, Field::BasicType::UINT64)
+ULOG_CPP_DETAIL_BASIC_TYPE(float, Field::BasicType::FLOAT)
+ULOG_CPP_DETAIL_BASIC_TYPE(double, Field::BasicType::DOUBLE)
+ULOG_CPP_DETAIL_BASIC_TYPE(bool, Field::BasicType::BOOL)
+ULOG_CPP_DETAIL_BASIC_TYPE(char, Field::BasicType::CHAR)
+#undef ULOG_CPP_DETAIL_BASIC_TYPE
+
+template <typename Member>
+constexpr FieldDescriptor fieldDescriptor(const char* name, size_t offset)
+{
+  using Element = std::remove_all_extents_t<Member>;
+  static_assert(std::rank_v<Member> <= 1, "Multi-dimensional arrays are not supported");
+  const int array_length = std::rank_v<Member> == 1 ? static_cast<int>(std::extent_v<Member>) : -1;
+  if constexpr (BasicTypeTraits<Element>::kSupported) {
+    return {name,         BasicTypeTraits<Element>::kName, BasicTypeTraits<Element>::kType,
+            array_length, offset,                          sizeof(Member)};
+  } else {
+    static_assert(HasMessageTraits<Element>::value,
+                  "Unsupported field type (must be a basic type or have MessageTraits)");
+    static_assert(sizeof(Element) == MessageTraits<Element>::kSize,
+                  "Nested struct must not have padding");
+    return {name,         MessageTraits<Element>::kName, Field::BasicType::NESTED,
+            array_length, offset,                        sizeof(Member)};
+  }
+}
+
+constexpr size_t length(const char* str)
+{
+  size_t len = 0;
+  while (str[len] != 0) {
+    ++len;
+  }
+  return len;
+}
+
+constexpr bool equal(const char* a, const char* b)
+{
+  while (*a != 0 && *a == *b) {
+    ++a;
+    ++b;
+  }
+  return *a == *b;
+}
+
+constexpr size_t numDigits(int value)
+{
+  size_t digits = 1;
+  while (value >= 10) {
+    value /= 10;
+    ++digits;
+  }
+  return digits;
+}
+
+/**
+ * Format name regex: "[a-zA-Z0-9_\\-/]+"
+ */
+constexpr bool isValidFormatName(const char* name)
+{
+  if (*name == 0) {
+    return false;
+  }
+  for (; *name != 0; ++name) {
+    const char c = *name;
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+          c == '_' || c == '-' || c == '/')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Field name regex for writing: "[a-z0-9_]+"
+ */
+constexpr bool isValidFieldName(const char* name)
+{
+  if (*name == 0) {
+    return false;
+  }
+  for (; *name != 0; ++name) {
+    const char c = *name;
+    if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <size_t N>
+constexpr bool hasValidFieldNames(const FieldDescriptor (&fields)[N])
+{
+  for (const auto& field : fields) {
+    if (!isValidFieldName(field.name)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <size_t N>
+constexpr bool hasNestedFields(const FieldDescriptor (&fields)[N])
+{
+  for (const auto& field : fields) {
+    if (field.type == Field::BasicType::NESTED) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <size_t N>
+constexpr bool hasTimestampFirst(const FieldDescriptor (&fields)[N])
+{
+  return equal(fields[0].name, "timestamp") && fields[0].type == Field::BasicType::UINT64 &&
+         fields[0].array_length == -1;
+}
+
+/**
+ * @return true if each field directly follows the previous one
+ */
+template <size_t N>
+constexpr bool isPacked(const FieldDescriptor (&fields)[N])
+{
+  size_t offset = 0;
+  for (const auto& field : fields) {
+    if (field.offset != offset) {
+      return false;
+    }
+    offset += field.size;
+  }
+  return true;
+}
+
+template <size_t N>
+constexpr size_t packedSize(const FieldDescriptor (&fields)[N])
+{
+  size_t size = 0;
+  for (const auto& field : fields) {
+    size += field.size;
+  }
+  return size;
+}
+
+template <size_t N>
+constexpr size_t formatLength(const char* name, const FieldDescriptor (&fields)[N])
+{
+  size_t len = length(name) + 1;
+  for (const auto& field : fields) {
+    len += length(field.type_name) + 1 + length(field.name) + 1;
+    if (field.array_length >= 0) {
+      len += numDigits(field.array_length) + 2;
+    }
+  }
+  return len;
+}
+
+/**
+ * Null-terminated string with a length known at compile time
+ */
+template <size_t N>
+struct FixedString {
+  char data[N + 1]{};
+
+  constexpr const char* c_str() const { return data; }  // NOLINT(*-identifier-naming)
+  static constexpr size_t size() { return N; }
+  std::string str() const { return std::string(data, N); }
+};
+
+template <size_t Length, size_t N>
+constexpr FixedString<Length> buildFormat(const char* name, const FieldDescriptor (&fields)[N])
+{
+  FixedString<Length> format;
+  size_t pos = 0;
+  const auto append = [&format, &pos](const char* str) {
+    while (*str != 0) {
+      format.data[pos++] = *str++;
+    }
+  };
+  append(name);
+  format.data[pos++] = ':';
+  for (const auto& field : fields) {
+    append(field.type_name);
+    if (field.array_length >= 0) {
+      format.data[pos++] = '[';
+      const size_t digits = numDigits(field.array_length);
+      int value = field.array_length;
+      for (size_t i = 0; i < digits; ++i) {
+        format.data[pos + digits - 1 - i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+      }
+      pos += digits;
+      format.data[pos++] = ']';
+    }
+    format.data[pos++] = ' ';
+    append(field.name);
+    format.data[pos++] = ';';
+  }
+  return format;
+}
+
+}  // namespace detail
+
+/**
+ * @return the ULog fields of a struct with MessageTraits
+ */
+template <typename T>
+std::vector<Field> messageFields()
+{
+  std::vector<Field> fields;
+  fields.reserve(std::size(MessageTraits<T>::kFields));
+  for (const auto& field : MessageTraits<T>::kFields) {
+    fields.emplace_back(field.type_name, field.name, field.array_length);
+  }
+  return fields;
+}
+
+}  // namespace ulog_cpp
+
+// clang-format off
+#define ULOG_CPP_DETAIL_EXPAND(x) x
+#define ULOG_CPP_DETAIL_FE_1(m, t, x) m(t, x)
+#define ULOG_CPP_DETAIL_FE_2(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_1(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_3(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_2(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_4(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_3(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_5(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_4(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_6(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_5(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_7(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_6(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_8(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_7(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_9(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_8(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_10(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_9(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_11(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_10(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_12(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_11(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_13(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_12(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_14(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_13(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_15(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_14(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_16(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_15(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_17(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_16(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_18(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_17(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_19(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_18(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_20(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_19(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_21(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_20(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_22(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_21(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_23(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_22(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_24(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_23(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_25(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_24(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_26(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_25(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_27(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_26(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_28(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_27(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_29(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_28(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_30(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_29(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_31(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_30(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_32(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_31(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_33(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_32(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_34(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_33(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_35(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_34(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_36(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_35(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_37(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_36(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_38(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_37(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_39(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_38(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_40(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_39(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_41(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_40(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_42(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_41(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_43(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_42(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_44(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_43(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_45(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_44(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_46(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_45(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_47(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_46(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_48(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_47(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_49(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_48(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_50(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_49(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_51(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_50(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_52(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_51(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_53(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_52(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_54(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_53(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_55(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_54(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_56(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_55(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_57(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_56(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_58(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_57(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_59(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_58(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_60(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_59(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_61(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_60(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_62(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_61(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_63(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_62(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_64(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_63(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_65(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_64(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_66(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_65(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_67(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_66(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_68(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_67(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_69(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_68(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_70(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_69(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_71(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_70(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_72(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_71(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_73(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_72(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_74(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_73(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_75(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_74(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_76(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_75(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_77(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_76(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_78(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_77(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_79(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_78(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_80(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_79(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_81(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_80(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_82(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_81(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_83(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_82(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_84(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_83(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_85(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_84(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_86(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_85(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_87(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_86(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_88(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_87(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_89(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_88(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_90(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_89(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_91(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_90(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_92(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_91(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_93(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_92(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_94(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_93(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_95(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_94(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_96(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_95(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_97(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_96(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_98(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_97(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_99(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_98(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_100(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_99(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_101(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_100(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_102(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_101(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_103(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_102(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_104(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_103(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_105(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_104(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_106(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_105(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_107(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_106(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_108(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_107(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_109(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_108(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_110(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_109(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_111(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_110(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_112(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_111(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_113(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_112(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_114(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_113(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_115(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_114(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_116(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_115(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_117(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_116(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_118(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_117(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_119(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_118(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_FE_120(m, t, x, ...) \
+  m(t, x) ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_FE_119(m, t, __VA_ARGS__))
+#define ULOG_CPP_DETAIL_GET_FE( \
+  _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+  _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, \
+  _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, _43, _44, _45, _46, _47, _48, \
+  _49, _50, _51, _52, _53, _54, _55, _56, _57, _58, _59, _60, _61, _62, _63, _64, \
+  _65, _66, _67, _68, _69, _70, _71, _72, _73, _74, _75, _76, _77, _78, _79, _80, \
+  _81, _82, _83, _84, _85, _86, _87, _88, _89, _90, _91, _92, _93, _94, _95, _96, \
+  _97, _98, _99, _100, _101, _102, _103, _104, _105, _106, _107, _108, _109, _110, _111, _112, \
+  _113, _114, _115, _116, _117, _118, _119, _120, NAME, ...) NAME
+#define ULOG_CPP_DETAIL_FOR_EACH(m, t, ...) \
+  ULOG_CPP_DETAIL_EXPAND(ULOG_CPP_DETAIL_GET_FE(__VA_ARGS__, \
+  ULOG_CPP_DETAIL_FE_120, ULOG_CPP_DETAIL_FE_119, ULOG_CPP_DETAIL_FE_118, ULOG_CPP_DETAIL_FE_117, \
+  ULOG_CPP_DETAIL_FE_116, ULOG_CPP_DETAIL_FE_115, ULOG_CPP_DETAIL_FE_114, ULOG_CPP_DETAIL_FE_113, \
+  ULOG_CPP_DETAIL_FE_112, ULOG_CPP_DETAIL_FE_111, ULOG_CPP_DETAIL_FE_110, ULOG_CPP_DETAIL_FE_109, \
+  ULOG_CPP_DETAIL_FE_108, ULOG_CPP_DETAIL_FE_107, ULOG_CPP_DETAIL_FE_106, ULOG_CPP_DETAIL_FE_105, \
+  ULOG_CPP_DETAIL_FE_104, ULOG_CPP_DETAIL_FE_103, ULOG_CPP_DETAIL_FE_102, ULOG_CPP_DETAIL_FE_101, \
+  ULOG_CPP_DETAIL_FE_100, ULOG_CPP_DETAIL_FE_99, ULOG_CPP_DETAIL_FE_98, ULOG_CPP_DETAIL_FE_97, \
+  ULOG_CPP_DETAIL_FE_96, ULOG_CPP_DETAIL_FE_95, ULOG_CPP_DETAIL_FE_94, ULOG_CPP_DETAIL_FE_93, \
+  ULOG_CPP_DETAIL_FE_92, ULOG_CPP_DETAIL_FE_91, ULOG_CPP_DETAIL_FE_90, ULOG_CPP_DETAIL_FE_89, \
+  ULOG_CPP_DETAIL_FE_88, ULOG_CPP_DETAIL_FE_87, ULOG_CPP_DETAIL_FE_86, ULOG_CPP_DETAIL_FE_85, \
+  ULOG_CPP_DETAIL_FE_84, ULOG_CPP_DETAIL_FE_83, ULOG_CPP_DETAIL_FE_82, ULOG_CPP_DETAIL_FE_81, \
+  ULOG_CPP_DETAIL_FE_80, ULOG_CPP_DETAIL_FE_79, ULOG_CPP_DETAIL_FE_78, ULOG_CPP_DETAIL_FE_77, \
+  ULOG_CPP_DETAIL_FE_76, ULOG_CPP_DETAIL_FE_75, ULOG_CPP_DETAIL_FE_74, ULOG_CPP_DETAIL_FE_73, \
+  ULOG_CPP_DETAIL_FE_72, ULOG_CPP_DETAIL_FE_71, ULOG_CPP_DETAIL_FE_70, ULOG_CPP_DETAIL_FE_69, \
+  ULOG_CPP_DETAIL_FE_68, ULOG_CPP_DETAIL_FE_67, ULOG_CPP_DETAIL_FE_66, ULOG_CPP_DETAIL_FE_65, \
+  ULOG_CPP_DETAIL_FE_64, ULOG_CPP_DETAIL_FE_63, ULOG_CPP_DETAIL_FE_62, ULOG_CPP_DETAIL_FE_61, \
+  ULOG_CPP_DETAIL_FE_60, ULOG_CPP_DETAIL_FE_59, ULOG_CPP_DETAIL_FE_58, ULOG_CPP_DETAIL_FE_57, \
+  ULOG_CPP_DETAIL_FE_56, ULOG_CPP_DETAIL_FE_55, ULOG_CPP_DETAIL_FE_54, ULOG_CPP_DETAIL_FE_53, \
+  ULOG_CPP_DETAIL_FE_52, ULOG_CPP_DETAIL_FE_51, ULOG_CPP_DETAIL_FE_50, ULOG_CPP_DETAIL_FE_49, \
+  ULOG_CPP_DETAIL_FE_48, ULOG_CPP_DETAIL_FE_47, ULOG_CPP_DETAIL_FE_46, ULOG_CPP_DETAIL_FE_45, \
+  ULOG_CPP_DETAIL_FE_44, ULOG_CPP_DETAIL_FE_43, ULOG_CPP_DETAIL_FE_42, ULOG_CPP_DETAIL_FE_41, \
+  ULOG_CPP_DETAIL_FE_40, ULOG_CPP_DETAIL_FE_39, ULOG_CPP_DETAIL_FE_38, ULOG_CPP_DETAIL_FE_37, \
+  ULOG_CPP_DETAIL_FE_36, ULOG_CPP_DETAIL_FE_35, ULOG_CPP_DETAIL_FE_34, ULOG_CPP_DETAIL_FE_33, \
+  ULOG_CPP_DETAIL_FE_32, ULOG_CPP_DETAIL_FE_31, ULOG_CPP_DETAIL_FE_30, ULOG_CPP_DETAIL_FE_29, \
+  ULOG_CPP_DETAIL_FE_28, ULOG_CPP_DETAIL_FE_27, ULOG_CPP_DETAIL_FE_26, ULOG_CPP_DETAIL_FE_25, \
+  ULOG_CPP_DETAIL_FE_24, ULOG_CPP_DETAIL_FE_23, ULOG_CPP_DETAIL_FE_22, ULOG_CPP_DETAIL_FE_21, \
+  ULOG_CPP_DETAIL_FE_20, ULOG_CPP_DETAIL_FE_19, ULOG_CPP_DETAIL_FE_18, ULOG_CPP_DETAIL_FE_17, \
+  ULOG_CPP_DETAIL_FE_16, ULOG_CPP_DETAIL_FE_15, ULOG_CPP_DETAIL_FE_14, ULOG_CPP_DETAIL_FE_13, \
+  ULOG_CPP_DETAIL_FE_12, ULOG_CPP_DETAIL_FE_11, ULOG_CPP_DETAIL_FE_10, ULOG_CPP_DETAIL_FE_9, \
+  ULOG_CPP_DETAIL_FE_8, ULOG_CPP_DETAIL_FE_7, ULOG_CPP_DETAIL_FE_6, ULOG_CPP_DETAIL_FE_5, \
+  ULOG_CPP_DETAIL_FE_4, ULOG_CPP_DETAIL_FE_3, ULOG_CPP_DETAIL_FE_2, ULOG_CPP_DETAIL_FE_1) \
+  (m, t, __VA_ARGS__))
+// clang-format on
+
+#define ULOG_CPP_DETAIL_FIELD_DESCRIPTOR(type, field) \
+  ::ulog_cpp::detail::fieldDescriptor<decltype(type::field)>(#field, offsetof(type, field)),
+
+/**
+ * Define MessageTraits for a struct (@see MessageTraits). Must be used in the global namespace.
+ * @param type struct type (standard layout, trivially copyable)
+ * @param name ULog format name
+ * @param ... all fields in declaration order (at most 120)
+ */
+#define ULOG_CPP_MESSAGE_TRAITS(type, name, ...)                                                 \
+  template <>                                                                                    \
+  struct ulog_cpp::MessageTraits<type> {                                                         \
+    static_assert(std::is_standard_layout_v<type> && std::is_trivially_copyable_v<type>,         \
+                  "Message struct must be standard layout and trivially copyable");              \
+    static constexpr const char* kName = name;                                                   \
+    static constexpr ::ulog_cpp::FieldDescriptor kFields[] = {                                   \
+        ULOG_CPP_DETAIL_FOR_EACH(ULOG_CPP_DETAIL_FIELD_DESCRIPTOR, type, __VA_ARGS__)};          \
+    static constexpr size_t kSize = ::ulog_cpp::detail::packedSize(kFields);                     \
+    static constexpr auto kFormat =                                                              \
+        ::ulog_cpp::detail::buildFormat<::ulog_cpp::detail::formatLength(kName, kFields)>(       \
+            kName, kFields);                                                                     \
+    static_assert(::ulog_cpp::detail::isValidFormatName(kName), "Invalid format name");          \
+    static_assert(::ulog_cpp::detail::isPacked(kFields),                                         \
+                  "Fields must be listed in declaration order and require no padding (reorder "  \
+                  "fields by decreasing type size)");                                            \
+    static_assert(sizeof(type) - kSize < alignof(type), "Not all fields are listed");            \
+  };
@@ -10,6 +10,8 @@
 #include <memory>
 #include <utility>
 
+#include "segment_buffer.hpp"
+
 #define CHECK_MSG_SIZE(size, min_required) \
   if ((size) < (min_required)) throw ParsingException("message too short")
 
@@ -87,7 +89,7 @@ Field::Field(const char* str, int len)
   _name = key_value.substr(first_space + 1);
   // Check for arrays
   const std::string::size_type bracket = key_array.find('[');
-  std::string type_name;
+  std::string_view type_name;
   if (bracket == std::string::npos) {
     type_name = key_array;
   } else {
@@ -97,12 +99,12 @@ Field::Field(const char* str, int len)
     }
     _array_length = std::stoi(std::string(key_array.substr(bracket + 1)));
   }
-  auto it_basic = kBasicTypes.find(type_name);
-  if (it_basic != kBasicTypes.end()) {
-    _type = it_basic->second;
+  const TypeAttributes* basic_type = findBasicType(type_name);
+  if (basic_type) {
+    _type = *basic_type;
   } else {
     // Assume this is a recursive type (unresolved at this point)
-    _type = {type_name, Field::BasicType::NESTED, 0};
+    _type = {std::string(type_name), Field::BasicType::NESTED, 0};
   }
 }
 
@@ -172,6 +174,18 @@ const std::map<std::string, Field::TypeAttributes> Field::kBasicTypes{
     {"bool", {"bool", Field::BasicType::BOOL, 1}},
     {"char", {"char", Field::BasicType::CHAR, 1}}};
 
+const Field::TypeAttributes* Field::findBasicType(std::string_view type_name)
+{
+  static const NameMap<TypeAttributes> kBasicTypeLookup = []() {
+    NameMap<TypeAttributes> lookup;
+    for (const auto& [name, attributes] : kBasicTypes) {
+      lookup.insert(name, attributes);
+    }
+    return lookup;
+  }();
+  return kBasicTypeLookup.find(type_name);
+}
+
 int Field::sizeBytes() const
 {
   if (!definitionResolved()) {
@@ -352,7 +366,7 @@ MessageInfo::MessageInfo(const std::string& key, const std::string& value)
   _value.resize(value.length());
   memcpy(_value.data(), value.data(), value.length());
 }
-void MessageInfo::serialize(const DataWriteCB& writer, ULogMessageType type) const
+void MessageInfo::serializeHeader(const DataWriteCB& writer, ULogMessageType type) const
 {
   const std::string field_encoded = _field.encode();
   if (_is_multi) {
@@ -368,7 +382,6 @@ void MessageInfo::serialize(const DataWriteCB& writer, ULogMessageType type) con
 
     writer(reinterpret_cast<const unsigned char*>(&info_multi), ULOG_MSG_HEADER_LEN + 2);
     writer(reinterpret_cast<const unsigned char*>(field_encoded.data()), field_encoded.size());
-    writer(reinterpret_cast<const unsigned char*>(_value.data()), _value.size());
   } else {
     ulog_message_info_s info{};
     const int msg_size = field_encoded.length() + _value.size() + 1;
@@ -382,9 +395,19 @@ void MessageInfo::serialize(const DataWriteCB& writer, ULogMessageType type) con
 
     writer(reinterpret_cast<const unsigned char*>(&info), ULOG_MSG_HEADER_LEN + 1);
     writer(reinterpret_cast<const unsigned char*>(field_encoded.data()), field_encoded.size());
-    writer(reinterpret_cast<const unsigned char*>(_value.data()), _value.size());
   }
 }
+void MessageInfo::serialize(const DataWriteCB& writer, ULogMessageType type) const
+{
+  serializeHeader(writer, type);
+  writer(_value.data(), _value.size());
+}
+void MessageInfo::serialize(SegmentBuffer& buffer, ULogMessageType type) const
+{
+  // The header and key are temporaries and need to be copied
+  serializeHeader(buffer.copyCallback(), type);
+  buffer.reference(_value.data(), static_cast<int>(_value.size()));
+}
 MessageFormat::MessageFormat(const uint8_t* msg)
 {
   const ulog_message_format_s* format = reinterpret_cast<const ulog_message_format_s*>(msg);
@@ -401,9 +424,7 @@ MessageFormat::MessageFormat(const uint8_t* msg)
     if (semicolon == std::string::npos) {
       throw ParsingException("Invalid message format (no ;)");  // invalid
     }
-    auto f = std::make_shared<Field>(format_str.data(), static_cast<int>(semicolon));
-    _fields.insert({f->name(), f});
-    _fields_ordered.push_back(f);
+    addField(std::make_shared<Field>(format_str.data(), static_cast<int>(semicolon)));
     format_str = format_str.substr(semicolon + 1);
   }
 }
@@ -411,14 +432,22 @@ MessageFormat::MessageFormat(std::string name, const std::vector<Field>& fields)
     : _name(std::move(name))
 {
   for (const auto& current_field : fields) {
-    auto f = std::make_shared<Field>(current_field);
-    _fields.insert({f->name(), f});
-    _fields_ordered.push_back(f);
+    addField(std::make_shared<Field>(current_field));
   }
 }
 
+void MessageFormat::addField(std::shared_ptr<Field> field)
+{
+  _fields.insert({field->name(), field});
+  _field_lookup.insert(field->name(), field);
+  _fields_ordered.push_back(std::move(field));
+}
+
 int MessageFormat::sizeBytes() const
 {
+  if (_resolved) {
+    return _size_bytes;
+  }
   int size = 0;
   for (const auto& it : _fields) {
     size += it.second->sizeBytes();
@@ -429,6 +458,9 @@ int MessageFormat::sizeBytes() const
 void MessageFormat::resolveDefinition(
     const std::map<std::string, std::shared_ptr<MessageFormat>>& existing_formats) const
 {
+  if (_resolved) {
+    return;
+  }
   int offset = 0;
   for (const auto& current_field : _fields_ordered) {
     if (!current_field->definitionResolved()) {
@@ -436,6 +468,56 @@ void MessageFormat::resolveDefinition(
     }
     offset += current_field->sizeBytes();
   }
+  _size_bytes = offset;
+
+  _layout.clear();
+  _layout.reserve(_fields_ordered.size());
+  flattenLayout();
+  _content_hash = NameMap<int>::hash(_name);
+  const auto combine = [this](const void* data, size_t size) {
+    // FNV-1a, continued
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      _content_hash ^= bytes[i];
+      _content_hash *= 1099511628211ULL;
+    }
+  };
+  for (const auto& leaf : _layout) {
+    combine(leaf.path.data(), leaf.path.size() + 1);  // including the terminating 0
+    const int32_t values[] = {leaf.offset, static_cast<int32_t>(leaf.type), leaf.count};
+    combine(values, sizeof(values));
+  }
+  _resolved = true;
+}
+
+void MessageFormat::flattenLayout() const
+{
+  for (const auto& current_field : _fields_ordered) {
+    const Field::TypeAttributes& type = current_field->type();
+    const int offset = current_field->offsetInMessage();
+    const std::string& path = current_field->name();
+    if (type.type != Field::BasicType::NESTED) {
+      const int count = current_field->arrayLength() < 0 ? 1 : current_field->arrayLength();
+      _layout.push_back({path, offset, type.type, type.size, count});
+      continue;
+    }
+    // Nested formats are resolved already
+    const int count = current_field->arrayLength() < 0 ? 1 : current_field->arrayLength();
+    const auto& nested_layout = type.nested_message->layout();
+    _layout.reserve(_layout.size() + count * nested_layout.size());
+    std::string element_path = path;
+    for (int i = 0; i < count; ++i) {
+      element_path.resize(path.size());
+      if (current_field->arrayLength() >= 0) {
+        element_path += '[' + std::to_string(i) + ']';
+      }
+      element_path += '.';
+      for (const auto& leaf : nested_layout) {
+        _layout.push_back({element_path + leaf.path, offset + i * type.size + leaf.offset,
+                           leaf.type, leaf.size, leaf.count});
+      }
+    }
+  }
 }
 
 void MessageFormat::serialize(const DataWriteCB& writer) const
@@ -554,6 +636,14 @@ Logging::Logging(Level level, std::string message, uint64_t timestamp)
     : _log_level(level), _timestamp(timestamp), _message(std::move(message))
 {
 }
+Logging::Logging(Level level, std::string message, uint64_t timestamp, uint16_t tag)
+    : _log_level(level),
+      _tag(tag),
+      _has_tag(true),
+      _timestamp(timestamp),
+      _message(std::move(message))
+{
+}
 std::string Logging::logLevelStr() const
 {
   switch (_log_level) {
@@ -576,7 +666,7 @@ std::string Logging::logLevelStr() const
   }
   return "unknown";
 }
-void Logging::serialize(const DataWriteCB& writer) const
+void Logging::serializeHeader(const DataWriteCB& writer) const
 {
   if (_has_tag) {
     ulog_message_logging_tagged_s logging;
@@ -590,7 +680,6 @@ void Logging::serialize(const DataWriteCB& writer) const
     logging.msg_size = msg_size;
 
     writer(reinterpret_cast<const unsigned char*>(&logging), ULOG_MSG_HEADER_LEN + 11);
-    writer(reinterpret_cast<const unsigned char*>(_message.data()), _message.size());
   } else {
     ulog_message_logging_s logging;
     const int msg_size = _message.size() + 9;
@@ -602,9 +691,19 @@ void Logging::serialize(const DataWriteCB& writer) const
     logging.msg_size = msg_size;
 
     writer(reinterpret_cast<const unsigned char*>(&logging), ULOG_MSG_HEADER_LEN + 9);
-    writer(reinterpret_cast<const unsigned char*>(_message.data()), _message.size());
   }
 }
+void Logging::serialize(const DataWriteCB& writer) const
+{
+  serializeHeader(writer);
+  writer(reinterpret_cast<const unsigned char*>(_message.data()), _message.size());
+}
+void Logging::serialize(SegmentBuffer& buffer) const
+{
+  serializeHeader(buffer.copyCallback());
+  buffer.reference(reinterpret_cast<const uint8_t*>(_message.data()),
+                   static_cast<int>(_message.size()));
+}
 
 Data::Data(const uint8_t* msg)
 {
@@ -618,7 +717,7 @@ Data::Data(const uint8_t* msg)
 Data::Data(uint16_t msg_id, std::vector<uint8_t> data) : _msg_id(msg_id), _data(std::move(data))
 {
 }
-void Data::serialize(const DataWriteCB& writer) const
+void Data::serializeHeader(const DataWriteCB& writer) const
 {
   ulog_message_data_s data_msg;
   const int msg_size = _data.size() + 2;
@@ -629,7 +728,16 @@ void Data::serialize(const DataWriteCB& writer) const
   data_msg.msg_size = msg_size;
 
   writer(reinterpret_cast<const unsigned char*>(&data_msg), ULOG_MSG_HEADER_LEN + 2);
-  writer(reinterpret_cast<const unsigned char*>(_data.data()), _data.size());
+}
+void Data::serialize(const DataWriteCB& writer) const
+{
+  serializeHeader(writer);
+  writer(_data.data(), _data.size());
+}
+void Data::serialize(SegmentBuffer& buffer) const
+{
+  serializeHeader(buffer.copyCallback());
+  buffer.reference(_data.data(), static_cast<int>(_data.size()));
 }
 
 Dropout::Dropout(const uint8_t* msg)
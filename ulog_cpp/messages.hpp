@@ -11,10 +11,12 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 #include "exception.hpp"
+#include "name_map.hpp"
 #include "raw_messages.hpp"
 #include "utils.hpp"
 
@@ -29,6 +31,8 @@ namespace ulog_cpp {
  */
 using DataWriteCB = std::function<void(const uint8_t* data, int length)>;
 
+class SegmentBuffer;  // forward declaration
+
 /**
  * @brief ULog file header "message". The file header is always the first element in a ULG file.
  */
@@ -125,6 +129,12 @@ class Field {
    */
   static const std::map<std::string, TypeAttributes> kBasicTypes;
 
+  /**
+   * Hashed lookup in kBasicTypes
+   * @return the type attributes, or nullptr if type_name is not a basic type
+   */
+  static const TypeAttributes* findBasicType(std::string_view type_name);
+
   Field() = default;
 
   /**
@@ -145,9 +155,9 @@ class Field {
   Field(const std::string& type_str, std::string name_str, int array_length_int = -1)
       : _array_length(array_length_int), _name(std::move(name_str))
   {
-    auto it = kBasicTypes.find(type_str);
-    if (it != kBasicTypes.end()) {
-      _type = it->second;
+    const TypeAttributes* basic_type = findBasicType(type_str);
+    if (basic_type) {
+      _type = *basic_type;
     } else {
       // if not a basic type, set it to recursive
       _type = TypeAttributes(type_str, BasicType::NESTED, 0);
@@ -485,6 +495,10 @@ class MessageInfo {
   bool isMulti() const { return _is_multi; }
 
   void serialize(const DataWriteCB& writer, ULogMessageType type = ULogMessageType::INFO) const;
+  /**
+   * Serialize for gather-I/O: the value is referenced, not copied
+   */
+  void serialize(SegmentBuffer& buffer, ULogMessageType type = ULogMessageType::INFO) const;
 
   bool operator==(const MessageInfo& info) const
   {
@@ -493,6 +507,11 @@ class MessageInfo {
   }
 
  private:
+  /**
+   * Serialize everything but the value
+   */
+  void serializeHeader(const DataWriteCB& writer, ULogMessageType type) const;
+
   void initValues(const char* values, int len);
   Field _field;
   std::vector<uint8_t> _value;
@@ -515,6 +534,18 @@ class MessageInfo {
  */
 class MessageFormat {
  public:
+  /**
+   * A basic-type element of the flattened layout. Nested fields are expanded recursively (also
+   * each element of an array of nested fields), arrays of basic types are a single leaf.
+   */
+  struct Leaf {
+    std::string path;  ///< e.g. "x", "esc[2].esc_rpm" or "pose.position"
+    int offset;        ///< offset in the message in bytes
+    Field::BasicType type;
+    int size;   ///< size of a single element in bytes
+    int count;  ///< number of elements, 1 for non-array fields
+  };
+
   /**
    * Construct a messsage format from a raw message. This is used when parsing the header.
    * @param msg the raw message
@@ -583,6 +614,35 @@ class MessageFormat {
    */
   int sizeBytes() const;
 
+  /**
+   * @return true once resolveDefinition() succeeded
+   */
+  bool resolved() const { return _resolved; }
+
+  /**
+   * Flattened layout of all basic-type leaves, in message order. It is computed once in
+   * resolveDefinition(), and throws if the format is not resolved.
+   */
+  const std::vector<Leaf>& layout() const
+  {
+    if (!_resolved) {
+      throw UsageException("Message format not resolved: " + _name);
+    }
+    return _layout;
+  }
+
+  /**
+   * Hash of the name and the flattened layout, equal for equal resolved formats.
+   * Throws if the format is not resolved.
+   */
+  uint64_t contentHash() const
+  {
+    if (!_resolved) {
+      throw UsageException("Message format not resolved: " + _name);
+    }
+    return _content_hash;
+  }
+
   /**
    * @return the list of fields, in-order
    */
@@ -605,21 +665,41 @@ class MessageFormat {
    * @param name the name of the field
    * @return the requested field
    */
-  std::shared_ptr<Field> field(const std::string& name) const
+  const std::shared_ptr<Field>& field(std::string_view name) const
   {
-    const auto it = _fields.find(name);
-    if (it == _fields.end()) {
-      throw AccessException("Field not found: " + name);
+    const auto* field = _field_lookup.find(name);
+    if (!field) {
+      throw AccessException("Field not found: " + std::string(name));
     }
-    return it->second;
+    return *field;
+  }
+
+  /**
+   * Get a field by name, without throwing
+   * @return the requested field, or nullptr if it does not exist
+   */
+  std::shared_ptr<Field> findField(std::string_view name) const
+  {
+    const auto* field = _field_lookup.find(name);
+    return field ? *field : nullptr;
   }
 
  private:
+  void addField(std::shared_ptr<Field> field);
+  void flattenLayout() const;
+
   std::string _name;
   std::map<std::string, std::shared_ptr<Field>>
       _fields;  /// < map of fields, keyed by name, same fields as in the list
+  NameMap<std::shared_ptr<Field>> _field_lookup;  ///< hashed lookup, same fields as in the list
   std::vector<std::shared_ptr<Field>>
       _fields_ordered;  /// < list of fields, in-order, same fields as in the map
+
+  // Computed in resolveDefinition()
+  mutable bool _resolved{false};
+  mutable int _size_bytes{0};
+  mutable std::vector<Leaf> _layout;
+  mutable uint64_t _content_hash{0};
 };
 
 using Parameter = MessageInfo;
@@ -681,6 +761,11 @@ class Logging {
 
   Logging(Level level, std::string message, uint64_t timestamp);
 
+  /**
+   * Construct a tagged logging message (serialized as LOGGING_TAGGED)
+   */
+  Logging(Level level, std::string message, uint64_t timestamp, uint16_t tag);
+
   Level logLevel() const { return _log_level; }
   std::string logLevelStr() const;
   uint16_t tag() const { return _tag; }
@@ -689,6 +774,10 @@ class Logging {
   const std::string& message() const { return _message; }
 
   void serialize(const DataWriteCB& writer) const;
+  /**
+   * Serialize for gather-I/O: the message text is referenced, not copied
+   */
+  void serialize(SegmentBuffer& buffer) const;
 
   bool operator==(const Logging& logging) const
   {
@@ -698,6 +787,11 @@ class Logging {
   }
 
  private:
+  /**
+   * Serialize everything but the message text
+   */
+  void serializeHeader(const DataWriteCB& writer) const;
+
   Level _log_level{};
   uint16_t _tag{};
   bool _has_tag{false};
@@ -720,10 +814,19 @@ class Data {
   const std::vector<uint8_t>& data() const { return _data; }
 
   void serialize(const DataWriteCB& writer) const;
+  /**
+   * Serialize for gather-I/O: the payload is referenced, not copied
+   */
+  void serialize(SegmentBuffer& buffer) const;
 
   bool operator==(const Data& data) const { return _msg_id == data._msg_id && _data == data._data; }
 
  private:
+  /**
+   * Serialize everything but the payload
+   */
+  void serializeHeader(const DataWriteCB& writer) const;
+
   uint16_t _msg_id{};
   std::vector<uint8_t> _data;
 };
@@ -0,0 +1,123 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ulog_cpp {
+
+/**
+ * Hash map from names to values, for fast lookups by name. It uses open addressing with linear
+ * probing, stores the hash of each key, and supports lookups by std::string_view without
+ * constructing a std::string.
+ *
+ * Entries are kept in insertion order, and cannot be removed.
+ */
+template <typename T>
+class NameMap {
+ public:
+  using Entry = std::pair<std::string, T>;
+
+  static uint64_t hash(std::string_view name)
+  {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (const char c : name) {
+      h ^= static_cast<uint8_t>(c);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  /**
+   * Insert a value, unless the name exists already
+   * @return true if inserted
+   */
+  bool insert(std::string name, T value)
+  {
+    if ((_entries.size() + 1) * 2 > _slots.size()) {
+      rehash(_slots.empty() ? 16 : _slots.size() * 2);
+    }
+    const uint64_t name_hash = hash(name);
+    size_t slot = findSlot(name, name_hash);
+    if (_slots[slot].index != 0) {
+      return false;
+    }
+    _entries.emplace_back(std::move(name), std::move(value));
+    _slots[slot] = {name_hash, static_cast<uint32_t>(_entries.size())};
+    return true;
+  }
+
+  /**
+   * @return the value, or nullptr if not found
+   */
+  const T* find(std::string_view name) const { return find(name, hash(name)); }
+  T* find(std::string_view name) { return find(name, hash(name)); }
+
+  /**
+   * Lookup with a precomputed hash (@see hash())
+   */
+  const T* find(std::string_view name, uint64_t name_hash) const
+  {
+    if (_slots.empty()) {
+      return nullptr;
+    }
+    const Slot& slot = _slots[findSlot(name, name_hash)];
+    return slot.index == 0 ? nullptr : &_entries[slot.index - 1].second;
+  }
+  T* find(std::string_view name, uint64_t name_hash)
+  {
+    return const_cast<T*>(static_cast<const NameMap*>(this)->find(name, name_hash));
+  }
+
+  size_t size() const { return _entries.size(); }
+  bool empty() const { return _entries.empty(); }
+
+  typename std::vector<Entry>::const_iterator begin() const { return _entries.begin(); }
+  typename std::vector<Entry>::const_iterator end() const { return _entries.end(); }
+
+ private:
+  struct Slot {
+    uint64_t hash{0};
+    uint32_t index{0};  ///< 1-based index into _entries, 0 if empty
+  };
+
+  /**
+   * @return the slot containing name, or the empty slot where it would be inserted
+   */
+  size_t findSlot(std::string_view name, uint64_t name_hash) const
+  {
+    const size_t mask = _slots.size() - 1;
+    size_t slot = name_hash & mask;
+    while (_slots[slot].index != 0 &&
+           (_slots[slot].hash != name_hash || _entries[_slots[slot].index - 1].first != name)) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  void rehash(size_t num_slots)
+  {
+    _slots.assign(num_slots, Slot{});
+    const size_t mask = num_slots - 1;
+    for (size_t i = 0; i < _entries.size(); ++i) {
+      const uint64_t name_hash = hash(_entries[i].first);
+      size_t slot = name_hash & mask;
+      while (_slots[slot].index != 0) {
+        slot = (slot + 1) & mask;
+      }
+      _slots[slot] = {name_hash, static_cast<uint32_t>(i + 1)};
+    }
+  }
+
+  std::vector<Entry> _entries;
+  std::vector<Slot> _slots;  ///< size is 0 or a power of 2, at most half full
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,88 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "parameter_timeline.hpp"
+
+#include <algorithm>
+
+namespace ulog_cpp {
+
+ParameterTimeline::ParameterTimeline(const DataContainer& data_container)
+{
+  for (const auto& [name, parameter] : data_container.initialParameters()) {
+    add(parameter, 0);
+  }
+  const auto& changed_parameters = data_container.changedParameters();
+  const auto& timestamps = data_container.changedParameterTimestamps();
+  for (size_t i = 0; i < changed_parameters.size(); ++i) {
+    add(changed_parameters[i], i < timestamps.size() ? timestamps[i] : 0);
+  }
+  // Timestamps are taken from different subscriptions, which are not strictly ordered
+  for (auto& points : _points) {
+    std::stable_sort(points.begin(), points.end(), [](const Point& a, const Point& b) {
+      return a.timestamp < b.timestamp;
+    });
+  }
+}
+
+void ParameterTimeline::add(const Parameter& parameter, uint64_t timestamp)
+{
+  const Field& field = parameter.field();
+  const Field::BasicType type = field.type().type;
+  if (!field.definitionResolved() || field.arrayLength() != -1 ||
+      type == Field::BasicType::NESTED || type == Field::BasicType::CHAR) {
+    return;
+  }
+  ParameterValue value;
+  if (type == Field::BasicType::INT32) {
+    value = parameter.value().as<int32_t>();
+  } else {
+    value = parameter.value().as<float>();
+  }
+
+  auto id_iter = _ids.find(field.name());
+  if (id_iter == _ids.end()) {
+    id_iter = _ids.emplace(field.name(), static_cast<Id>(_names.size())).first;
+    _names.push_back(field.name());
+    _points.emplace_back();
+  }
+  _points[id_iter->second].push_back({timestamp, value});
+}
+
+ParameterTimeline::Id ParameterTimeline::id(const std::string& name) const
+{
+  const auto id_iter = _ids.find(name);
+  return id_iter == _ids.end() ? kInvalidId : id_iter->second;
+}
+
+const ParameterTimeline::Point* ParameterTimeline::find(Id id, uint64_t timestamp) const
+{
+  const auto& points = this->points(id);
+  const auto next = std::upper_bound(
+      points.begin(), points.end(), timestamp,
+      [](uint64_t t, const Point& point) { return t < point.timestamp; });
+  return next == points.begin() ? nullptr : &*(next - 1);
+}
+
+ParameterTimeline::ParameterValue ParameterTimeline::value(Id id, uint64_t timestamp) const
+{
+  const Point* point = find(id, timestamp);
+  if (!point) {
+    throw AccessException("No value for " + _names[id] + " at " + std::to_string(timestamp));
+  }
+  return point->value;
+}
+
+ParameterTimeline::ParameterValue ParameterTimeline::value(const std::string& name,
+                                                           uint64_t timestamp) const
+{
+  const Id parameter_id = id(name);
+  if (parameter_id == kInvalidId) {
+    throw AccessException("Parameter not found: " + name);
+  }
+  return value(parameter_id, timestamp);
+}
+
+}  // namespace ulog_cpp
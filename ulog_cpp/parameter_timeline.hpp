@@ -0,0 +1,89 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "data_container.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Per-parameter history of values, for lookups of a parameter value at a given time.
+ *
+ * Parameter names are interned to integer ids, so repeated lookups do not need string
+ * comparisons. Each parameter has a sorted array of (timestamp, value) points: the initial value
+ * at timestamp 0, followed by the changes at DataContainer::changedParameterTimestamps().
+ * Parameters of other types than int32_t or float are converted to float, non-numeric ones are
+ * skipped.
+ */
+class ParameterTimeline {
+ public:
+  using Id = uint32_t;
+  using ParameterValue = std::variant<int32_t, float>;
+
+  struct Point {
+    uint64_t timestamp;
+    ParameterValue value;
+  };
+
+  static constexpr Id kInvalidId = std::numeric_limits<Id>::max();
+
+  explicit ParameterTimeline(const DataContainer& data_container);
+
+  /**
+   * @return id of a parameter, or kInvalidId if it does not exist
+   */
+  Id id(const std::string& name) const;
+
+  const std::string& name(Id id) const
+  {
+    checkId(id);
+    return _names[id];
+  }
+
+  size_t numParameters() const { return _names.size(); }
+
+  /**
+   * @return all values of a parameter, ordered by timestamp
+   */
+  const std::vector<Point>& points(Id id) const
+  {
+    checkId(id);
+    return _points[id];
+  }
+
+  /**
+   * Get the value at a time, in O(log n)
+   * @return the last point with a timestamp <= timestamp, or nullptr if there is none
+   */
+  const Point* find(Id id, uint64_t timestamp) const;
+
+  /**
+   * Get the value at a time. Throws an AccessException() if there is no value.
+   */
+  ParameterValue value(Id id, uint64_t timestamp) const;
+  ParameterValue value(const std::string& name, uint64_t timestamp) const;
+
+ private:
+  void add(const Parameter& parameter, uint64_t timestamp);
+  void checkId(Id id) const
+  {
+    if (id >= _names.size()) {
+      throw AccessException("Invalid parameter id: " + std::to_string(id));
+    }
+  }
+
+  std::unordered_map<std::string, Id> _ids;
+  std::vector<std::string> _names;
+  std::vector<std::vector<Point>> _points;  ///< by id
+};
+
+}  // namespace ulog_cpp
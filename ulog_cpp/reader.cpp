@@ -5,6 +5,7 @@
 
 #include "reader.hpp"
 
+#include <cinttypes>
 #include <cstring>
 
 #include "raw_messages.hpp"
@@ -95,7 +96,7 @@ void Reader::readChunk(const uint8_t* data, int length)
             _partial_message_buffer_length_capacity = _partial_message_buffer_length + num_append;
             _partial_message_buffer = static_cast<uint8_t*>(
                 realloc(_partial_message_buffer, _partial_message_buffer_length_capacity));
-            DBG_PRINTF("%i: resized partial buffer to %i\n", _total_num_read,
+            DBG_PRINTF("%" PRIu64 ": resized partial buffer to %i\n", _total_num_read,
                        _partial_message_buffer_length_capacity);
           }
           memcpy(_partial_message_buffer + _partial_message_buffer_length, data, num_append);
@@ -111,10 +112,11 @@ void Reader::readChunk(const uint8_t* data, int length)
             reinterpret_cast<const ulog_message_header_s*>(_partial_message_buffer);
         if (ensure_enough_data_in_partial_buffer(header->msg_size + kULogHeaderLength)) {
           ulog_message = reinterpret_cast<const uint8_t*>(_partial_message_buffer);
+          _message_offset = _total_num_read - _partial_message_buffer_length;
           clear_from_partial_message_buffer = true;
         } else {
           // Not enough data yet (length == 0) or overflow
-          DBG_PRINTF("%i: not enough data (length=%i)\n", _total_num_read, length);
+          DBG_PRINTF("%" PRIu64 ": not enough data (length=%i)\n", _total_num_read, length);
         }
       }
 
@@ -128,6 +130,7 @@ void Reader::readChunk(const uint8_t* data, int length)
       }
       if (full_message_length > 0) {
         ulog_message = data;
+        _message_offset = _total_num_read;
         data += full_message_length;
         length -= full_message_length;
         _total_num_read += full_message_length;
@@ -146,7 +149,7 @@ void Reader::readChunk(const uint8_t* data, int length)
 
       // Check for corruption
       if (header->msg_size == 0 || header->msg_type == 0) {
-        DBG_PRINTF("%i: Invalid msg detected\n", _total_num_read);
+        DBG_PRINTF("%" PRIu64 ": Invalid msg detected\n", _total_num_read);
         corruptionDetected();
         // We'll exit the loop afterwards
       } else {
@@ -159,7 +162,7 @@ void Reader::readChunk(const uint8_t* data, int length)
             readDataMessage(ulog_message);
           }
         } catch (const ParsingException& exception) {
-          DBG_PRINTF("%i: parser exception: %s\n", _total_num_read, exception.what());
+          DBG_PRINTF("%" PRIu64 ": parser exception: %s\n", _total_num_read, exception.what());
           corruptionDetected();
         }
       }
@@ -221,15 +224,16 @@ void Reader::tryToRecover(const uint8_t* data, int length)
 
       if (found) {
         DBG_PRINTF(
-            "%i: recovered, recursive call (index = %i, length = %i, partial buf len = %i)\n",
+            "%" PRIu64
+            ": recovered, recursive call (index = %i, length = %i, partial buf len = %i)\n",
             _total_num_read, index, length, _partial_message_buffer_length);
         _need_recovery = false;
         readChunk(data, length);
 
         return;
       }
-      DBG_PRINTF("%i: no valid msg found (length = %i, partial buf len = %i)\n", _total_num_read,
-                 length, _partial_message_buffer_length);
+      DBG_PRINTF("%" PRIu64 ": no valid msg found (length = %i, partial buf len = %i)\n",
+                 _total_num_read, length, _partial_message_buffer_length);
     }
   }
 }
@@ -345,12 +349,13 @@ void Reader::readHeaderMessage(const uint8_t* message)
     case ULogMessageType::ADD_LOGGED_MSG:
     case ULogMessageType::LOGGING:
     case ULogMessageType::LOGGING_TAGGED:
-      DBG_PRINTF("%i: Header completed\n", _total_num_read);
+      DBG_PRINTF("%" PRIu64 ": Header completed\n", _total_num_read);
       _state = State::ReadData;
       _data_handler_interface->headerComplete();
+      _data_locations_only = _data_handler_interface->dataLocationsOnly();
       break;
     default:
-      DBG_PRINTF("%i: Unknown/unexpected message type in header: %i\n", _total_num_read,
+      DBG_PRINTF("%" PRIu64 ": Unknown/unexpected message type in header: %i\n", _total_num_read,
                  header->msg_size);
       break;
   }
@@ -382,7 +387,11 @@ void Reader::readDataMessage(const uint8_t* message)
       _data_handler_interface->logging(Logging{message, true});
       break;
     case ULogMessageType::DATA:
-      _data_handler_interface->data(Data{message});
+      if (_data_locations_only) {
+        _data_handler_interface->dataLocation(message, _message_offset);
+      } else {
+        _data_handler_interface->data(Data{message});
+      }
       break;
     case ULogMessageType::DROPOUT:
       _data_handler_interface->dropout(Dropout{message});
@@ -391,7 +400,7 @@ void Reader::readDataMessage(const uint8_t* message)
       _data_handler_interface->sync(Sync{message});
       break;
     default:
-      DBG_PRINTF("%i: Unknown/unexpected message type in data: %i\n", _total_num_read,
+      DBG_PRINTF("%" PRIu64 ": Unknown/unexpected message type in data: %i\n", _total_num_read,
                  header->msg_size);
       break;
   }
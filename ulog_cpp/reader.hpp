@@ -59,8 +59,10 @@ class Reader {
   bool _need_recovery{false};
   bool _corruption_reported{false};
 
-  int _total_num_read{};  ///< statistics, total number of bytes read (includes current partial
-                          ///< buffer data)
+  uint64_t _total_num_read{};  ///< statistics, total number of bytes read (includes current
+                               ///< partial buffer data)
+  uint64_t _message_offset{};  ///< stream offset of the message being parsed
+  bool _data_locations_only{false};
 
   ulog_file_header_s _file_header{};
 };
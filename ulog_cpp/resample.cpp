@@ -0,0 +1,318 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "resample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ulog_cpp {
+
+namespace {
+
+const Field& numericField(const Subscription& subscription, const std::string& field_name)
+{
+  const auto field = subscription.format()->findField(field_name);
+  if (!field || !field->definitionResolved()) {
+    throw AccessException("Field " + field_name + " not found in " +
+                          subscription.format()->name());
+  }
+  if (field->type().type == Field::BasicType::NESTED) {
+    throw UsageException("Field " + field_name + " is not numeric");
+  }
+  return *field;
+}
+
+template <typename T, typename OutputT>
+void extract(const std::vector<Data>& samples, int offset, OutputT* output)
+{
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const auto& data = samples[i].data();
+    if (data.size() < offset + sizeof(T)) {
+      throw ParsingException("Sample too short");
+    }
+    T value;
+    memcpy(&value, data.data() + offset, sizeof(T));
+    output[i] = static_cast<OutputT>(value);
+  }
+}
+
+/**
+ * Call fn(samples, index of the first sample) for all samples, block-wise for subscriptions that
+ * are decoded on access
+ */
+template <typename Fn>
+void forEachSampleBlock(const Subscription& subscription, const Fn& fn)
+{
+  if (!subscription.decodedOnAccess()) {
+    fn(subscription.rawSamples(), size_t{0});
+    return;
+  }
+  for (size_t first = 0; first < subscription.size();) {
+    const auto block = subscription.decodeBlock(first);
+    fn(block->samples, block->first);
+    first = block->first + block->samples.size();
+  }
+}
+
+void extractElement(const std::vector<Data>& samples, const ColumnElement& element, double* output)
+{
+  const int offset = element.offset;
+  switch (element.type) {
+    case Field::BasicType::INT8:
+      extract<int8_t>(samples, offset, output);
+      break;
+    case Field::BasicType::UINT8:
+      extract<uint8_t>(samples, offset, output);
+      break;
+    case Field::BasicType::INT16:
+      extract<int16_t>(samples, offset, output);
+      break;
+    case Field::BasicType::UINT16:
+      extract<uint16_t>(samples, offset, output);
+      break;
+    case Field::BasicType::INT32:
+      extract<int32_t>(samples, offset, output);
+      break;
+    case Field::BasicType::UINT32:
+      extract<uint32_t>(samples, offset, output);
+      break;
+    case Field::BasicType::INT64:
+      extract<int64_t>(samples, offset, output);
+      break;
+    case Field::BasicType::UINT64:
+      extract<uint64_t>(samples, offset, output);
+      break;
+    case Field::BasicType::FLOAT:
+      extract<float>(samples, offset, output);
+      break;
+    case Field::BasicType::DOUBLE:
+      extract<double>(samples, offset, output);
+      break;
+    case Field::BasicType::CHAR:
+      extract<char>(samples, offset, output);
+      break;
+    case Field::BasicType::BOOL:
+      extract<bool>(samples, offset, output);
+      break;
+    case Field::BasicType::NESTED:
+      throw UsageException("Field is not numeric");
+  }
+}
+
+bool withinGap(uint64_t distance, uint64_t max_gap_us)
+{
+  return max_gap_us == 0 || distance <= max_gap_us;
+}
+
+}  // namespace
+
+std::vector<uint64_t> timestampColumn(const Subscription& subscription,
+                                      const std::string& field_name)
+{
+  const Field& field = numericField(subscription, field_name);
+  if (field.type().type != Field::BasicType::UINT64 || field.arrayLength() != -1) {
+    throw UsageException("Field " + field_name + " is not of type uint64_t");
+  }
+  std::vector<uint64_t> ret(subscription.size());
+  forEachSampleBlock(subscription, [&](const std::vector<Data>& samples, size_t first) {
+    extract<uint64_t>(samples, field.offsetInMessage(), ret.data() + first);
+  });
+  return ret;
+}
+
+std::vector<double> column(const Subscription& subscription, const std::string& field_name,
+                           int array_index)
+{
+  const Field& field = numericField(subscription, field_name);
+  if (array_index < 0 || array_index >= std::max(field.arrayLength(), 1)) {
+    throw AccessException("Array index out of range: " + std::to_string(array_index));
+  }
+  const int offset = field.offsetInMessage() + array_index * field.type().size;
+  return std::move(columns(subscription, {{offset, field.type().type}}).front());
+}
+
+std::vector<std::vector<double>> columns(const Subscription& subscription,
+                                         const std::vector<ColumnElement>& elements)
+{
+  std::vector<std::vector<double>> ret(elements.size(),
+                                       std::vector<double>(subscription.size()));
+  forEachSampleBlock(subscription, [&](const std::vector<Data>& samples, size_t first) {
+    for (size_t i = 0; i < elements.size(); ++i) {
+      extractElement(samples, elements[i], ret[i].data() + first);
+    }
+  });
+  return ret;
+}
+
+std::vector<uint64_t> uniformTimestamps(uint64_t start, uint64_t end, double rate_hz)
+{
+  if (!(rate_hz > 0.)) {
+    throw UsageException("Invalid rate");
+  }
+  const double interval_us = 1e6 / rate_hz;
+  std::vector<uint64_t> ret;
+  if (end >= start) {
+    ret.reserve(static_cast<size_t>(static_cast<double>(end - start) / interval_us) + 1);
+  }
+  // Compute each timestamp from the start, to avoid accumulating rounding errors
+  for (uint64_t i = 0;; ++i) {
+    const uint64_t timestamp = start + std::llround(static_cast<double>(i) * interval_us);
+    if (timestamp > end) {
+      break;
+    }
+    ret.push_back(timestamp);
+  }
+  return ret;
+}
+
+ResampleIndex::ResampleIndex(const std::vector<uint64_t>& source_timestamps,
+                             const std::vector<uint64_t>& target_timestamps,
+                             const ResampleOptions& options)
+    : _source_size(source_timestamps.size()),
+      _linear(options.interpolation == Interpolation::Linear)
+{
+  if (_source_size > std::numeric_limits<uint32_t>::max()) {
+    throw UsageException("Too many source samples");
+  }
+  const size_t num_targets = target_timestamps.size();
+  _lower.resize(num_targets, 0);
+  _valid.resize(num_targets, 0);
+  if (_linear) {
+    _upper.resize(num_targets, 0);
+    _weight.resize(num_targets, 0.);
+  }
+  if (source_timestamps.empty()) {
+    return;
+  }
+
+  // Merge walk: 'next' is the first source sample after the target time
+  const uint64_t max_gap_us = options.max_gap_us;
+  size_t next = 0;
+  for (size_t i = 0; i < num_targets; ++i) {
+    const uint64_t target = target_timestamps[i];
+    while (next < _source_size && source_timestamps[next] <= target) {
+      ++next;
+    }
+    const bool has_previous = next > 0;
+    const bool has_next = next < _source_size;
+    const size_t previous = has_previous ? next - 1 : 0;
+
+    switch (options.interpolation) {
+      case Interpolation::ZeroOrderHold:
+        if (has_previous && target == source_timestamps[previous]) {
+          _valid[i] = 1;
+        } else if (has_previous) {
+          // Inside a gap, or after the last sample
+          const uint64_t interval =
+              (has_next ? source_timestamps[next] : target) - source_timestamps[previous];
+          _valid[i] = withinGap(interval, max_gap_us);
+        }
+        _lower[i] = static_cast<uint32_t>(previous);
+        break;
+
+      case Interpolation::Nearest: {
+        size_t nearest = previous;
+        uint64_t distance = has_previous ? target - source_timestamps[previous] : 0;
+        if (!has_previous || (has_next && source_timestamps[next] - target < distance)) {
+          nearest = next;
+          distance = source_timestamps[next] - target;
+        }
+        bool valid = withinGap(distance, max_gap_us);
+        if (has_previous && has_next && target != source_timestamps[previous]) {
+          valid = valid &&
+                  withinGap(source_timestamps[next] - source_timestamps[previous], max_gap_us);
+        }
+        _valid[i] = valid;
+        _lower[i] = static_cast<uint32_t>(nearest);
+        break;
+      }
+
+      case Interpolation::Linear:
+        if (has_previous && target == source_timestamps[previous]) {
+          _valid[i] = 1;
+          _lower[i] = _upper[i] = static_cast<uint32_t>(previous);
+        } else if (has_previous && has_next) {
+          const uint64_t interval = source_timestamps[next] - source_timestamps[previous];
+          _valid[i] = withinGap(interval, max_gap_us);
+          _lower[i] = static_cast<uint32_t>(previous);
+          _upper[i] = static_cast<uint32_t>(next);
+          _weight[i] = static_cast<double>(target - source_timestamps[previous]) /
+                       static_cast<double>(interval);
+        }
+        break;
+    }
+  }
+}
+
+void ResampleIndex::apply(const double* source_values, double* target_values) const
+{
+  const size_t num_targets = _lower.size();
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const uint32_t* lower = _lower.data();
+  const uint8_t* valid = _valid.data();
+  if (_source_size == 0) {
+    std::fill(target_values, target_values + num_targets, nan);
+    return;
+  }
+  if (_linear) {
+    const uint32_t* upper = _upper.data();
+    const double* weight = _weight.data();
+    for (size_t i = 0; i < num_targets; ++i) {
+      const double a = source_values[lower[i]];
+      const double b = source_values[upper[i]];
+      const double value = a + (b - a) * weight[i];
+      // Exact for weight 0, also for non-finite values
+      target_values[i] = valid[i] ? (weight[i] == 0. ? a : value) : nan;
+    }
+  } else {
+    for (size_t i = 0; i < num_targets; ++i) {
+      target_values[i] = valid[i] ? source_values[lower[i]] : nan;
+    }
+  }
+}
+
+std::vector<double> ResampleIndex::apply(const std::vector<double>& source_values) const
+{
+  if (source_values.size() != _source_size) {
+    throw UsageException("Number of source values does not match the timestamps");
+  }
+  std::vector<double> ret(size());
+  apply(source_values.data(), ret.data());
+  return ret;
+}
+
+Resampler::Resampler(std::vector<uint64_t> timestamps, ResampleOptions options)
+    : _timestamps(std::move(timestamps)), _options(std::move(options))
+{
+}
+
+const ResampleIndex& Resampler::index(const std::shared_ptr<Subscription>& subscription)
+{
+  if (!subscription) {
+    throw AccessException("Invalid subscription");
+  }
+  auto index_iter = _indices.find(subscription);
+  if (index_iter == _indices.end()) {
+    index_iter =
+        _indices
+            .emplace(subscription,
+                     ResampleIndex(timestampColumn(*subscription, _options.timestamp_field),
+                                   _timestamps, _options))
+            .first;
+  }
+  return index_iter->second;
+}
+
+std::vector<double> Resampler::resample(const std::shared_ptr<Subscription>& subscription,
+                                        const std::string& field_name, int array_index)
+{
+  const ResampleIndex& resample_index = index(subscription);
+  return resample_index.apply(column(*subscription, field_name, array_index));
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,131 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "subscription.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Extract a uint64_t field of all samples (e.g. the timestamps)
+ */
+std::vector<uint64_t> timestampColumn(const Subscription& subscription,
+                                      const std::string& field_name = "timestamp");
+
+/**
+ * Extract a numeric field of all samples, converted to double. This reads the samples directly,
+ * without going through Value.
+ * @param array_index element index for array fields
+ */
+std::vector<double> column(const Subscription& subscription, const std::string& field_name,
+                           int array_index = 0);
+
+/**
+ * Numeric element of a message, e.g. from MessageFormat::layout()
+ */
+struct ColumnElement {
+  int offset;  ///< byte offset in the message
+  Field::BasicType type;
+};
+
+/**
+ * Extract numeric elements of all samples in a single pass, converted to double. Lazy, spilled
+ * and compressed subscriptions are read block-wise (@see Subscription::decodeBlock()) instead of
+ * decoding all samples. The timestamp and field extraction above work the same way.
+ * @return one column per element
+ */
+std::vector<std::vector<double>> columns(const Subscription& subscription,
+                                         const std::vector<ColumnElement>& elements);
+
+/**
+ * @return timestamps from start to end (inclusive) at a fixed rate
+ */
+std::vector<uint64_t> uniformTimestamps(uint64_t start, uint64_t end, double rate_hz);
+
+enum class Interpolation {
+  ZeroOrderHold,  ///< last sample at or before the target time
+  Linear,         ///< linear between the neighboring samples (no extrapolation)
+  Nearest,        ///< closest sample (the earlier one on ties)
+};
+
+struct ResampleOptions {
+  Interpolation interpolation{Interpolation::Linear};
+  /**
+   * Source samples further apart than this [us] are treated as a dropout: target times inside the
+   * gap, or further than this before the first/after the last sample, get no value (NaN).
+   * 0 to disable.
+   */
+  uint64_t max_gap_us{0};
+  std::string timestamp_field{"timestamp"};
+};
+
+/**
+ * Precomputed mapping from source samples to target timestamps. It only depends on the
+ * timestamps, so it can be computed once per subscription and applied to any number of its fields.
+ * Target times without a value (@see ResampleOptions) result in NaN.
+ *
+ * Both timestamp arrays must be sorted. Applying is a branch-free loop over the targets (gather
+ * and blend), which compilers can vectorize.
+ */
+class ResampleIndex {
+ public:
+  ResampleIndex(const std::vector<uint64_t>& source_timestamps,
+                const std::vector<uint64_t>& target_timestamps, const ResampleOptions& options);
+
+  /**
+   * @param source_values one value per source timestamp
+   * @param target_values output, one value per target timestamp
+   */
+  void apply(const double* source_values, double* target_values) const;
+
+  std::vector<double> apply(const std::vector<double>& source_values) const;
+
+  size_t sourceSize() const { return _source_size; }
+  size_t size() const { return _lower.size(); }
+
+ private:
+  size_t _source_size;
+  bool _linear;
+  /**
+   * Source indices per target. For ZeroOrderHold/Nearest, only _lower is used. Invalid targets
+   * point to index 0 and are masked.
+   */
+  std::vector<uint32_t> _lower;
+  std::vector<uint32_t> _upper;
+  std::vector<double> _weight;  ///< of _upper, for Linear
+  std::vector<uint8_t> _valid;
+};
+
+/**
+ * Aligns fields of multiple subscriptions to a common time base, e.g.:
+ *   Resampler resampler(uniformTimestamps(start, end, 250.), {Interpolation::Linear});
+ *   auto roll_rate = resampler.resample(angular_velocity, "xyz", 0);
+ *   auto roll_rate_sp = resampler.resample(rates_setpoint, "roll");
+ * The timestamps and ResampleIndex are computed once per subscription.
+ */
+class Resampler {
+ public:
+  Resampler(std::vector<uint64_t> timestamps, ResampleOptions options);
+
+  std::vector<double> resample(const std::shared_ptr<Subscription>& subscription,
+                               const std::string& field_name, int array_index = 0);
+
+  const ResampleIndex& index(const std::shared_ptr<Subscription>& subscription);
+
+  const std::vector<uint64_t>& timestamps() const { return _timestamps; }
+
+ private:
+  const std::vector<uint64_t> _timestamps;
+  const ResampleOptions _options;
+  std::map<std::shared_ptr<Subscription>, ResampleIndex> _indices;
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,74 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "segment_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ulog_cpp {
+
+SegmentBuffer::SegmentBuffer(int reference_threshold)
+    : _reference_threshold(std::max(reference_threshold, 0))
+{
+}
+
+void SegmentBuffer::copy(const uint8_t* data, int length)
+{
+  if (length <= 0) {
+    return;
+  }
+  const size_t offset = _arena.size();
+  _arena.insert(_arena.end(), data, data + length);
+  _size += length;
+  // Merge with the previous segment if it ends at the same arena position
+  if (!_segments.empty()) {
+    Segment& last = _segments.back();
+    if (!last.data && last.offset + last.length == offset) {
+      last.length += length;
+      return;
+    }
+  }
+  _segments.push_back({nullptr, offset, static_cast<size_t>(length)});
+}
+
+void SegmentBuffer::reference(const uint8_t* data, int length)
+{
+  if (length <= 0) {
+    return;
+  }
+  if (static_cast<size_t>(length) < _reference_threshold) {
+    copy(data, length);
+    return;
+  }
+  _segments.push_back({data, 0, static_cast<size_t>(length)});
+  _size += length;
+}
+
+void SegmentBuffer::forEachSegment(const std::function<void(const WriteSegment&)>& cb) const
+{
+  for (const auto& segment : _segments) {
+    cb(resolve(segment));
+  }
+}
+
+std::vector<WriteSegment> SegmentBuffer::segments() const
+{
+  std::vector<WriteSegment> segments;
+  segments.reserve(_segments.size());
+  for (const auto& segment : _segments) {
+    segments.push_back(resolve(segment));
+  }
+  return segments;
+}
+
+void SegmentBuffer::clear()
+{
+  _arena.clear();
+  _segments.clear();
+  _size = 0;
+}
+
+}  // namespace ulog_cpp
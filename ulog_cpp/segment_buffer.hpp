@@ -0,0 +1,92 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+struct WriteSegment {
+  const uint8_t* data;
+  size_t length;
+};
+
+/**
+ * Collects serialized messages as a list of segments for gather-I/O (e.g. by passing segments()
+ * to writev), instead of copying them into a contiguous buffer. Small parts (message headers,
+ * keys) are copied into an internal arena, while large payloads are only referenced.
+ *
+ * Referenced data must stay valid and unchanged until the buffer is written out and cleared. For
+ * serialize(SegmentBuffer&), this means the serialized message objects must outlive the buffer
+ * contents.
+ */
+class SegmentBuffer {
+ public:
+  /**
+   * @param reference_threshold payloads of at least this size [bytes] are referenced, smaller
+   * ones are copied
+   */
+  explicit SegmentBuffer(int reference_threshold = 128);
+
+  /**
+   * Append a copy of data
+   */
+  void copy(const uint8_t* data, int length);
+
+  /**
+   * Append data by reference (or copy it if it is smaller than the reference threshold)
+   */
+  void reference(const uint8_t* data, int length);
+
+  /**
+   * @return callback that copies, for messages without a serialize(SegmentBuffer&) overload
+   */
+  DataWriteCB copyCallback()
+  {
+    return [this](const uint8_t* data, int length) { copy(data, length); };
+  }
+
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  int numSegments() const { return static_cast<int>(_segments.size()); }
+
+  /**
+   * Call cb for every segment, in order
+   */
+  void forEachSegment(const std::function<void(const WriteSegment&)>& cb) const;
+
+  /**
+   * Get the segments. The pointers are valid until the next modification of the buffer.
+   */
+  std::vector<WriteSegment> segments() const;
+
+  /**
+   * Remove all segments, keeping the allocated memory
+   */
+  void clear();
+
+ private:
+  struct Segment {
+    const uint8_t* data;  ///< nullptr for segments in the arena
+    size_t offset;        ///< offset in the arena
+    size_t length;
+  };
+  WriteSegment resolve(const Segment& segment) const
+  {
+    return {segment.data ? segment.data : _arena.data() + segment.offset, segment.length};
+  }
+
+  const size_t _reference_threshold;
+  std::vector<uint8_t> _arena;
+  std::vector<Segment> _segments;
+  size_t _size{0};
+};
+
+}  // namespace ulog_cpp
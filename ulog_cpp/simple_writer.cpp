@@ -5,14 +5,10 @@
 
 #include "simple_writer.hpp"
 
-#ifdef _WIN32
-// clang-format off
-#include <windows.h>
-#include <fileapi.h>
-// clang-format on
-#else
-#include <unistd.h>
-#endif
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
 
 namespace ulog_cpp {
 
@@ -21,30 +17,102 @@ const std::regex SimpleWriter::kFormatNameRegex = std::regex(std::string(kFormat
 const std::string SimpleWriter::kFieldNameRegexStr = "[a-z0-9_]+";
 const std::regex SimpleWriter::kFieldNameRegex = std::regex(std::string(kFieldNameRegexStr));
 
-SimpleWriter::SimpleWriter(DataWriteCB data_write_cb, uint64_t timestamp_us)
-    : _writer(std::make_unique<Writer>(std::move(data_write_cb)))
+SimpleWriter::SimpleWriter(DataWriteCB data_write_cb, uint64_t timestamp_us, int buffer_size)
+    : _writer(std::make_unique<Writer>(std::move(data_write_cb), buffer_size))
 {
   _writer->fileHeader(FileHeader(timestamp_us));
 }
 
-SimpleWriter::SimpleWriter(const std::string& filename, uint64_t timestamp_us)
+SimpleWriter::SimpleWriter(const std::string& filename, uint64_t timestamp_us, int buffer_size)
+    : SimpleWriter(std::make_unique<StdioFileSink>(filename), timestamp_us, buffer_size)
 {
-  _file = std::fopen(filename.c_str(), "wb");
-  if (!_file) {
-    throw ParsingException("Failed to open file");
+}
+
+SimpleWriter::SimpleWriter(std::unique_ptr<FileSink> file_sink, uint64_t timestamp_us,
+                           int buffer_size)
+    : _file_sink(std::move(file_sink))
+{
+  if (!_file_sink) {
+    throw UsageException("Invalid FileSink");
   }
+  _writer = createFileWriter(buffer_size);
+  _writer->fileHeader(FileHeader(timestamp_us));
+}
+
+SimpleWriter::SimpleWriter(FileSinkFactory file_sink_factory, const RotationPolicy& rotation_policy,
+                           uint64_t timestamp_us, int buffer_size)
+    : SimpleWriter(file_sink_factory ? file_sink_factory(0) : nullptr, timestamp_us, buffer_size)
+{
+  _file_sink_factory = std::move(file_sink_factory);
+  _rotation_policy = rotation_policy;
+  _buffer_size = buffer_size;
+  _rotation_enabled = true;
+}
 
+SimpleWriter::SimpleWriter(std::shared_ptr<AsyncWriter> async_writer, uint64_t timestamp_us)
+    : _async_writer(std::move(async_writer))
+{
+  if (!_async_writer) {
+    throw UsageException("Invalid AsyncWriter");
+  }
   _writer = std::make_unique<Writer>(
-      [this](const uint8_t* data, int length) { std::fwrite(data, 1, length, _file); });
+      [async_writer = _async_writer.get()](const uint8_t* data, int length) {
+        async_writer->write(data, length);
+      });
   _writer->fileHeader(FileHeader(timestamp_us));
 }
 
 SimpleWriter::~SimpleWriter()
 {
-  _writer.reset();
-  if (_file) {
-    std::fclose(_file);
+  if (_multi_producer) {
+    try {
+      flushStagingBuffers();
+    } catch (...) {
+    }
+  }
+  try {
+    if (_write_sync_index && _header_complete) {
+      _writer->writeSyncIndex();
+    }
+    _writer.reset();
+    if (_file_sink) {
+      _file_sink->close();
+    }
+  } catch (...) {
   }
+  try {
+    if (_closed_file_sink.valid()) {
+      _closed_file_sink.get();
+    }
+    if (_next_file_sink.valid()) {
+      // Opened ahead of time but not used
+      auto next_file_sink = _next_file_sink.get();
+      if (next_file_sink) {
+        next_file_sink->discard();
+      }
+    }
+  } catch (...) {
+  }
+}
+
+std::unique_ptr<Writer> SimpleWriter::createFileWriter(int buffer_size)
+{
+  return std::make_unique<Writer>(
+      [file_sink = _file_sink.get()](const uint8_t* data, int length) {
+        file_sink->write(data, length);
+      },
+      buffer_size);
+}
+
+void SimpleWriter::replaceByName(std::vector<MessageInfo>& infos, const MessageInfo& info)
+{
+  for (auto& existing_info : infos) {
+    if (existing_info.field().name() == info.field().name()) {
+      existing_info = info;
+      return;
+    }
+  }
+  infos.push_back(info);
 }
 
 void SimpleWriter::writeMessageFormat(const std::string& name, const std::vector<Field>& fields)
@@ -57,9 +125,6 @@ void SimpleWriter::writeMessageFormat(const std::string& name, const std::vector
       fields[0].type().type != Field::BasicType::UINT64 || fields[0].arrayLength() != -1) {
     throw UsageException("First message field must be 'uint64_t timestamp'");
   }
-  if (_formats.find(name) != _formats.end()) {
-    throw UsageException("Duplicate format: " + name);
-  }
 
   // Validate naming pattern
   if (!std::regex_match(name, kFormatNameRegex)) {
@@ -75,22 +140,39 @@ void SimpleWriter::writeMessageFormat(const std::string& name, const std::vector
   // Check field types and verify padding
   unsigned message_size = 0;
   for (const auto& field : fields) {
-    const auto& basic_type_iter = Field::kBasicTypes.find(field.type().name);
-    if (basic_type_iter == Field::kBasicTypes.end()) {
+    const Field::TypeAttributes* basic_type = Field::findBasicType(field.type().name);
+    if (!basic_type) {
       throw UsageException("Invalid field type (nested formats are not supported): " +
                            field.type().name);
     }
     const int array_size = field.arrayLength() <= 0 ? 1 : field.arrayLength();
-    if (message_size % basic_type_iter->second.size != 0) {
+    if (message_size % basic_type->size != 0) {
       throw UsageException(
           "struct requires padding, reorder fields by decreasing type size. Padding before "
           "field: " +
           field.name());
     }
-    message_size += array_size * basic_type_iter->second.size;
+    message_size += array_size * basic_type->size;
+  }
+  addMessageFormat(name, fields, message_size);
+}
+
+void SimpleWriter::addMessageFormat(const std::string& name, const std::vector<Field>& fields,
+                                    unsigned message_size)
+{
+  if (_header_complete) {
+    throw UsageException("Header already complete");
+  }
+  if (_formats.find(name) != _formats.end()) {
+    throw UsageException("Duplicate format: " + name);
   }
   _formats[name] = Format{message_size};
-  _writer->messageFormat(MessageFormat(name, fields));
+  const auto lock = lockWriter();
+  const MessageFormat message_format(name, fields);
+  _writer->messageFormat(message_format);
+  if (_rotation_enabled) {
+    _header_formats.push_back(message_format);
+  }
 }
 
 void SimpleWriter::headerComplete()
@@ -98,6 +180,7 @@ void SimpleWriter::headerComplete()
   if (_header_complete) {
     throw UsageException("Header already complete");
   }
+  const auto lock = lockWriter();
   _writer->headerComplete();
   _header_complete = true;
 }
@@ -108,18 +191,22 @@ void SimpleWriter::writeTextMessage(Logging::Level level, const std::string& mes
   if (!_header_complete) {
     throw UsageException("Header not yet complete");
   }
+  const auto lock = lockWriter();
   _writer->logging({level, message, timestamp});
 }
 
 void SimpleWriter::fsync()
 {
-  if (_file) {
-    fflush(_file);
-#ifdef _WIN32
-    FlushFileBuffers(reinterpret_cast<HANDLE>(static_cast<uintptr_t>(_fileno(_file))));
-#else
-    ::fsync(fileno(_file));
-#endif
+  if (_multi_producer) {
+    flushStagingBuffers();
+  }
+  const auto lock = lockWriter();
+  _writer->flush();
+  if (_async_writer) {
+    _async_writer->sync();
+  }
+  if (_file_sink) {
+    _file_sink->sync();
   }
 }
 uint16_t SimpleWriter::writeAddLoggedMessage(const std::string& message_format_name,
@@ -128,13 +215,18 @@ uint16_t SimpleWriter::writeAddLoggedMessage(const std::string& message_format_n
   if (!_header_complete) {
     throw UsageException("Header not yet complete");
   }
+  const auto lock = lockWriter();
   const uint16_t msg_id = _subscriptions.size();
   auto format_iter = _formats.find(message_format_name);
   if (format_iter == _formats.end()) {
     throw UsageException("Format not found: " + message_format_name);
   }
   _subscriptions.push_back({format_iter->second.message_size});
-  _writer->addLoggedMessage(AddLoggedMessage(multi_id, msg_id, message_format_name));
+  const AddLoggedMessage add_logged_message(multi_id, msg_id, message_format_name);
+  _writer->addLoggedMessage(add_logged_message);
+  if (_rotation_enabled) {
+    _add_logged_messages.push_back(add_logged_message);
+  }
   return msg_id;
 }
 
@@ -143,6 +235,10 @@ void SimpleWriter::writeDataImpl(uint16_t id, const uint8_t* data, unsigned leng
   if (!_header_complete) {
     throw UsageException("Header not yet complete");
   }
+  if (_multi_producer) {
+    writeDataMultiProducer(id, data, length);
+    return;
+  }
   if (id >= _subscriptions.size()) {
     throw UsageException("Invalid ID");
   }
@@ -151,10 +247,223 @@ void SimpleWriter::writeDataImpl(uint16_t id, const uint8_t* data, unsigned leng
   if (length < expected_size) {
     throw UsageException("sizeof(data) is too small");
   }
-  std::vector<uint8_t> data_vec;
-  data_vec.resize(expected_size);
-  memcpy(data_vec.data(), data, expected_size);
-  _writer->data(Data(id, std::move(data_vec)));
+  if (_async_writer) {
+    _async_writer->writeData(id, data, static_cast<int>(expected_size));
+  } else {
+    _writer->data(id, data, static_cast<int>(expected_size));
+    if (_rotation_enabled) {
+      uint64_t timestamp;
+      memcpy(&timestamp, data, sizeof(timestamp));
+      rotateIfDue(timestamp);
+    }
+  }
+}
+
+void SimpleWriter::enableMultiProducer(int staging_buffer_size)
+{
+  static std::atomic<uint64_t> next_instance_id{1};
+  if (_multi_producer) {
+    throw UsageException("Multi-producer mode already enabled");
+  }
+  _instance_id = next_instance_id++;
+  _staging_buffer_size = std::max(staging_buffer_size, 1);
+  _multi_producer = true;
+}
+
+void SimpleWriter::setSyncPolicy(const SyncPolicy& sync_policy)
+{
+  if (_async_writer) {
+    throw UsageException("Sync policy is not supported with an AsyncWriter");
+  }
+  const auto lock = lockWriter();
+  _writer->setSyncPolicy(sync_policy);
+  _sync_policy = sync_policy;
+  _write_sync_index = sync_policy.record_offsets;
+}
+
+SimpleWriter::StagingBuffer& SimpleWriter::stagingBuffer()
+{
+  // Cache the last lookup per thread, so the map (and its mutex) is only accessed once per thread
+  struct CacheEntry {
+    uint64_t instance_id{0};
+    StagingBuffer* staging_buffer{nullptr};
+  };
+  thread_local CacheEntry cache;
+  if (cache.instance_id == _instance_id) {
+    return *cache.staging_buffer;
+  }
+  const std::lock_guard<std::mutex> lock(_staging_buffers_mutex);
+  auto& staging_buffer = _staging_buffers[std::this_thread::get_id()];
+  if (!staging_buffer) {
+    staging_buffer = std::make_unique<StagingBuffer>();
+    staging_buffer->data.reserve(_staging_buffer_size + 1024);
+  }
+  cache.instance_id = _instance_id;
+  cache.staging_buffer = staging_buffer.get();
+  return *staging_buffer;
+}
+
+void SimpleWriter::writeDataMultiProducer(uint16_t id, const uint8_t* data, unsigned length)
+{
+  StagingBuffer& staging_buffer = stagingBuffer();
+  const std::lock_guard<std::mutex> lock(staging_buffer.mutex);
+  if (id >= staging_buffer.message_sizes.size()) {
+    const std::lock_guard<std::mutex> write_lock(_write_mutex);
+    staging_buffer.message_sizes.clear();
+    for (const auto& subscription : _subscriptions) {
+      staging_buffer.message_sizes.push_back(subscription.message_size);
+    }
+    if (id >= staging_buffer.message_sizes.size()) {
+      throw UsageException("Invalid ID");
+    }
+  }
+  const unsigned expected_size = staging_buffer.message_sizes[id];
+  // Sanity check data size. sizeof(data) can be bigger because of struct padding at the end
+  if (length < expected_size) {
+    throw UsageException("sizeof(data) is too small");
+  }
+  if (expected_size + 2 > std::numeric_limits<uint16_t>::max()) {
+    throw ParsingException("message too long");
+  }
+
+  ulog_message_data_s data_msg;
+  data_msg.msg_id = id;
+  data_msg.msg_size = expected_size + 2;
+  const size_t header_size = ULOG_MSG_HEADER_LEN + 2;
+  std::vector<uint8_t>& buffer = staging_buffer.data;
+  const size_t offset = buffer.size();
+  buffer.resize(offset + header_size + expected_size);
+  memcpy(buffer.data() + offset, &data_msg, header_size);
+  memcpy(buffer.data() + offset + header_size, data, expected_size);
+  ++staging_buffer.num_messages;
+  if (_rotation_enabled) {
+    memcpy(&staging_buffer.last_timestamp, data, sizeof(staging_buffer.last_timestamp));
+  }
+
+  if (buffer.size() >= _staging_buffer_size) {
+    flushStagingBuffer(staging_buffer);
+  }
+}
+
+void SimpleWriter::flushStagingBuffer(StagingBuffer& staging_buffer)
+{
+  if (staging_buffer.data.empty()) {
+    return;
+  }
+  const std::lock_guard<std::mutex> lock(_write_mutex);
+  std::vector<uint8_t>& data = staging_buffer.data;
+  const int num_messages = staging_buffer.num_messages;
+  staging_buffer.num_messages = 0;
+  try {
+    if (_async_writer) {
+      // Data-only block, can be dropped
+      _async_writer->tryWrite(data.data(), static_cast<int>(data.size()), num_messages);
+    } else {
+      _writer->serializedMessages(data.data(), static_cast<int>(data.size()));
+      if (_rotation_enabled) {
+        rotateIfDue(staging_buffer.last_timestamp);
+      }
+    }
+  } catch (...) {
+    data.clear();
+    throw;
+  }
+  data.clear();
+}
+
+void SimpleWriter::flushStagingBuffers()
+{
+  const std::lock_guard<std::mutex> lock(_staging_buffers_mutex);
+  for (auto& staging_buffer : _staging_buffers) {
+    const std::lock_guard<std::mutex> staging_lock(staging_buffer.second->mutex);
+    flushStagingBuffer(*staging_buffer.second);
+  }
+}
+
+void SimpleWriter::rotateIfDue(uint64_t timestamp)
+{
+  if (!_has_file_start_timestamp) {
+    _file_start_timestamp = timestamp;
+    _has_file_start_timestamp = true;
+  }
+  const uint64_t file_size = _writer->position();
+  const uint64_t duration =
+      timestamp > _file_start_timestamp ? timestamp - _file_start_timestamp : 0;
+  const uint64_t max_size = _rotation_policy.max_file_size;
+  const uint64_t max_duration = _rotation_policy.max_duration_us;
+
+  // Open the next file once half-way
+  if (!_next_file_sink.valid() && ((max_size > 0 && file_size >= max_size / 2) ||
+                                   (max_duration > 0 && duration >= max_duration / 2))) {
+    openNextFileSink();
+  }
+  if ((max_size > 0 && file_size >= max_size) || (max_duration > 0 && duration >= max_duration)) {
+    rotate(timestamp);
+  }
+}
+
+void SimpleWriter::openNextFileSink()
+{
+  _next_file_sink = std::async(std::launch::async, _file_sink_factory, _file_index + 1);
+}
+
+void SimpleWriter::rotate(uint64_t timestamp)
+{
+  if (!_next_file_sink.valid()) {
+    openNextFileSink();
+  }
+  std::unique_ptr<FileSink> next_file_sink = _next_file_sink.get();
+  if (!next_file_sink) {
+    throw UsageException("Invalid FileSink");
+  }
+  ++_file_index;
+
+  if (_write_sync_index) {
+    _writer->writeSyncIndex();
+  }
+  _writer->flush();
+  _writer.reset();
+
+  // Closing might have to sync, so do it in the background. Errors of the previous close are
+  // reported here.
+  if (_closed_file_sink.valid()) {
+    _closed_file_sink.get();
+  }
+  _closed_file_sink = std::async(std::launch::async,
+                                 [file_sink = std::move(_file_sink)]() { file_sink->close(); });
+  _file_sink = std::move(next_file_sink);
+
+  // Replay the header
+  _writer = createFileWriter(_buffer_size);
+  _writer->fileHeader(FileHeader(timestamp));
+  for (const auto& info : _header_infos) {
+    _writer->messageInfo(info);
+  }
+  for (const auto& message_format : _header_formats) {
+    _writer->messageFormat(message_format);
+  }
+  for (const auto& parameter : _header_parameters) {
+    _writer->parameter(parameter);
+  }
+  _writer->headerComplete();
+  for (const auto& add_logged_message : _add_logged_messages) {
+    _writer->addLoggedMessage(add_logged_message);
+  }
+  _writer->setSyncPolicy(_sync_policy);
+  _has_file_start_timestamp = false;
+}
+
+std::unique_lock<std::mutex> SimpleWriter::lockWriter()
+{
+  if (!_multi_producer) {
+    return std::unique_lock<std::mutex>(_write_mutex, std::defer_lock);
+  }
+  StagingBuffer& staging_buffer = stagingBuffer();
+  {
+    const std::lock_guard<std::mutex> lock(staging_buffer.mutex);
+    flushStagingBuffer(staging_buffer);
+  }
+  return std::unique_lock<std::mutex>(_write_mutex);
 }
 
 }  // namespace ulog_cpp
@@ -5,36 +5,112 @@
 #pragma once
 
 #include <cstdio>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <regex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "async_writer.hpp"
+#include "file_sink.hpp"
+#include "message_traits.hpp"
 #include "writer.hpp"
 
 namespace ulog_cpp {
 
+/**
+ * Thresholds for starting a new file (@see SimpleWriter). A file is rotated after the data message
+ * that reaches one of them.
+ */
+struct RotationPolicy {
+  uint64_t max_file_size{0};    ///< maximum file size [bytes] (approximate), 0 to disable
+  uint64_t max_duration_us{0};  ///< maximum log time per file [us] (data timestamps), 0 to disable
+};
+
+/**
+ * Creates the output file with the given index (0 for the first file)
+ */
+using FileSinkFactory = std::function<std::unique_ptr<FileSink>(int file_index)>;
+
 /**
  * ULog serialization class which checks for integrity and correct calling order.
  * It throws an UsageException() in case of a failed integrity check.
  */
 class SimpleWriter {
  public:
+  static constexpr int kDefaultFileBufferSize = 64 * 1024;
+  static constexpr int kDefaultStagingBufferSize = 16 * 1024;
+
   /**
    * Constructor with a callback for writing data.
    * @param data_write_cb callback for serialized ULog data
    * @param timestamp_us start timestamp [us]
+   * @param buffer_size coalesce messages and call data_write_cb with blocks of at least this
+   * size [bytes] (@see Writer). 0 to disable buffering.
    */
-  explicit SimpleWriter(DataWriteCB data_write_cb, uint64_t timestamp_us);
+  explicit SimpleWriter(DataWriteCB data_write_cb, uint64_t timestamp_us, int buffer_size = 0);
   /**
    * Constructor to write to a file.
    * @param filename ULog file to write to (will be overwritten if it exists)
    * @param timestamp_us  start timestamp [us]
+   * @param buffer_size size of the write buffer [bytes], 0 to disable buffering
    */
-  explicit SimpleWriter(const std::string& filename, uint64_t timestamp_us);
+  explicit SimpleWriter(const std::string& filename, uint64_t timestamp_us,
+                        int buffer_size = kDefaultFileBufferSize);
+  /**
+   * Constructor to write to a file sink, e.g. a PreallocatedFileSink.
+   * @param file_sink output file, closed on destruction
+   * @param timestamp_us start timestamp [us]
+   * @param buffer_size size of the write buffer [bytes], 0 to disable buffering
+   */
+  explicit SimpleWriter(std::unique_ptr<FileSink> file_sink, uint64_t timestamp_us,
+                        int buffer_size = 0);
+  /**
+   * Constructor for asynchronous writing: all I/O happens on the AsyncWriter thread. writeData()
+   * never blocks, data is dropped instead if the AsyncWriter buffer is full (@see AsyncWriter).
+   * @param async_writer output stage (only this SimpleWriter may write to it)
+   * @param timestamp_us start timestamp [us]
+   */
+  explicit SimpleWriter(std::shared_ptr<AsyncWriter> async_writer, uint64_t timestamp_us);
+  /**
+   * Constructor for writing to a sequence of files, rotated according to rotation_policy.
+   * Each new file repeats the header: info messages, message formats, the current parameter values
+   * and all AddLoggedMessage's, so msg_ids stay valid. The next file is opened in the background
+   * ahead of time, and the previous one is closed in the background, so the switch only costs the
+   * header serialization. The factory can be called for one more file than is used, which is
+   * discarded on destruction (@see FileSink::discard()).
+   * @param file_sink_factory creates the output files
+   * @param rotation_policy when to start a new file
+   * @param timestamp_us start timestamp [us]
+   * @param buffer_size size of the write buffer [bytes], 0 to disable buffering
+   */
+  SimpleWriter(FileSinkFactory file_sink_factory, const RotationPolicy& rotation_policy,
+               uint64_t timestamp_us, int buffer_size = kDefaultFileBufferSize);
 
   ~SimpleWriter();
 
+  /**
+   * Allow all methods, in particular writeData(), to be called concurrently from multiple threads.
+   * Each thread serializes its data messages into its own staging buffer, which is appended to
+   * the log as a whole once it reaches staging_buffer_size (or on fsync()). So producers only
+   * contend on a lock once per block.
+   *
+   * Message order is only preserved within a thread, so each time-series (id) must be written
+   * from a single thread. Must be called before writing from multiple threads.
+   * @param staging_buffer_size per-thread staging buffer size [bytes]
+   */
+  void enableMultiProducer(int staging_buffer_size = kDefaultStagingBufferSize);
+
+  /**
+   * Automatically insert Sync messages (@see SyncPolicy). With record_offsets set, the Sync
+   * offsets are written as trailer index when the writer is destructed (@see
+   * Writer::writeSyncIndex()). In multi-producer mode, only the byte interval applies.
+   * Not supported with an AsyncWriter, as data messages do not pass through the Writer.
+   */
+  void setSyncPolicy(const SyncPolicy& sync_policy);
+
   /**
    * Write a key-value info. Typically used for versioning information and written to the header.
    * @tparam T one of std::string, int32_t, float
@@ -44,7 +120,12 @@ class SimpleWriter {
   template <typename T>
   void writeInfo(const std::string& key, const T& value)
   {
-    _writer->messageInfo(ulog_cpp::MessageInfo(key, value));
+    const auto lock = lockWriter();
+    const ulog_cpp::MessageInfo info(key, value);
+    _writer->messageInfo(info);
+    if (_rotation_enabled) {
+      replaceByName(_header_infos, info);
+    }
   }
 
   /**
@@ -59,7 +140,12 @@ class SimpleWriter {
     if (_header_complete) {
       throw UsageException("Header already complete");
     }
-    _writer->parameter(ulog_cpp::Parameter(key, value));
+    const auto lock = lockWriter();
+    const ulog_cpp::Parameter parameter(key, value);
+    _writer->parameter(parameter);
+    if (_rotation_enabled) {
+      replaceByName(_header_parameters, parameter);
+    }
   }
 
   /**
@@ -82,6 +168,22 @@ class SimpleWriter {
    */
   void writeMessageFormat(const std::string& name, const std::vector<Field>& fields);
 
+  /**
+   * Write the message format of a struct with MessageTraits (@see ULOG_CPP_MESSAGE_TRAITS()).
+   * The format is validated at compile-time.
+   */
+  template <typename T>
+  void writeMessageFormat()
+  {
+    static_assert(detail::hasTimestampFirst(MessageTraits<T>::kFields),
+                  "First message field must be 'uint64_t timestamp'");
+    static_assert(detail::hasValidFieldNames(MessageTraits<T>::kFields),
+                  "Invalid field name, valid regex: [a-z0-9_]+");
+    static_assert(!detail::hasNestedFields(MessageTraits<T>::kFields),
+                  "Nested formats are not supported");
+    addMessageFormat(MessageTraits<T>::kName, messageFields<T>(), MessageTraits<T>::kSize);
+  }
+
   /**
    * Call this to complete the header (after calling the above methods).
    */
@@ -96,7 +198,12 @@ class SimpleWriter {
     if (!_header_complete) {
       throw UsageException("Header not yet complete");
     }
-    _writer->parameter(ulog_cpp::Parameter(key, value));
+    const auto lock = lockWriter();
+    const ulog_cpp::Parameter parameter(key, value);
+    _writer->parameter(parameter);
+    if (_rotation_enabled) {
+      replaceByName(_header_parameters, parameter);
+    }
   }
 
   /**
@@ -107,6 +214,16 @@ class SimpleWriter {
    */
   uint16_t writeAddLoggedMessage(const std::string& message_format_name, uint8_t multi_id = 0);
 
+  /**
+   * Create a time-series instance of a struct with MessageTraits (@see writeMessageFormat<T>())
+   * @return typed message id for writeData()
+   */
+  template <typename T>
+  MessageId<T> writeAddLoggedMessage(uint8_t multi_id = 0)
+  {
+    return {writeAddLoggedMessage(MessageTraits<T>::kName, multi_id)};
+  }
+
   /**
    * Write a text message
    */
@@ -125,7 +242,19 @@ class SimpleWriter {
   }
 
   /**
-   * Flush the buffer and call fsync() on the file (only if the file-based constructor is used).
+   * Write some data with a typed message id. The type is checked at compile-time, and exactly
+   * MessageTraits<T>::kSize bytes are written.
+   */
+  template <typename T>
+  void writeData(MessageId<T> id, const T& data)
+  {
+    writeDataImpl(id.id, reinterpret_cast<const uint8_t*>(&data), MessageTraits<T>::kSize);
+  }
+
+  /**
+   * Flush the buffer and call fsync() on the file (only if a file-based constructor is used).
+   * With the callback-based constructor, this passes all buffered data to the callback.
+   * With an AsyncWriter, this waits until all data is written and then calls its sync callback.
    */
   void fsync();
 
@@ -141,15 +270,81 @@ class SimpleWriter {
   struct Subscription {
     unsigned message_size;
   };
+  struct StagingBuffer {
+    std::mutex mutex;
+    std::vector<uint8_t> data;
+    int num_messages{0};
+    std::vector<unsigned> message_sizes;  ///< copy of the subscriptions, refreshed on new ids
+    uint64_t last_timestamp{0};           ///< of the last staged message (for rotation)
+  };
 
+  void addMessageFormat(const std::string& name, const std::vector<Field>& fields,
+                        unsigned message_size);
   void writeDataImpl(uint16_t id, const uint8_t* data, unsigned length);
+  void writeDataMultiProducer(uint16_t id, const uint8_t* data, unsigned length);
+
+  /**
+   * Get the staging buffer of the calling thread (multi-producer mode)
+   */
+  StagingBuffer& stagingBuffer();
+  /**
+   * Append the staging buffer to the log. The staging buffer's mutex must be held.
+   */
+  void flushStagingBuffer(StagingBuffer& staging_buffer);
+  void flushStagingBuffers();
+
+  /**
+   * Lock access to _writer (a no-op unless in multi-producer mode). In multi-producer mode, the
+   * calling thread's staged data is written first, to keep the message order within a thread.
+   */
+  std::unique_lock<std::mutex> lockWriter();
+
+  std::unique_ptr<Writer> createFileWriter(int buffer_size);
+  static void replaceByName(std::vector<MessageInfo>& infos, const MessageInfo& info);
+
+  /**
+   * Rotate the file if a threshold of the rotation policy is reached. Must be called with the
+   * writer locked, after a data message.
+   * @param timestamp timestamp of the last data message
+   */
+  void rotateIfDue(uint64_t timestamp);
+  void rotate(uint64_t timestamp);
+  void openNextFileSink();
 
   std::unique_ptr<Writer> _writer;
-  std::FILE* _file{nullptr};
+  std::unique_ptr<FileSink> _file_sink;
+  std::shared_ptr<AsyncWriter> _async_writer;
 
   bool _header_complete{false};
+  SyncPolicy _sync_policy;
+  bool _write_sync_index{false};
   std::unordered_map<std::string, Format> _formats;
   std::vector<Subscription> _subscriptions;
+
+  // Multi-producer mode
+  bool _multi_producer{false};
+  uint64_t _instance_id{0};  ///< unique id for the per-thread staging buffer lookup
+  size_t _staging_buffer_size{0};
+  std::mutex _write_mutex;  ///< protects _writer and _subscriptions
+  std::mutex _staging_buffers_mutex;
+  std::unordered_map<std::thread::id, std::unique_ptr<StagingBuffer>> _staging_buffers;
+
+  // Rotation
+  bool _rotation_enabled{false};
+  FileSinkFactory _file_sink_factory;
+  RotationPolicy _rotation_policy;
+  int _buffer_size{0};
+  int _file_index{0};
+  bool _has_file_start_timestamp{false};
+  uint64_t _file_start_timestamp{0};
+  std::future<std::unique_ptr<FileSink>> _next_file_sink;
+  std::future<void> _closed_file_sink;
+
+  // Header replay for new files (with rotation only)
+  std::vector<MessageInfo> _header_infos;
+  std::vector<MessageFormat> _header_formats;
+  std::vector<Parameter> _header_parameters;  ///< current values
+  std::vector<AddLoggedMessage> _add_logged_messages;
 };
 
 }  // namespace ulog_cpp
@@ -0,0 +1,66 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "spill_file.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+#include "exception.hpp"
+
+namespace ulog_cpp {
+
+SpillFile::SpillFile(const std::string& directory)
+{
+  static std::atomic<unsigned> counter{0};
+  const std::filesystem::path dir =
+      directory.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(directory);
+  const auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+  // Exclusive creation ("x"), retry with another name if the file exists
+  for (int attempt = 0; attempt < 100 && !_file; ++attempt) {
+    _filename = (dir / ("ulog_cpp_spill_" + std::to_string(ticks) + "_" +
+                        std::to_string(counter.fetch_add(1)) + ".tmp"))
+                    .string();
+    _file = std::fopen(_filename.c_str(), "w+bx");
+  }
+  if (!_file) {
+    throw ParsingException("Failed to create spill file in " + dir.string());
+  }
+}
+
+SpillFile::~SpillFile()
+{
+  _mapping.reset();
+  std::fclose(_file);
+  std::remove(_filename.c_str());
+}
+
+uint64_t SpillFile::append(const Data& sample)
+{
+  const std::lock_guard<std::mutex> lock(_mutex);
+  const uint64_t offset = _size;
+  sample.serialize([this](const uint8_t* data, int length) {
+    if (std::fwrite(data, 1, length, _file) != static_cast<size_t>(length)) {
+      throw ParsingException("Failed to write to spill file");
+    }
+    _size += length;
+  });
+  return offset;
+}
+
+std::shared_ptr<const MappedFile> SpillFile::mapping()
+{
+  const std::lock_guard<std::mutex> lock(_mutex);
+  if (!_mapping || _mapping->size() < _size) {
+    if (std::fflush(_file) != 0) {
+      throw ParsingException("Failed to write to spill file");
+    }
+    _mapping = std::make_shared<const MappedFile>(_filename);
+  }
+  return _mapping;
+}
+
+}  // namespace ulog_cpp
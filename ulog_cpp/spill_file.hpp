@@ -0,0 +1,55 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "mapped_file.hpp"
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Temporary file to move data samples out of memory. Samples are appended as serialized DATA
+ * messages, and read back through a read-only memory mapping. The file is removed on destruction.
+ * Errors are reported with a ParsingException().
+ */
+class SpillFile {
+ public:
+  /**
+   * @param directory directory for the file, the system temporary directory if empty
+   */
+  explicit SpillFile(const std::string& directory = "");
+  ~SpillFile();
+
+  SpillFile(const SpillFile&) = delete;
+  SpillFile& operator=(const SpillFile&) = delete;
+
+  /**
+   * @return the file offset of the appended DATA message
+   */
+  uint64_t append(const Data& sample);
+
+  /**
+   * Get a mapping that contains all appended samples. It is replaced when the file has grown since
+   * the last call, so previously returned mappings stay valid.
+   */
+  std::shared_ptr<const MappedFile> mapping();
+
+  const std::string& filename() const { return _filename; }
+
+ private:
+  std::mutex _mutex;
+  std::string _filename;
+  std::FILE* _file{nullptr};
+  uint64_t _size{0};
+  std::shared_ptr<const MappedFile> _mapping;
+};
+
+}  // namespace ulog_cpp
@@ -4,9 +4,17 @@
  ****************************************************************************/
 
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <utility>
 
+#include "compressed_samples.hpp"
+#include "decimation.hpp"
+#include "mapped_file.hpp"
+#include "memory_budget.hpp"
 #include "messages.hpp"
+#include "spill_file.hpp"
 
 namespace ulog_cpp {
 
@@ -63,8 +71,7 @@ class TypedDataView {
    */
   Value at(const std::string& field_name) const
   {
-    auto field = _message_format_ref.field(field_name);
-    return at(field);
+    return at(*_message_format_ref.field(field_name));
   }
 
   /**
@@ -98,8 +105,8 @@ class TypedDataView {
    */
   bool hasField(const std::string& field_name) const
   {
-    const auto iter = _message_format_ref.fieldMap().find(field_name);
-    return iter != _message_format_ref.fieldMap().end() && iter->second->definitionResolved();
+    const auto field = _message_format_ref.findField(field_name);
+    return field && field->definitionResolved();
   }
 
   /**
@@ -112,11 +119,26 @@ class TypedDataView {
   const MessageFormat& _message_format_ref;
 };
 
+class Subscription;
+
+/**
+ * Consecutive decoded samples of a subscription, shared by the iterators positioned on them
+ */
+struct SampleBlock {
+  std::size_t first{0};  ///< index of the first sample
+  std::vector<Data> samples;
+};
+
 /**
  * Iterator to iterate over a subscription. Subscriptions contain a vector of Data objects,
  * the Data objects themselves are not typed to a specific MessageFormat, but the Subscription is.
  * This iterator implicitly converts each Data object to a TypedDataView, which allows access to
  * all Fields.
+ *
+ * For lazy, spilled and compressed subscriptions, the iterator decodes one block of samples at a
+ * time
+ * instead of all samples. A TypedDataView obtained from such an iterator is only valid until the
+ * iterator moves to another block or is destroyed.
  * @tparam base_iterator_type const iterator or modifiable iterator
  */
 template <typename base_iterator_type>
@@ -127,21 +149,28 @@ class SubscriptionIterator {
   {
   }
 
+  /**
+   * Iterator decoding the samples of a subscription block-wise
+   * @param subscription the iterated subscription
+   * @param index sample index
+   */
+  SubscriptionIterator(const Subscription* subscription, std::ptrdiff_t index,
+                       std::shared_ptr<MessageFormat> message_format)
+      : _message_format(std::move(message_format)), _subscription(subscription), _index(index)
+  {
+  }
+
   using iterator_category = std::random_access_iterator_tag;  // NOLINT(*-identifier-naming)
   using value_type = TypedDataView;                           // NOLINT(*-identifier-naming)
   using difference_type = std::ptrdiff_t;                     // NOLINT(*-identifier-naming)
   using pointer = TypedDataView*;                             // NOLINT(*-identifier-naming)
   using reference = TypedDataView&;                           // NOLINT(*-identifier-naming)
 
-  TypedDataView operator*() { return TypedDataView(*_it, *_message_format); }
+  TypedDataView operator*() { return TypedDataView(sample(0), *_message_format); }
 
-  TypedDataView operator*() const { return TypedDataView(*_it, *_message_format); }
+  TypedDataView operator*() const { return TypedDataView(sample(0), *_message_format); }
 
-  SubscriptionIterator& operator++()
-  {
-    ++_it;
-    return *this;
-  }
+  SubscriptionIterator& operator++() { return *this += 1; }
 
   SubscriptionIterator operator++(int)
   {
@@ -150,11 +179,7 @@ class SubscriptionIterator {
     return tmp;
   }
 
-  SubscriptionIterator& operator--()
-  {
-    --_it;
-    return *this;
-  }
+  SubscriptionIterator& operator--() { return *this -= 1; }
 
   SubscriptionIterator operator--(int)
   {
@@ -165,7 +190,11 @@ class SubscriptionIterator {
 
   SubscriptionIterator& operator+=(difference_type n)
   {
-    _it += n;
+    if (_subscription) {
+      _index += n;
+    } else {
+      _it += n;
+    }
     return *this;
   }
 
@@ -176,11 +205,7 @@ class SubscriptionIterator {
     return tmp;
   }
 
-  SubscriptionIterator& operator-=(difference_type n)
-  {
-    _it -= n;
-    return *this;
-  }
+  SubscriptionIterator& operator-=(difference_type n) { return *this += -n; }
 
   SubscriptionIterator operator-(difference_type n) const
   {
@@ -189,25 +214,41 @@ class SubscriptionIterator {
     return tmp;
   }
 
-  difference_type operator-(const SubscriptionIterator& other) const { return _it - other._it; }
+  difference_type operator-(const SubscriptionIterator& other) const
+  {
+    return _subscription ? _index - other._index : _it - other._it;
+  }
 
-  TypedDataView operator[](difference_type n) { return *((*this) + n); }
+  TypedDataView operator[](difference_type n) { return TypedDataView(sample(n), *_message_format); }
 
-  bool operator==(const SubscriptionIterator& other) const { return _it == other._it; }
+  bool operator==(const SubscriptionIterator& other) const
+  {
+    return _subscription ? _index == other._index : _it == other._it;
+  }
 
-  bool operator!=(const SubscriptionIterator& other) const { return _it != other._it; }
+  bool operator!=(const SubscriptionIterator& other) const { return !(*this == other); }
 
-  bool operator<(const SubscriptionIterator& other) const { return _it < other._it; }
+  bool operator<(const SubscriptionIterator& other) const { return (*this - other) < 0; }
 
-  bool operator>(const SubscriptionIterator& other) const { return _it > other._it; }
+  bool operator>(const SubscriptionIterator& other) const { return (*this - other) > 0; }
 
-  bool operator<=(const SubscriptionIterator& other) const { return _it <= other._it; }
+  bool operator<=(const SubscriptionIterator& other) const { return (*this - other) <= 0; }
 
-  bool operator>=(const SubscriptionIterator& other) const { return _it >= other._it; }
+  bool operator>=(const SubscriptionIterator& other) const { return (*this - other) >= 0; }
 
  private:
+  /**
+   * @return the sample at the given offset from the current position, decoding its block if needed
+   */
+  const Data& sample(difference_type offset) const;
+
   base_iterator_type _it;
   std::shared_ptr<MessageFormat> _message_format;
+
+  // Block-wise iteration
+  const Subscription* _subscription{nullptr};
+  difference_type _index{0};
+  mutable std::shared_ptr<const SampleBlock> _block;  ///< block of the last accessed sample
 };
 
 class Subscription {
@@ -218,13 +259,252 @@ class Subscription {
         _message_format(std::move(message_format)),
         _samples(std::move(samples))
   {
+    for (const auto& sample : _samples) {
+      _payload_bytes += sample.data().size();
+    }
+  }
+
+  /**
+   * Copy the samples and storage of a subscription. The decoding state is not shared, and the
+   * copy does not report to the memory budget of the original (@see setMemoryBudget()).
+   */
+  Subscription(const Subscription& other)
+      : _add_logged_message(other._add_logged_message),
+        _message_format(other._message_format),
+        _lazy_source(other._lazy_source),
+        _spill_file(other._spill_file),
+        _sample_offsets(other._sample_offsets),
+        _compressed(other._compressed ? std::make_unique<CompressedSamples>(*other._compressed)
+                                      : nullptr),
+        _decimator(other._decimator ? std::make_unique<Decimator>(*other._decimator) : nullptr)
+  {
+    const std::lock_guard<std::mutex> lock(other._decode_mutex);
+    _samples = other._samples;
+    _payload_bytes = other._payload_bytes;
+    _decoded.store(other._decoded.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+
+  Subscription& operator=(const Subscription& other)
+  {
+    if (this == &other) {
+      return *this;
+    }
+    Subscription copy(other);
+    evict();
+    _add_logged_message = std::move(copy._add_logged_message);
+    _message_format = std::move(copy._message_format);
+    _lazy_source = std::move(copy._lazy_source);
+    _spill_file = std::move(copy._spill_file);
+    _sample_offsets = std::move(copy._sample_offsets);
+    _compressed = std::move(copy._compressed);
+    _decimator = std::move(copy._decimator);
+    _samples = std::move(copy._samples);
+    _payload_bytes = copy._payload_bytes;
+    if (copy._decoded.load(std::memory_order_relaxed) && _memory_budget) {
+      _memory_budget->decoded(samplesMemoryUsage());
+    }
+    _decoded.store(copy._decoded.load(std::memory_order_relaxed), std::memory_order_release);
+    return *this;
+  }
+
+  void emplaceSample(const Data& sample)
+  {
+    if (_lazy_source) {
+      throw UsageException("Cannot add samples to a lazy subscription");
+    }
+    if (_decimator) {
+      _payload_bytes += _decimator->add(sample, _samples);
+      return;
+    }
+    if (_spill_file || _compressed) {
+      if (_spill_file) {
+        _sample_offsets.push_back(_spill_file->append(sample));
+      } else {
+        _compressed->append(sample);
+      }
+      if (!_decoded.load(std::memory_order_relaxed)) {
+        return;
+      }
+    }
+    _samples.emplace_back(sample);
+    _payload_bytes += sample.data().size();
+  }
+
+  /**
+   * Make this a lazy subscription: samples are added with addSampleLocation(), and decoded from
+   * the file on first access.
+   */
+  void setLazySource(std::shared_ptr<const MappedFile> file)
+  {
+    if (!_samples.empty()) {
+      throw UsageException("Subscription already has samples");
+    }
+    _lazy_source = std::move(file);
+  }
+
+  /**
+   * Add the file offset of a DATA message (including the message header) of a lazy subscription
+   */
+  void addSampleLocation(uint64_t file_offset) { _sample_offsets.push_back(file_offset); }
+
+  bool isLazy() const { return _lazy_source != nullptr; }
+
+  /**
+   * Move the samples to a spill file. New samples are appended to the file as well, and the
+   * samples are decoded again on access, like for a lazy subscription.
+   * This invalidates all references, views and iterators into the samples.
+   */
+  void spill(const std::shared_ptr<SpillFile>& file)
+  {
+    if (_lazy_source || _compressed || _decimator) {
+      throw UsageException("Cannot spill a lazy, compressed or decimated subscription");
+    }
+    if (!_spill_file) {
+      _sample_offsets.reserve(_samples.size());
+      for (const auto& sample : _samples) {
+        _sample_offsets.push_back(file->append(sample));
+      }
+      _spill_file = file;
+    }
+    evict();
+  }
+
+  /**
+   * Reduce the number of stored samples while they are added (@see DecimationPolicy). Must be
+   * called before adding samples, and cannot be combined with lazy, spilled or compressed storage.
+   */
+  void setDecimation(const DecimationPolicy& policy)
+  {
+    if (!_samples.empty() || decodedOnAccess()) {
+      throw UsageException("Decimation must be set on an empty in-memory subscription");
+    }
+    _decimator = std::make_unique<Decimator>(policy, *_message_format);
+  }
+
+  bool isDecimated() const { return _decimator != nullptr; }
+
+  bool isSpilled() const { return _spill_file != nullptr; }
+
+  /**
+   * Report decoding and eviction of the samples of a lazy, spilled or compressed subscription to
+   * a MemoryBudget
+   */
+  void setMemoryBudget(std::shared_ptr<MemoryBudget> memory_budget)
+  {
+    _memory_budget = std::move(memory_budget);
+  }
+
+  /**
+   * Move the samples into compressed storage (@see CompressedSamples). New samples are compressed
+   * as well, and the samples are decompressed on access, like for a lazy subscription.
+   * This invalidates all references, views and iterators into the samples.
+   * @param block_size number of samples per compressed block
+   */
+  void compress(int block_size = CompressedSamples::kDefaultBlockSize)
+  {
+    if (_lazy_source || _spill_file || _decimator) {
+      throw UsageException("Cannot compress a lazy, spilled or decimated subscription");
+    }
+    if (!_compressed) {
+      auto compressed = std::make_unique<CompressedSamples>(_message_format, block_size);
+      for (const auto& sample : _samples) {
+        compressed->append(sample);
+      }
+      _compressed = std::move(compressed);
+    }
+    evict();
+  }
+
+  bool isCompressed() const { return _compressed != nullptr; }
+
+  /**
+   * @return the compressed storage for block-wise decoding, or nullptr if not compressed
+   */
+  const CompressedSamples* compressedSamples() const { return _compressed.get(); }
+
+  /**
+   * @return true if the samples are in memory, i.e. the subscription is not lazy, spilled or
+   * compressed, or it was accessed and not evicted since
+   */
+  bool isDecoded() const { return !decodedOnAccess() || _decoded.load(std::memory_order_acquire); }
+
+  /**
+   * @return true if the subscription is lazy, spilled or compressed, i.e. rawSamples() decodes
+   * the samples, and iterators or decodeBlock() decode them block-wise
+   */
+  bool decodedOnAccess() const { return _lazy_source || _spill_file || _compressed; }
+
+  /**
+   * Decode the block of samples containing sample n of a subscription that is decoded on access,
+   * independently of rawSamples() and evict()
+   * @return the decoded block of samples containing sample n
+   */
+  std::shared_ptr<const SampleBlock> decodeBlock(std::size_t n) const
+  {
+    if (!decodedOnAccess()) {
+      throw UsageException("Subscription is not decoded on access");
+    }
+    if (n >= size()) {
+      throw AccessException("Index out of range: " + std::to_string(n));
+    }
+    auto block = std::make_shared<SampleBlock>();
+    if (_compressed) {
+      const std::size_t block_index = _compressed->findBlock(n);
+      block->first = _compressed->blockStart(block_index);
+      _compressed->decodeBlock(block_index, block->samples);
+      return block;
+    }
+    block->first = n - n % kIterationBlockSize;
+    const std::size_t end = std::min(block->first + kIterationBlockSize, _sample_offsets.size());
+    const std::lock_guard<std::mutex> lock(_decode_mutex);
+    const auto file = _spill_file ? _spill_file->mapping() : _lazy_source;
+    decodeLocations(*file, block->first, end, block->samples);
+    return block;
+  }
+
+  /**
+   * Free the decoded samples of a lazy, spilled or compressed subscription, they are decoded again
+   * on the next access. This invalidates all references, views and iterators into the samples, and
+   * must not be called concurrently with other accesses to this subscription.
+   */
+  void evict()
+  {
+    if (!decodedOnAccess()) {
+      return;
+    }
+    const std::lock_guard<std::mutex> lock(_decode_mutex);
+    if (_decoded.load(std::memory_order_relaxed) && _memory_budget) {
+      _memory_budget->evicted(samplesMemoryUsage());
+    }
+    std::vector<Data>().swap(_samples);
+    _payload_bytes = 0;
+    _decoded.store(false, std::memory_order_release);
   }
 
-  void emplaceSample(const Data& sample) { _samples.emplace_back(sample); }
+  /**
+   * @return estimated heap memory used by the samples in bytes
+   */
+  uint64_t memoryUsage() const
+  {
+    return samplesMemoryUsage() + _sample_offsets.capacity() * sizeof(uint64_t) +
+           (_compressed ? _compressed->memoryUsage() : 0);
+  }
+
+  /**
+   * @return estimated heap memory used by adding a sample with a payload of the given size
+   */
+  static uint64_t sampleMemoryUsage(size_t payload_size)
+  {
+    return sizeof(Data) + kAllocationOverhead + payload_size;
+  }
 
   const AddLoggedMessage& getAddLoggedMessage() const { return _add_logged_message; }
 
-  const std::vector<Data>& rawSamples() const { return _samples; }
+  const std::vector<Data>& rawSamples() const
+  {
+    ensureDecoded();
+    return _samples;
+  }
 
   const std::shared_ptr<MessageFormat>& format() const { return _message_format; }
 
@@ -242,20 +522,36 @@ class Subscription {
 
   auto begin()
   {
+    if (decodedOnAccess()) {
+      return SubscriptionIterator<std::vector<Data>::iterator>(this, 0, _message_format);
+    }
+    ensureDecoded();
     return SubscriptionIterator<std::vector<Data>::iterator>(_samples.begin(), _message_format);
   }
   auto end()
   {
+    if (decodedOnAccess()) {
+      return SubscriptionIterator<std::vector<Data>::iterator>(this, size(), _message_format);
+    }
+    ensureDecoded();
     return SubscriptionIterator<std::vector<Data>::iterator>(_samples.end(), _message_format);
   }
 
   auto begin() const
   {
+    if (decodedOnAccess()) {
+      return SubscriptionIterator<std::vector<Data>::const_iterator>(this, 0, _message_format);
+    }
+    ensureDecoded();
     return SubscriptionIterator<std::vector<Data>::const_iterator>(_samples.begin(),
                                                                    _message_format);
   }
   auto end() const
   {
+    if (decodedOnAccess()) {
+      return SubscriptionIterator<std::vector<Data>::const_iterator>(this, size(), _message_format);
+    }
+    ensureDecoded();
     return SubscriptionIterator<std::vector<Data>::const_iterator>(_samples.cend(),
                                                                    _message_format);
   }
@@ -265,17 +561,124 @@ class Subscription {
     if (n >= size()) {
       throw AccessException("Index out of range: " + std::to_string(n));
     }
-    return begin()[n];
+    return TypedDataView(rawSamples()[n], *_message_format);
   }
 
   TypedDataView operator[](std::size_t n) { return at(n); }
 
-  std::size_t size() const { return _samples.size(); }
+  std::size_t size() const
+  {
+    if (_compressed) {
+      return _compressed->size();
+    }
+    return decodedOnAccess() ? _sample_offsets.size() : _samples.size();
+  }
 
  private:
+  static constexpr uint64_t kAllocationOverhead = 16;     ///< per heap allocation (malloc header)
+  static constexpr std::size_t kIterationBlockSize = 512;  ///< samples decoded at once by iterators
+
+  /**
+   * @return estimated heap memory used by _samples in bytes
+   */
+  uint64_t samplesMemoryUsage() const
+  {
+    return _samples.capacity() * sizeof(Data) + _samples.size() * kAllocationOverhead +
+           _payload_bytes;
+  }
+
+  void ensureDecoded() const
+  {
+    if (decodedOnAccess() && !_decoded.load(std::memory_order_acquire)) {
+      decode();
+    }
+  }
+
+  void decode() const
+  {
+    const std::lock_guard<std::mutex> lock(_decode_mutex);
+    if (_decoded.load(std::memory_order_relaxed)) {
+      return;
+    }
+    decodeSamples();
+    if (_memory_budget) {
+      _memory_budget->decoded(samplesMemoryUsage());
+    }
+    _decoded.store(true, std::memory_order_release);
+  }
+
+  void decodeSamples() const
+  {
+    if (_compressed) {
+      std::vector<Data> samples;
+      _compressed->decodeAll(samples);
+      _payload_bytes = 0;
+      for (const auto& sample : samples) {
+        _payload_bytes += sample.data().size();
+      }
+      _samples = std::move(samples);
+      return;
+    }
+    const auto file = _spill_file ? _spill_file->mapping() : _lazy_source;
+    std::vector<Data> samples;
+    _payload_bytes = decodeLocations(*file, 0, _sample_offsets.size(), samples);
+    _samples = std::move(samples);
+  }
+
+  /**
+   * Decode the samples at _sample_offsets[begin, end) from a file
+   * @return sum of the payload sizes
+   */
+  uint64_t decodeLocations(const MappedFile& file, std::size_t begin, std::size_t end,
+                           std::vector<Data>& samples) const
+  {
+    samples.reserve(samples.size() + end - begin);
+    uint64_t payload_bytes = 0;
+    for (std::size_t i = begin; i < end; ++i) {
+      const uint64_t offset = _sample_offsets[i];
+      if (offset + sizeof(ulog_message_data_s) > file.size()) {
+        throw ParsingException("Sample location out of range");
+      }
+      const uint8_t* message = file.data() + offset;
+      const auto* header = reinterpret_cast<const ulog_message_data_s*>(message);
+      if (header->msg_type != static_cast<uint8_t>(ULogMessageType::DATA) ||
+          offset + ULOG_MSG_HEADER_LEN + header->msg_size > file.size()) {
+        throw ParsingException("Invalid sample location");
+      }
+      samples.emplace_back(message);
+      payload_bytes += samples.back().data().size();
+    }
+    return payload_bytes;
+  }
+
   AddLoggedMessage _add_logged_message;
   std::shared_ptr<MessageFormat> _message_format;
-  std::vector<Data> _samples;
+  mutable std::vector<Data> _samples;
+  mutable uint64_t _payload_bytes{0};  ///< sum of the payload sizes of _samples
+
+  // Lazy, spilled and compressed subscriptions
+  std::shared_ptr<const MappedFile> _lazy_source;
+  std::shared_ptr<SpillFile> _spill_file;
+  std::vector<uint64_t> _sample_offsets;
+  std::unique_ptr<CompressedSamples> _compressed;
+
+  std::unique_ptr<Decimator> _decimator;
+  std::shared_ptr<MemoryBudget> _memory_budget;
+  mutable std::atomic<bool> _decoded{false};
+  mutable std::mutex _decode_mutex;
 };
 
+template <typename base_iterator_type>
+const Data& SubscriptionIterator<base_iterator_type>::sample(difference_type offset) const
+{
+  if (!_subscription) {
+    return _it[offset];
+  }
+  const auto n = static_cast<std::size_t>(_index + offset);
+  if (!_block || n < _block->first || n >= _block->first + _block->samples.size()) {
+    _block = _subscription->decodeBlock(n);
+  }
+  return _block->samples[n - _block->first];
+}
+
 }  // namespace ulog_cpp
\ No newline at end of file
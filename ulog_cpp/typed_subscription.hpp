@@ -0,0 +1,226 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "message_traits.hpp"
+#include "subscription.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Typed access to the samples of a subscription as structs with MessageTraits
+ * (@see ULOG_CPP_MESSAGE_TRAITS()), without going through Value.
+ *
+ * On construction, the struct is checked against the resolved MessageFormat: the total size, and
+ * for each struct field its type, array length and offset. Then sample access is a plain memcpy,
+ * or a reinterpret_cast for ref() if the struct has no tail padding and the sample buffers are
+ * complete and suitably aligned (zeroCopy()). Samples without the trailing padding field (as
+ * written by PX4) are accepted, the missing bytes are zero.
+ *
+ * Samples are stored in separate buffers, so they cannot be exposed as a contiguous span.
+ * The subscription must not be modified while bound.
+ *
+ * Lazy, spilled and compressed subscriptions are not decoded as a whole: iterators decode one
+ * block at a time (@see SubscriptionIterator), and sample sizes are checked as samples are decoded.
+ * ref() is not available for them, as references would not outlive the decoded samples.
+ */
+template <typename T>
+class TypedSubscription {
+ public:
+  using Traits = MessageTraits<T>;
+
+  class Iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = T;
+
+    using BaseIterator = SubscriptionIterator<std::vector<Data>::const_iterator>;
+
+    Iterator(BaseIterator it, size_t min_sample_size)
+        : _it(std::move(it)), _min_sample_size(min_sample_size)
+    {
+    }
+
+    T operator*() const { return decode((*_it).rawData(), _min_sample_size); }
+    Iterator& operator++()
+    {
+      ++_it;
+      return *this;
+    }
+    Iterator operator++(int)
+    {
+      Iterator tmp = *this;
+      ++_it;
+      return tmp;
+    }
+    Iterator& operator+=(difference_type n)
+    {
+      _it += n;
+      return *this;
+    }
+    Iterator operator+(difference_type n) const { return Iterator(_it + n, _min_sample_size); }
+    difference_type operator-(const Iterator& other) const { return _it - other._it; }
+    T operator[](difference_type n) const
+    {
+      return decode((*(_it + n)).rawData(), _min_sample_size);
+    }
+    bool operator==(const Iterator& other) const { return _it == other._it; }
+    bool operator!=(const Iterator& other) const { return _it != other._it; }
+    bool operator<(const Iterator& other) const { return _it < other._it; }
+
+   private:
+    BaseIterator _it;
+    size_t _min_sample_size;
+  };
+
+  /**
+   * Bind to a subscription. Throws a UsageException() if the struct does not match the message
+   * format, or a ParsingException() if a sample is too short (for subscriptions decoded on access,
+   * when the sample is decoded).
+   */
+  explicit TypedSubscription(std::shared_ptr<Subscription> subscription)
+      : _subscription(std::move(subscription))
+  {
+    if (!_subscription) {
+      throw AccessException("Invalid subscription");
+    }
+    const std::string error = incompatibility(*_subscription->format());
+    if (!error.empty()) {
+      throw UsageException("Struct does not match format " + _subscription->format()->name() +
+                           ": " + error);
+    }
+    // Loggers may omit the trailing padding field
+    _min_sample_size = Traits::kSize;
+    const auto& fields = _subscription->format()->fields();
+    if (!fields.empty() && fields.back()->name().rfind("_padding", 0) == 0) {
+      _min_sample_size = fields.back()->offsetInMessage();
+    }
+    if (_subscription->decodedOnAccess()) {
+      // Do not decode all samples just to check them
+      return;
+    }
+    _zero_copy = sizeof(T) == Traits::kSize;
+    for (const auto& sample : _subscription->rawSamples()) {
+      if (sample.data().size() < _min_sample_size) {
+        throw ParsingException("Sample too short for " + _subscription->format()->name());
+      }
+      if (sample.data().size() < Traits::kSize ||
+          reinterpret_cast<uintptr_t>(sample.data().data()) % alignof(T) != 0) {
+        _zero_copy = false;
+      }
+    }
+  }
+
+  /**
+   * Check if a message format matches the struct
+   * @return empty if compatible, a description of the first mismatch otherwise
+   */
+  static std::string incompatibility(const MessageFormat& message_format)
+  {
+    if (message_format.sizeBytes() != static_cast<int>(Traits::kSize)) {
+      return "size " + std::to_string(message_format.sizeBytes()) +
+             " != " + std::to_string(Traits::kSize);
+    }
+    for (const auto& descriptor : Traits::kFields) {
+      const auto field_ptr = message_format.findField(descriptor.name);
+      if (!field_ptr) {
+        return std::string("field ") + descriptor.name + " not found";
+      }
+      const Field& field = *field_ptr;
+      const int field_size =
+          field.type().size * (field.arrayLength() == -1 ? 1 : field.arrayLength());
+      if (field.type().type != descriptor.type || field.arrayLength() != descriptor.array_length ||
+          field.offsetInMessage() != static_cast<int>(descriptor.offset) ||
+          field_size != static_cast<int>(descriptor.size)) {
+        return std::string("field ") + descriptor.name + " differs";
+      }
+      // Nested formats are compared by name and size
+      if (descriptor.type == Field::BasicType::NESTED &&
+          field.type().name != descriptor.type_name) {
+        return std::string("field ") + descriptor.name + " has a different type";
+      }
+    }
+    return {};
+  }
+
+  std::size_t size() const { return _subscription->size(); }
+
+  /**
+   * Get a sample (copied). Not bounds-checked, @see at()
+   * For subscriptions decoded on access, this decodes the block containing the sample, so prefer
+   * iterating for sequential access.
+   */
+  T operator[](std::size_t n) const
+  {
+    if (_subscription->decodedOnAccess()) {
+      const auto block = _subscription->decodeBlock(n);
+      return decode(block->samples[n - block->first].data(), _min_sample_size);
+    }
+    return decode(_subscription->rawSamples()[n].data(), _min_sample_size);
+  }
+
+  T at(std::size_t n) const
+  {
+    if (n >= size()) {
+      throw AccessException("Index out of range: " + std::to_string(n));
+    }
+    return (*this)[n];
+  }
+
+  /**
+   * @return true if ref() can be used, never for lazy, spilled or compressed subscriptions
+   */
+  bool zeroCopy() const { return _zero_copy; }
+
+  /**
+   * Get a reference to a sample without copying. Only possible if zeroCopy() is true.
+   */
+  const T& ref(std::size_t n) const
+  {
+    if (!_zero_copy) {
+      throw UsageException("Zero-copy access not possible for " + _subscription->format()->name());
+    }
+    if (n >= size()) {
+      throw AccessException("Index out of range: " + std::to_string(n));
+    }
+    return *reinterpret_cast<const T*>(_subscription->rawSamples()[n].data().data());
+  }
+
+  Iterator begin() const
+  {
+    return Iterator(std::as_const(*_subscription).begin(), _min_sample_size);
+  }
+  Iterator end() const { return Iterator(std::as_const(*_subscription).end(), _min_sample_size); }
+
+  const std::shared_ptr<Subscription>& subscription() const { return _subscription; }
+
+ private:
+  static T decode(const std::vector<uint8_t>& sample, size_t min_sample_size)
+  {
+    if (sample.size() < min_sample_size) {
+      throw ParsingException("Sample too short for " + std::string(Traits::kName));
+    }
+    T value{};
+    memcpy(&value, sample.data(), std::min(sample.size(), Traits::kSize));
+    return value;
+  }
+
+  std::shared_ptr<Subscription> _subscription;
+  size_t _min_sample_size{0};
+  bool _zero_copy{false};
+};
+
+}  // namespace ulog_cpp
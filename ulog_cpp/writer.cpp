@@ -5,9 +5,19 @@
 
 #include "writer.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 namespace ulog_cpp {
 
-Writer::Writer(DataWriteCB data_write_cb) : _data_write_cb(std::move(data_write_cb))
+const std::string Writer::kSyncOffsetsKey = "sync_offsets";
+const std::string Writer::kSyncIndexOffsetKey = "sync_index_offset";
+
+Writer::Writer(DataWriteCB data_write_cb) : Writer(std::move(data_write_cb), 0) {}
+
+Writer::Writer(DataWriteCB data_write_cb, int buffer_size)
+    : _data_write_cb(std::move(data_write_cb)), _buffer_size(std::max(buffer_size, 0))
 {
   // Writer assumes to run on little endian
   // TODO: use std::endian from C++20
@@ -16,6 +26,49 @@ Writer::Writer(DataWriteCB data_write_cb) : _data_write_cb(std::move(data_write_
   if (*reinterpret_cast<char*>(&num) != 1) {
     throw UsageException("Writer requires little endian");
   }
+
+  if (_buffer_size > 0) {
+    // Leave some headroom, as the buffer is only flushed after a complete message
+    _buffer.reserve(_buffer_size + 1024);
+    _serialize_cb = [this](const uint8_t* data, int length) {
+      _buffer.insert(_buffer.end(), data, data + length);
+    };
+  } else {
+    _serialize_cb = [this](const uint8_t* data, int length) {
+      _data_write_cb(data, length);
+      _num_flushed_bytes += length;
+    };
+  }
+}
+
+Writer::~Writer()
+{
+  try {
+    flush();
+  } catch (...) {
+  }
+}
+
+void Writer::flush()
+{
+  if (_buffer.empty()) {
+    return;
+  }
+  try {
+    _data_write_cb(_buffer.data(), static_cast<int>(_buffer.size()));
+  } catch (...) {
+    // Drop the data, so it does not get written twice
+    _buffer.clear();
+    throw;
+  }
+  _num_flushed_bytes += _buffer.size();
+  _buffer.clear();
+}
+
+void Writer::serializedMessages(const uint8_t* data, int length)
+{
+  _serialize_cb(data, length);
+  messageWritten();
 }
 
 void Writer::headerComplete()
@@ -24,48 +77,153 @@ void Writer::headerComplete()
 }
 void Writer::fileHeader(const FileHeader& header)
 {
-  header.serialize(_data_write_cb);
+  header.serialize(_serialize_cb);
+  messageWritten();
 }
 void Writer::messageInfo(const MessageInfo& message_info)
 {
-  message_info.serialize(_data_write_cb);
+  message_info.serialize(_serialize_cb);
+  messageWritten();
 }
 void Writer::messageFormat(const MessageFormat& message_format)
 {
   if (_header_complete) {
     throw UsageException("Header completed, cannot write formats");
   }
-  message_format.serialize(_data_write_cb);
+  message_format.serialize(_serialize_cb);
+  messageWritten();
 }
 void Writer::parameter(const Parameter& parameter)
 {
-  parameter.serialize(_data_write_cb, ULogMessageType::PARAMETER);
+  parameter.serialize(_serialize_cb, ULogMessageType::PARAMETER);
+  messageWritten();
 }
 void Writer::parameterDefault(const ParameterDefault& parameter_default)
 {
-  parameter_default.serialize(_data_write_cb);
+  parameter_default.serialize(_serialize_cb);
+  messageWritten();
 }
 void Writer::addLoggedMessage(const AddLoggedMessage& add_logged_message)
 {
   if (!_header_complete) {
     throw UsageException("Header not yet completed, cannot write AddLoggedMessage");
   }
-  add_logged_message.serialize(_data_write_cb);
+  add_logged_message.serialize(_serialize_cb);
+  messageWritten();
 }
 void Writer::logging(const Logging& logging)
 {
-  logging.serialize(_data_write_cb);
+  logging.serialize(_serialize_cb);
+  messageWritten();
 }
 void Writer::data(const Data& data)
 {
-  data.serialize(_data_write_cb);
+  data.serialize(_serialize_cb);
+  uint64_t timestamp = 0;
+  if (_sync_policy_enabled && data.data().size() >= sizeof(timestamp)) {
+    memcpy(&timestamp, data.data().data(), sizeof(timestamp));
+  }
+  messageWritten(timestamp);
+}
+void Writer::data(uint16_t msg_id, const uint8_t* payload, int length)
+{
+  const int msg_size = length + 2;
+  if (msg_size > std::numeric_limits<uint16_t>::max()) {
+    throw ParsingException("message too long");
+  }
+  ulog_message_data_s data_msg;
+  data_msg.msg_id = msg_id;
+  data_msg.msg_size = msg_size;
+  const int header_size = ULOG_MSG_HEADER_LEN + 2;
+
+  if (_buffer_size > 0) {
+    const size_t offset = _buffer.size();
+    _buffer.resize(offset + header_size + length);
+    memcpy(_buffer.data() + offset, &data_msg, header_size);
+    memcpy(_buffer.data() + offset + header_size, payload, length);
+  } else {
+    _data_write_cb(reinterpret_cast<const uint8_t*>(&data_msg), header_size);
+    _data_write_cb(payload, length);
+    _num_flushed_bytes += header_size + length;
+  }
+  uint64_t timestamp = 0;
+  if (_sync_policy_enabled && length >= static_cast<int>(sizeof(timestamp))) {
+    memcpy(&timestamp, payload, sizeof(timestamp));
+  }
+  messageWritten(timestamp);
 }
 void Writer::dropout(const Dropout& dropout)
 {
-  dropout.serialize(_data_write_cb);
+  dropout.serialize(_serialize_cb);
+  messageWritten();
 }
 void Writer::sync(const Sync& sync)
 {
-  sync.serialize(_data_write_cb);
+  writeSync(sync);
+  messageWritten();
+}
+
+void Writer::setSyncPolicy(const SyncPolicy& sync_policy)
+{
+  _sync_policy = sync_policy;
+  _sync_policy_enabled = sync_policy.interval_bytes > 0 || sync_policy.interval_us > 0;
+  _last_sync_position = position();
+  _last_sync_timestamp = 0;
+}
+
+void Writer::syncIfDue(uint64_t timestamp)
+{
+  if (!_header_complete) {
+    return;
+  }
+  bool due = _sync_policy.interval_bytes > 0 &&
+             position() - _last_sync_position >= _sync_policy.interval_bytes;
+  if (_sync_policy.interval_us > 0 && timestamp > 0) {
+    if (_last_sync_timestamp == 0) {
+      _last_sync_timestamp = timestamp;
+    } else if (timestamp >= _last_sync_timestamp + _sync_policy.interval_us) {
+      due = true;
+    }
+  }
+  if (due) {
+    writeSync(Sync());
+    if (timestamp > 0) {
+      _last_sync_timestamp = timestamp;
+    }
+  }
+}
+
+void Writer::writeSync(const Sync& sync)
+{
+  if (_sync_policy.record_offsets) {
+    _sync_offsets.push_back(position());
+  }
+  sync.serialize(_serialize_cb);
+  _last_sync_position = position();
+}
+
+void Writer::writeSyncIndex()
+{
+  if (!_header_complete) {
+    throw UsageException("Header not yet completed, cannot write the sync index");
+  }
+  if (_sync_offsets.empty()) {
+    return;
+  }
+  // Stay well below the maximum message size
+  static constexpr size_t kMaxOffsetsPerMessage = 4096;
+  const uint64_t index_offset = position();
+  for (size_t i = 0; i < _sync_offsets.size(); i += kMaxOffsetsPerMessage) {
+    const size_t num_offsets = std::min(kMaxOffsetsPerMessage, _sync_offsets.size() - i);
+    std::vector<uint8_t> value(num_offsets * sizeof(uint64_t));
+    memcpy(value.data(), _sync_offsets.data() + i, value.size());
+    const MessageInfo info(Field("uint64_t", kSyncOffsetsKey, static_cast<int>(num_offsets)),
+                           std::move(value), true, i > 0);
+    info.serialize(_serialize_cb);
+  }
+  std::vector<uint8_t> value(sizeof(index_offset));
+  memcpy(value.data(), &index_offset, sizeof(index_offset));
+  MessageInfo(Field("uint64_t", kSyncIndexOffsetKey), std::move(value)).serialize(_serialize_cb);
+  flush();
 }
 }  // namespace ulog_cpp
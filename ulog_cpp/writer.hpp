@@ -6,6 +6,8 @@
 
 #include <cstdint>
 #include <functional>
+#include <string>
+#include <vector>
 
 #include "data_handler_interface.hpp"
 
@@ -15,10 +17,49 @@
  */
 namespace ulog_cpp {
 
+/**
+ * Automatic insertion of Sync messages, which readers can use as resynchronization points (e.g. for
+ * recovery or to split a file for parallel processing). A Sync message is written after the message
+ * that reaches one of the intervals, in the data section only.
+ */
+struct SyncPolicy {
+  uint64_t interval_bytes{0};  ///< insert after at least this many bytes, 0 to disable
+  /**
+   * insert after at least this much log time [us], 0 to disable. The time is taken from the data
+   * message timestamps (first 8 bytes of the payload).
+   */
+  uint64_t interval_us{0};
+  bool record_offsets{false};  ///< keep the Sync message file offsets (@see writeSyncIndex())
+};
+
 class Writer : public DataHandlerInterface {
  public:
   explicit Writer(DataWriteCB data_write_cb);
-  virtual ~Writer() = default;
+
+  /**
+   * Constructor for buffered writing: messages are serialized into an internal buffer, which is
+   * passed to data_write_cb once it reaches buffer_size (or on flush()). The callback is always
+   * called with complete messages.
+   * @param data_write_cb callback for serialized ULog data
+   * @param buffer_size flush threshold [bytes], 0 to call data_write_cb for each message part
+   */
+  Writer(DataWriteCB data_write_cb, int buffer_size);
+
+  /**
+   * Flushes the remaining buffered data. Write errors are ignored, call flush() before to
+   * handle them.
+   */
+  virtual ~Writer();
+
+  /**
+   * Pass all buffered data to the write callback
+   */
+  void flush();
+
+  /**
+   * Write already serialized, complete messages (e.g. a block of data messages)
+   */
+  void serializedMessages(const uint8_t* data, int length);
 
   void headerComplete() override;
 
@@ -30,12 +71,71 @@ class Writer : public DataHandlerInterface {
   void addLoggedMessage(const AddLoggedMessage& add_logged_message) override;
   void logging(const Logging& logging) override;
   void data(const Data& data) override;
+
+  /**
+   * Write a data message directly from a payload buffer, without constructing a Data object.
+   * In buffered mode, the message is assembled in place in the write buffer, so this does not
+   * allocate once the buffer reached its size.
+   * @param msg_id message id from AddLoggedMessage
+   * @param payload message payload
+   * @param length payload length [bytes]
+   */
+  void data(uint16_t msg_id, const uint8_t* payload, int length);
   void dropout(const Dropout& dropout) override;
   void sync(const Sync& sync) override;
 
+  void setSyncPolicy(const SyncPolicy& sync_policy);
+
+  /**
+   * @return number of bytes serialized so far, i.e. the file offset of the next message
+   */
+  uint64_t position() const { return _num_flushed_bytes + _buffer.size(); }
+
+  /**
+   * @return file offsets of the written Sync messages (if SyncPolicy::record_offsets is set)
+   */
+  const std::vector<uint64_t>& syncOffsets() const { return _sync_offsets; }
+
+  /**
+   * Write the recorded Sync offsets as trailer index: a multi info message
+   * 'uint64_t[n] sync_offsets' (continued for large n), followed by an info message
+   * 'uint64_t sync_index_offset' with the file offset of the first index message. The latter is
+   * the last message in the file and has a fixed size of kSyncIndexTrailerSize bytes, so readers
+   * can locate the index from the end of the file.
+   * This must be the last call to the writer.
+   */
+  void writeSyncIndex();
+
+  static const std::string kSyncOffsetsKey;
+  static const std::string kSyncIndexOffsetKey;
+  static constexpr int kSyncIndexTrailerSize = ULOG_MSG_HEADER_LEN + 1 + 26 + 8;
+
  private:
+  void messageWritten(uint64_t timestamp = 0)
+  {
+    if (_sync_policy_enabled) {
+      syncIfDue(timestamp);
+    }
+    if (_buffer.size() >= _buffer_size) {
+      flush();
+    }
+  }
+  void syncIfDue(uint64_t timestamp);
+  void writeSync(const Sync& sync);
+
   const DataWriteCB _data_write_cb;
+  DataWriteCB _serialize_cb;  ///< target for serialize(): _data_write_cb (counting) or the buffer
   bool _header_complete{false};
+
+  const size_t _buffer_size{0};
+  std::vector<uint8_t> _buffer;
+  uint64_t _num_flushed_bytes{0};
+
+  SyncPolicy _sync_policy;
+  bool _sync_policy_enabled{false};
+  uint64_t _last_sync_position{0};
+  uint64_t _last_sync_timestamp{0};
+  std::vector<uint64_t> _sync_offsets;
 };
 
 }  // namespace ulog_cpp